@@ -0,0 +1,148 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/utils.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+// the layer shapes of conv2d-testsuite (image size, kernel size, input channels, output channels)
+static const vector<tuple<unsigned, unsigned, unsigned, unsigned>> shapes = {
+    {16, 3, 8, 3}, {16, 5, 8, 2}, {16, 7, 8, 1},
+    {16, 3, 32, 3}, {16, 5, 32, 2}, {16, 7, 32, 1},
+    {16, 3, 512, 3}, {16, 5, 512, 2}, {16, 7, 512, 1},
+    {32, 3, 8, 3}, {32, 5, 8, 2}, {32, 7, 8, 1},
+    {32, 3, 64, 3}, {32, 5, 64, 2}, {32, 7, 64, 1},
+    {32, 3, 256, 3}, {32, 5, 256, 2}, {32, 7, 256, 1},
+    {64, 3, 8, 3}, {64, 5, 8, 2}, {64, 7, 8, 1},
+    {64, 3, 32, 3}, {64, 5, 32, 2}, {64, 7, 32, 1},
+    {64, 3, 96, 3}, {64, 5, 96, 2}, {64, 7, 96, 1},
+    {128, 3, 8, 3}, {128, 5, 8, 2}, {128, 7, 8, 1},
+    {128, 3, 16, 3}, {128, 5, 16, 2}, {128, 7, 16, 1},
+};
+
+// average duration of copy_data_in in microseconds
+static float time_copy_in(Conv2D& op, const void* iact, size_t iact_bytes, const void* wght, size_t wght_bytes, unsigned repetitions) {
+    auto t1 = timer::now();
+    for (unsigned n = 0; n < repetitions; n++)
+        op.copy_data_in(iact, iact_bytes, wght, wght_bytes);
+    chrono::duration<float, std::micro> duration = timer::now() - t1;
+    return duration.count() / repetitions;
+}
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+    unsigned max_threads = thread::hardware_concurrency();
+    unsigned repetitions = 20;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:t:n:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-t " << max_threads << ": benchmark 1 up to this number of copy threads" << endl;
+                cout << "-n 20: repetitions per measurement" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    if (max_threads == 0)
+        max_threads = 1;
+
+    recacc_device dev;
+    int ret = recacc_open(&dev, device_name.c_str());
+    if (ret)
+        return ret;
+
+    if (!recacc_verify(&dev, true)) {
+        recacc_close(&dev);
+        return 1;
+    }
+
+    recacc_hwinfo hwinfo;
+    recacc_get_hwinfo(&dev, &hwinfo);
+    int8_t* spad = static_cast<int8_t*>(recacc_get_buffer(&dev));
+
+    VariadicTable<int, int, int, int, int, float, float, float, float, string> vt({
+        "HxW", "RxS", "i-ch", "o-ch", "threads", "iact KiB", "iact MB/s", "wght KiB", "wght MB/s", "spad"}, 10);
+
+    bool all_exact = true;
+    for (auto [image_size, kernel_size, input_channels, output_channels] : shapes) {
+        Conv2D op(image_size, kernel_size, input_channels, output_channels);
+        op.set_recacc_device(&dev);
+        op.set_hwinfo(hwinfo);
+        try {
+            op.allocate_spad_auto();
+            op.compute_accelerator_parameters(true);
+        } catch (const exception& e) {
+            cerr << "skipping " << op.get_parameter_string() << ": " << e.what() << endl;
+            continue;
+        }
+
+        const size_t iact_bytes = image_size * image_size * input_channels;
+        const size_t wght_bytes = kernel_size * kernel_size * input_channels * output_channels;
+        vector<input_t> iact(iact_bytes), wght(wght_bytes);
+        generate_random_data<input_t>(iact.data(), iact_bytes);
+        generate_random_data<input_t>(wght.data(), wght_bytes);
+
+        // scratchpad contents of the single-threaded copy as reference
+        vector<int8_t> reference(hwinfo.spad_size);
+        for (unsigned threads = 1; threads <= max_threads; threads++) {
+            op.set_copy_threads(threads);
+
+            float iact_us = time_copy_in(op, iact.data(), iact_bytes, nullptr, 0, repetitions);
+            float wght_us = time_copy_in(op, nullptr, 0, wght.data(), wght_bytes, repetitions);
+
+            // the parallel copy must place every byte exactly like the sequential one
+            memset(spad, 0x5a, hwinfo.spad_size);
+            op.copy_data_in(iact.data(), iact_bytes, wght.data(), wght_bytes);
+            bool exact = true;
+            if (threads == 1)
+                memcpy(reference.data(), spad, hwinfo.spad_size);
+            else
+                exact = memcmp(reference.data(), spad, hwinfo.spad_size) == 0;
+            all_exact &= exact;
+
+            vt.addRow(image_size, kernel_size, input_channels, output_channels, threads,
+                iact_bytes / 1024.0, iact_bytes / iact_us, wght_bytes / 1024.0, wght_bytes / wght_us,
+                exact ? "identical" : "DIFFERENT");
+        }
+    }
+
+    vt.print(cout);
+    recacc_close(&dev);
+    return all_exact ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/hosttensor.hpp"
+#include "lib/utils.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+// image size, kernel size, input channels, output channels: camera frames with few channels and deeper layers
+static const vector<tuple<unsigned, unsigned, unsigned, unsigned>> shapes = {
+    {32, 3, 3, 8}, {64, 3, 3, 8}, {96, 3, 3, 4}, {96, 3, 4, 4},
+    {64, 3, 16, 8}, {32, 3, 64, 8}, {32, 5, 24, 8}, {16, 3, 256, 3},
+};
+
+// average duration of fn in microseconds
+template<typename F> static float time_us(F fn, unsigned repetitions) {
+    auto t1 = timer::now();
+    for (unsigned n = 0; n < repetitions; n++)
+        fn();
+    chrono::duration<float, std::micro> duration = timer::now() - t1;
+    return duration.count() / repetitions;
+}
+
+// every channel in the scratchpad must equal the dense reference
+static bool verify(Conv2D& op, const vector<input_t>& iact, const vector<input_t>& wght) {
+    auto [input_channels, output_channels] = op.get_channel_count();
+    SpadTensorView<input_t> iact_view = op.iact_view();
+    const unsigned plane = iact_view.get_height() * iact_view.get_width();
+    vector<input_t> buf(plane);
+    for (unsigned c = 0; c < input_channels; c++) {
+        iact_view.read_channel(c, buf.data());
+        if (memcmp(buf.data(), &iact[c * plane], plane))
+            return false;
+    }
+    for (unsigned och = 0; och < output_channels; och++) {
+        SpadTensorView<input_t> wght_view = op.wght_view(och);
+        const unsigned kernel = wght_view.get_height() * wght_view.get_width();
+        for (unsigned c = 0; c < input_channels; c++) {
+            wght_view.read_channel(c, buf.data());
+            if (memcmp(buf.data(), &wght[(och * input_channels + c) * kernel], kernel))
+                return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+    unsigned repetitions = 20;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:n:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-n 20: repetitions per measurement" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    int ret = recacc_open(&dev, device_name.c_str());
+    if (ret)
+        return ret;
+
+    if (!recacc_verify(&dev, true)) {
+        recacc_close(&dev);
+        return 1;
+    }
+
+    recacc_hwinfo hwinfo;
+    recacc_get_hwinfo(&dev, &hwinfo);
+
+    VariadicTable<int, int, int, int, string, float, float, float, string> vt({
+        "HxW", "RxS", "i-ch", "o-ch", "layout", "KiB", "transpose+copy [us]", "fused [us]", "spad"}, 10);
+
+    bool all_correct = true;
+    for (auto [image_size, kernel_size, input_channels, output_channels] : shapes) {
+        Conv2D op(image_size, kernel_size, input_channels, output_channels);
+        op.set_recacc_device(&dev);
+        op.set_hwinfo(hwinfo);
+        try {
+            op.allocate_spad_auto();
+            op.compute_accelerator_parameters(true);
+        } catch (const exception& e) {
+            cerr << "skipping " << op.get_parameter_string() << ": " << e.what() << endl;
+            continue;
+        }
+
+        // a frame twice the image size in HWC, the layer reads a window from its centre
+        const unsigned frame_size = 2 * image_size;
+        const unsigned off = image_size / 2;
+        vector<input_t> frame(frame_size * frame_size * input_channels);
+        generate_random_data<input_t>(frame.data(), frame.size());
+        const size_t wght_bytes = kernel_size * kernel_size * input_channels * output_channels;
+        vector<input_t> wght_hwio(wght_bytes);
+        generate_random_data<input_t>(wght_hwio.data(), wght_bytes);
+
+        const HostTensor hwc = HostTensor::nhwc(frame.data(), 1, input_channels, image_size, image_size);
+        const HostTensor hwc_roi = HostTensor::nhwc(frame.data(), 1, input_channels, frame_size, frame_size).roi(off, off, image_size, image_size);
+        const HostTensor hwio = HostTensor::hwio(wght_hwio.data(), output_channels, input_channels, kernel_size, kernel_size);
+
+        const vector<tuple<string, HostTensor, bool>> cases = {
+            {"NHWC", hwc, false},
+            {"NHWC ROI", hwc_roi, false},
+            {"HWIO", hwio, true},
+        };
+        for (const auto& [name, tensor, is_wght] : cases) {
+            vector<input_t> dense(tensor.size());
+            float transpose_us = time_us([&] {
+                tensor.copy_to_nchw(dense.data());
+                if (is_wght)
+                    op.copy_data_in(nullptr, 0, dense.data(), dense.size());
+                else
+                    op.copy_data_in(dense.data(), dense.size(), nullptr, 0);
+            }, repetitions);
+            float fused_us = time_us([&] {
+                op.copy_data_in(is_wght ? nullptr : &tensor, is_wght ? &tensor : nullptr);
+            }, repetitions);
+
+            // fused copies of both tensors, checked against the host transposed ones
+            const HostTensor& other = is_wght ? hwc : hwio;
+            vector<input_t> iact_dense(hwc.size()), wght_dense(hwio.size());
+            (is_wght ? hwc : tensor).copy_to_nchw(iact_dense.data());
+            (is_wght ? tensor : hwio).copy_to_nchw(wght_dense.data());
+            spad_zero(recacc_get_buffer(&dev), hwinfo.spad_size);
+            op.copy_data_in(is_wght ? &other : &tensor, is_wght ? &tensor : &other);
+            bool correct = verify(op, iact_dense, wght_dense);
+            all_correct &= correct;
+
+            vt.addRow(image_size, kernel_size, input_channels, output_channels, name, tensor.size() / 1024.0,
+                transpose_us, fused_us, correct ? "correct" : "WRONG");
+        }
+    }
+
+    vt.print(cout);
+    recacc_close(&dev);
+    return all_correct ? 0 : 1;
+}
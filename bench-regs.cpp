@@ -0,0 +1,168 @@
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/cmdqueue.hpp"
+#include "lib/conv2d.hpp"
+#include "lib/utils.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+// ns per job of calling fn once per job
+template<typename F> static float ns_per_job(F fn, unsigned jobs) {
+    auto t1 = timer::now();
+    for (unsigned n = 0; n < jobs; n++)
+        fn();
+    chrono::duration<float, std::nano> duration = timer::now() - t1;
+    return duration.count() / jobs;
+}
+
+// all writable registers a job programs
+static vector<uint32_t> read_job_registers(const recacc_device* dev, const recacc_hwinfo& hwinfo) {
+    vector<uint32_t> regs;
+    regs.push_back(recacc_reg_read(dev, RECACC_REG_IDX_CONTROL));
+    for (int idx = RECACC_REG_IDX_INPUTCHS; idx <= RECACC_REG_IDX_STRIDE_PSUM_OCH; idx++)
+        regs.push_back(recacc_reg_read(dev, idx));
+    for (int n = 0; n < 3 * hwinfo.max_output_channels; n++)
+        regs.push_back(recacc_reg_read(dev, RECACC_REG_IDX_BIAS_REQUANT_BASE + n));
+    return regs;
+}
+
+int main(int argc, char** argv) {
+    string device_name = RECACC_SIM_DEVICE;
+    bool on_device = false;
+    unsigned jobs = 100000;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:mn:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: take hwinfo and layer parameters from this uio device (default: \"" << RECACC_SIM_DEVICE << "\")" << endl;
+                cout << "-m: write the registers of the device instead of host memory, the accelerator is not started" << endl;
+                cout << "-n 100000: jobs per measurement" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'm':
+                on_device = true;
+                break;
+            case 'n':
+                jobs = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    int ret = recacc_open(&dev, device_name.c_str());
+    if (ret)
+        return ret;
+    if (!recacc_verify(&dev, true)) {
+        recacc_close(&dev);
+        return 1;
+    }
+    recacc_hwinfo hwinfo;
+    recacc_get_hwinfo(&dev, &hwinfo);
+
+    // by default the registers are modelled in host memory, which shows the cpu side cost of the write sequences
+    recacc_device host_dev{};
+    vector<uint8_t> host_mem;
+    recacc_device* target = &dev;
+    if (!on_device) {
+        host_mem.resize(RECACC_REG_ADDR(RECACC_REG_IDX_BIAS_REQUANT_BASE + 3 * hwinfo.max_output_channels));
+        host_dev.mem = host_mem.data();
+        host_dev.hw_revision = dev.hw_revision;
+        target = &host_dev;
+    }
+    // starting the accelerator on a device would run it with whatever is in the scratchpad
+    const bool start = !on_device;
+
+    Conv2D op(32, 3, 8, 3, true);
+    op.set_recacc_device(&dev);
+    op.set_hwinfo(hwinfo);
+    op.set_activation_mode(act_relu);
+    op.set_padding_mode(true);
+    op.allocate_spad_auto();
+    op.compute_accelerator_parameters(true);
+    op.set_recacc_device(target);
+
+    vector<psum_t> bias(hwinfo.max_output_channels);
+    vector<float> factors(hwinfo.max_output_channels), zeropoints(hwinfo.max_output_channels);
+    generate_random_data<psum_t>(bias.data(), bias.size());
+    for (size_t n = 0; n < factors.size(); n++) {
+        factors[n] = 0.01f * (n + 1);
+        zeropoints[n] = n;
+    }
+
+    auto write_individually = [&] {
+        op.configure_accelerator();
+        op.set_postproc_data(bias, factors, zeropoints);
+        if (start)
+            op.run_accelerator();
+    };
+
+    recacc_cmdbuf cb;
+    op.record_accelerator_job(cb, bias, factors, zeropoints, start);
+
+    // both ways must leave the same register contents behind
+    recacc_config_invalidate(target);
+    write_individually();
+    vector<uint32_t> expected = read_job_registers(target, hwinfo);
+    memset(host_mem.data(), 0, host_mem.size());
+    recacc_config_invalidate(target);
+    op.run_recorded(cb);
+    bool identical = read_job_registers(target, hwinfo) == expected;
+    cout << "replayed registers " << (identical ? "identical to" : "DIFFERENT from") << " individual writes" << endl;
+
+    cout << op.get_parameter_string() << ", " << recacc_cmdbuf_length(&cb) << " register writes per job in "
+         << static_cast<unsigned>(cb.run_count) << " runs, registers in " << (on_device ? device_name : "host memory") << endl;
+
+    VariadicTable<string, float, float> vt({"register programming", "ns/job", "speed-up"}, 10);
+    float individual = ns_per_job([&] { recacc_config_invalidate(target); write_individually(); }, jobs);
+    vt.addRow("individual writes", individual, 1.0f);
+
+    float shadowed = ns_per_job(write_individually, jobs);
+    vt.addRow("individual, config shadowed", shadowed, individual / shadowed);
+
+    float record = ns_per_job([&] { op.record_accelerator_job(cb, bias, factors, zeropoints, start); op.run_recorded(cb); }, jobs);
+    vt.addRow("record + replay", record, individual / record);
+
+    float replay = ns_per_job([&] { op.run_recorded(cb); }, jobs);
+    vt.addRow("replay", replay, individual / replay);
+
+    // only the caller side is measured, the submission thread replays concurrently
+    {
+        CommandQueue queue(target);
+        vector<future<void>> done;
+        done.reserve(jobs);
+        float submit = ns_per_job([&] { done.push_back(queue.submit(&cb)); }, jobs);
+        queue.wait_idle();
+        vt.addRow("submission thread (caller)", submit, individual / submit);
+    }
+    vt.print(cout);
+
+    if (on_device)
+        recacc_control_stop(&dev);
+    recacc_close(&dev);
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/spadcopy.hpp"
+#include "lib/utils.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+static const size_t word_size = 8;
+
+// the copy of one scratchpad column as done by Conv2D before the copy kernels were introduced
+static void reference_copy_column(int8_t* dst, const int8_t* buf, size_t col_bytes, size_t col_bytes_buf, size_t bytes_avail) {
+    size_t col_bytes_buf_aligned = make_multiple_of(word_size, col_bytes_buf);
+    if (bytes_avail >= col_bytes_buf_aligned)
+        copy(buf, buf + col_bytes_buf_aligned, dst);
+    else {
+        vector<int8_t> tmp(col_bytes_buf_aligned, 0);
+        copy(buf, buf + col_bytes_buf, tmp.begin());
+        copy(tmp.begin(), tmp.end(), dst);
+    }
+    fill(dst + col_bytes_buf, dst + col_bytes, 0);
+}
+
+static void kernel_copy_column(int8_t* dst, const int8_t* buf, size_t col_bytes, size_t col_bytes_buf, size_t bytes_avail) {
+    size_t col_bytes_buf_aligned = make_multiple_of(word_size, col_bytes_buf);
+    spad_copy_in(dst, buf, bytes_avail >= col_bytes_buf_aligned ? col_bytes_buf_aligned : col_bytes_buf, col_bytes_buf_aligned);
+    spad_zero(dst + col_bytes_buf, col_bytes - col_bytes_buf);
+}
+
+// the copy of output channels as done by Conv2D::copy_data_out before the copy kernels were introduced
+static void reference_copy_out(int8_t* dst, const int8_t* spad, size_t bytes_per_channel, unsigned channels, size_t column_stride) {
+    for (unsigned och = 0; och < channels; och++) {
+        const int8_t* psum_addr = spad + och * column_stride;
+        if (reinterpret_cast<uint64_t>(psum_addr) % 4 || reinterpret_cast<uint64_t>(dst) % 4) {
+            for (size_t n = 0; n < bytes_per_channel; n++)
+                dst[n] = psum_addr[n];
+        } else {
+            const uint32_t* psum_addr32 = reinterpret_cast<const uint32_t*>(psum_addr);
+            uint32_t* dst32 = reinterpret_cast<uint32_t*>(dst);
+            for (size_t n = 0; n < (bytes_per_channel + 3) / 4; n++)
+                dst32[n] = psum_addr32[n];
+        }
+        dst += bytes_per_channel;
+    }
+}
+
+static void kernel_copy_out(int8_t* dst, const int8_t* spad, size_t bytes_per_channel, unsigned channels, size_t column_stride) {
+    for (unsigned och = 0; och < channels; och++) {
+        spad_copy_out(dst, spad + och * column_stride, bytes_per_channel);
+        dst += bytes_per_channel;
+    }
+}
+
+// compare the copy with the current spad_copy_mode to the reference on random column sizes, buffer sizes and alignments
+static size_t verify(int8_t* spad, size_t spad_size, unsigned cases) {
+    const size_t max_bytes = 4096;
+    vector<int8_t> src(max_bytes + 64), expected(spad_size), actual(spad_size);
+    generate_random_data<int8_t>(src.data(), src.size());
+
+    size_t mismatches = 0;
+    for (unsigned n = 0; n < cases; n++) {
+        size_t col_bytes = mtrnd() % max_bytes + 1;
+        size_t col_bytes_buf = mtrnd() % (col_bytes + 1);
+        size_t bytes_avail = col_bytes_buf + mtrnd() % 16;
+        size_t src_offset = mtrnd() % 32;
+        size_t dst_offset = (mtrnd() % 64) * word_size;
+
+        memset(spad, 0x5a, spad_size);
+        reference_copy_column(spad + dst_offset, src.data() + src_offset, col_bytes, col_bytes_buf, bytes_avail);
+        memcpy(expected.data(), spad, spad_size);
+
+        memset(spad, 0x5a, spad_size);
+        kernel_copy_column(spad + dst_offset, src.data() + src_offset, col_bytes, col_bytes_buf, bytes_avail);
+        memcpy(actual.data(), spad, spad_size);
+
+        if (expected != actual) {
+            if (!mismatches)
+                cerr << "mismatch: col_bytes " << col_bytes << " col_bytes_buf " << col_bytes_buf << " bytes_avail " << bytes_avail
+                     << " src_offset " << src_offset << " dst_offset " << dst_offset << endl;
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// MB/s of copying bytes with fn
+template<typename F> static float throughput(F fn, size_t bytes, unsigned repetitions) {
+    auto t1 = timer::now();
+    for (unsigned n = 0; n < repetitions; n++)
+        fn();
+    chrono::duration<float, std::micro> duration = timer::now() - t1;
+    return bytes * repetitions / duration.count();
+}
+
+int main(int argc, char** argv) {
+    string device_name;
+    unsigned repetitions = 1000;
+    unsigned cases = 10000;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:n:v:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: copy into the scratchpad of this uio device (\"" << RECACC_SIM_DEVICE << "\" for simulation, default: host memory)" << endl;
+                cout << "-n 1000: repetitions per measurement" << endl;
+                cout << "-v 10000: number of random cases compared to the reference copy" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case 'v':
+                cases = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    vector<int8_t> host_spad;
+    int8_t* spad;
+    size_t spad_size;
+    if (device_name.empty()) {
+        spad_size = 512 * 1024;
+        host_spad.resize(spad_size + 64);
+        spad = reinterpret_cast<int8_t*>(make_multiple_of(64, reinterpret_cast<uintptr_t>(host_spad.data())));
+    } else {
+        int ret = recacc_open(&dev, device_name.c_str());
+        if (ret)
+            return ret;
+        if (!recacc_verify(&dev, true)) {
+            recacc_close(&dev);
+            return 1;
+        }
+        recacc_hwinfo hwinfo;
+        recacc_get_hwinfo(&dev, &hwinfo);
+        spad = static_cast<int8_t*>(recacc_get_buffer(&dev));
+        spad_size = hwinfo.spad_size;
+    }
+
+    const enum spad_copy_mode default_mode = get_spad_copy_mode();
+    cout << "aligned copy kernels use " << spad_copy_isa() << ", default mode is " << (default_mode == spad_copy_aligned ? "aligned" : "plain") << endl;
+    size_t mismatches = 0;
+    for (enum spad_copy_mode mode : {spad_copy_plain, spad_copy_aligned}) {
+        set_spad_copy_mode(mode);
+        size_t mode_mismatches = verify(spad, min<size_t>(spad_size, 8192), cases);
+        cout << (mode == spad_copy_aligned ? "aligned: " : "plain: ") << cases - mode_mismatches << " of " << cases
+             << " random cases identical to the reference copy" << endl;
+        mismatches += mode_mismatches;
+    }
+
+    // column sizes of typical iact (HxW x channels per column) and weight (RxS x channels per column) copies
+    VariadicTable<int, int, float, float, float, float> vt({"bytes", "src offset", "reference MB/s", "plain MB/s", "aligned MB/s", "aligned speed-up"}, 10);
+    vector<int8_t> src(64 * 1024 + 64);
+    generate_random_data<int8_t>(src.data(), src.size());
+    for (size_t bytes : {72, 200, 256, 1152, 4096, 16384, 65536}) {
+        for (size_t src_offset : {0, 3}) {
+            const int8_t* buf = src.data() + src_offset;
+            size_t aligned = make_multiple_of(word_size, bytes);
+            float ref = throughput([&] { reference_copy_column(spad, buf, aligned, bytes, bytes); }, bytes, repetitions);
+            set_spad_copy_mode(spad_copy_plain);
+            float plain = throughput([&] { kernel_copy_column(spad, buf, aligned, bytes, bytes); }, bytes, repetitions);
+            set_spad_copy_mode(spad_copy_aligned);
+            float krn = throughput([&] { kernel_copy_column(spad, buf, aligned, bytes, bytes); }, bytes, repetitions);
+            vt.addRow(bytes, src_offset, ref, plain, krn, krn / ref);
+        }
+    }
+    vt.print(cout);
+
+    // output channels of the testsuite shapes, int32 psums and int8 after requantization
+    const unsigned channels = 8;
+    const size_t column_stride = spad_size / word_size;
+    VariadicTable<string, int, float, float, float, float> vt_out({"output", "bytes/och", "old MB/s", "plain MB/s", "aligned MB/s", "aligned speed-up"}, 10);
+    for (unsigned size : {14, 30, 62, 126}) {
+        for (size_t pixel_bytes : {1, 4}) {
+            size_t bytes = size * size * pixel_bytes;
+            if (bytes > column_stride)
+                continue;
+            vector<int8_t> out(bytes * channels + 4), ref(bytes * channels + 4);
+            reference_copy_out(ref.data(), spad, bytes, channels, column_stride);
+            float rates[2];
+            for (enum spad_copy_mode mode : {spad_copy_plain, spad_copy_aligned}) {
+                set_spad_copy_mode(mode);
+                fill(out.begin(), out.end(), 0);
+                kernel_copy_out(out.data(), spad, bytes, channels, column_stride);
+                if (!equal(out.begin(), out.begin() + bytes * channels, ref.begin())) {
+                    cerr << (mode == spad_copy_aligned ? "aligned" : "plain") << " copy-out mismatch for " << bytes << " bytes per channel" << endl;
+                    mismatches++;
+                }
+                rates[mode] = throughput([&] { kernel_copy_out(out.data(), spad, bytes, channels, column_stride); }, bytes * channels, repetitions);
+            }
+
+            float old_rate = throughput([&] { reference_copy_out(ref.data(), spad, bytes, channels, column_stride); }, bytes * channels, repetitions);
+            vt_out.addRow(to_string(size) + "x" + to_string(size) + (pixel_bytes == 1 ? " int8" : " int32"), bytes, old_rate,
+                          rates[spad_copy_plain], rates[spad_copy_aligned], rates[spad_copy_aligned] / old_rate);
+        }
+    }
+    vt_out.print(cout);
+    set_spad_copy_mode(default_mode);
+
+    if (!device_name.empty())
+        recacc_close(&dev);
+    return mismatches ? 1 : 0;
+}
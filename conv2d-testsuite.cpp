@@ -163,21 +163,24 @@ int main(int argc, char** argv) {
     string files_path;
     string output_path;
 
-    while ((c = getopt (argc, argv, "hlt:")) != -1)
+    while ((c = getopt (argc, argv, "hd:lt:")) != -1)
         switch (c) {
             case 'h':
                 cout << "Usage:" << endl;
                 cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
                 cout << "-l: list all built-in tests" << endl;
                 cout << "-t <test1,test2>: only run specific tests" << endl;
                 return 0;
                 break;
+            case 'd':
+                device_name = string(optarg);
+                break;
             case 'l':
                 list_tests();
                 return 0;
                 break;
             case 't': {
-                device_name = string(optarg);
                 std::istringstream iss(string{optarg});
                 std::string s;
                 while (std::getline(iss, s, ',')) {
@@ -255,6 +258,9 @@ int main(int argc, char** argv) {
     // print a nice result table
     vt.print(cout);
 
+    if (!dryrun)
+        cout << "Skipped " << recacc_config_skipped_writes(&dev) << " unchanged configuration register writes" << endl;
+
     if (!dryrun)
         ret = recacc_close(&dev);
 
@@ -4,6 +4,10 @@ int recacc_open(recacc_device* dev, void* addr) {
     dev->fd = 0;
     dev->mem = addr;
     dev->hw_revision = 0;
+    dev->irq_thread = 0;
+    dev->sim = 0;
+    dev->shadow_valid = false;
+    dev->skipped_writes = 0;
 
     return 0;
 }
@@ -0,0 +1,596 @@
+#define _GNU_SOURCE
+
+#include "cdma.h"
+#include "defs.h"
+
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// AXI CDMA register map (PG034), byte offsets
+#define CDMA_MAP_SIZE        0x10000
+#define CDMA_REG_CR          0x00
+#define CDMA_REG_SR          0x04
+#define CDMA_REG_CURDESC     0x08
+#define CDMA_REG_CURDESC_MSB 0x0C
+#define CDMA_REG_TAILDESC    0x10
+#define CDMA_REG_TAILDESC_MSB 0x14
+#define CDMA_REG_SA          0x18
+#define CDMA_REG_SA_MSB      0x1C
+#define CDMA_REG_DA          0x20
+#define CDMA_REG_DA_MSB      0x24
+#define CDMA_REG_BTT         0x28
+#define CDMA_REG_COUNT       11
+
+#define CDMA_CR_RESET        (1u << 2)
+#define CDMA_CR_SGMODE       (1u << 3)
+#define CDMA_CR_IOC_IRQ_EN   (1u << 12)
+#define CDMA_CR_DLY_IRQ_EN   (1u << 13)
+#define CDMA_CR_ERR_IRQ_EN   (1u << 14)
+#define CDMA_CR_IRQ_THRESHOLD_SHIFT 16
+#define CDMA_CR_IRQ_DELAY_SHIFT     24
+
+#define CDMA_SR_IDLE         (1u << 1)
+#define CDMA_SR_SG_INCLD     (1u << 3)
+#define CDMA_SR_DMA_DEC_ERR  (1u << 6)
+#define CDMA_SR_ERR_MASK     0x770 // dma and sg internal, slave and decode errors
+#define CDMA_SR_IOC_IRQ      (1u << 12)
+#define CDMA_SR_DLY_IRQ      (1u << 13)
+#define CDMA_SR_ERR_IRQ      (1u << 14)
+#define CDMA_SR_IRQ_MASK     (CDMA_SR_IOC_IRQ | CDMA_SR_DLY_IRQ | CDMA_SR_ERR_IRQ)
+
+#define CDMA_DESC_CMPLT      (1u << 31)
+#define CDMA_DESC_ERR_MASK   (7u << 28)
+
+#define CDMA_MAX_BTT         ((1u << 23) - 64) // default buffer length register width, kept burst aligned
+#define CDMA_MAX_THRESHOLD   255
+#define CDMA_RESET_TIMEOUT_US 10000
+
+struct recacc_cdma_model {
+    const recacc_device* dev;
+    uint32_t regs[CDMA_REG_COUNT];
+};
+
+static inline uint32_t _cdma_read(const recacc_cdma* cdma, unsigned offset) {
+    return cdma->regs[offset / 4];
+}
+
+static void _cdma_model_write(recacc_cdma* cdma, unsigned offset, uint32_t value);
+
+static inline void _cdma_write(recacc_cdma* cdma, unsigned offset, uint32_t value) {
+    if (cdma->model)
+        _cdma_model_write(cdma, offset, value);
+    else
+        cdma->regs[offset / 4] = value;
+}
+
+static inline uint64_t _cdma_desc_phys(const recacc_cdma* cdma, size_t index) {
+    return cdma->desc.phys + index * sizeof(recacc_cdma_desc);
+}
+
+static inline volatile recacc_cdma_desc* _cdma_desc(const recacc_cdma* cdma, size_t index) {
+    return (volatile recacc_cdma_desc*)cdma->desc.virt + index;
+}
+
+// register model
+
+// bus address to host pointer: the scratchpad window maps to the simulated device,
+// everything else is memory from recacc_dma_buffer_open(RECACC_SIM_DEVICE) where phys equals virt
+static void* _cdma_model_translate(const recacc_cdma* cdma, uint64_t addr, size_t bytes) {
+    if (addr >= cdma->spad_phys && addr < cdma->spad_phys + RECACC_MEM_OFFSET_REGS) {
+        if (addr + bytes > cdma->spad_phys + RECACC_MEM_OFFSET_REGS)
+            return NULL;
+        return (uint8_t*)cdma->model->dev->mem + RECACC_MEM_OFFSET_SPAD + (addr - cdma->spad_phys);
+    }
+    // the register file and unmapped parts of the accelerator window answer with decode errors
+    if (!addr || (addr >= RECACC_PHYS_BASE && addr < RECACC_PHYS_BASE + RECACC_MEM_MAP_SIZE))
+        return NULL;
+    return (void*)(uintptr_t)addr;
+}
+
+static void _cdma_model_reset(struct recacc_cdma_model* model) {
+    memset(model->regs, 0, sizeof(model->regs));
+    model->regs[CDMA_REG_CR / 4] = 1u << CDMA_CR_IRQ_THRESHOLD_SHIFT;
+    model->regs[CDMA_REG_SR / 4] = CDMA_SR_IDLE | CDMA_SR_SG_INCLD;
+}
+
+static inline uint64_t _cdma_model_reg64(const struct recacc_cdma_model* model, unsigned offset) {
+    return (uint64_t)model->regs[offset / 4 + 1] << 32 | model->regs[offset / 4];
+}
+
+// returns false and flags a decode error if an address is not backed by memory
+static bool _cdma_model_copy(recacc_cdma* cdma, uint64_t src, uint64_t dst, uint32_t bytes) {
+    void* from = _cdma_model_translate(cdma, src, bytes);
+    void* to = _cdma_model_translate(cdma, dst, bytes);
+    if (!from || !to) {
+        cdma->model->regs[CDMA_REG_SR / 4] |= CDMA_SR_DMA_DEC_ERR | CDMA_SR_ERR_IRQ;
+        return false;
+    }
+    memmove(to, from, bytes);
+    return true;
+}
+
+// walk the descriptors from CURDESC up to and including TAILDESC
+static void _cdma_model_run_chain(recacc_cdma* cdma) {
+    struct recacc_cdma_model* model = cdma->model;
+    uint64_t current = _cdma_model_reg64(model, CDMA_REG_CURDESC);
+    const uint64_t tail = _cdma_model_reg64(model, CDMA_REG_TAILDESC);
+    unsigned completed = 0;
+
+    while (1) {
+        recacc_cdma_desc* desc = _cdma_model_translate(cdma, current, sizeof(*desc));
+        if (!desc || current % sizeof(recacc_cdma_desc)) {
+            model->regs[CDMA_REG_SR / 4] |= (1u << 10) | CDMA_SR_ERR_IRQ; // SGDecErr
+            break;
+        }
+
+        uint64_t src = (uint64_t)desc->src_addr_msb << 32 | desc->src_addr;
+        uint64_t dst = (uint64_t)desc->dst_addr_msb << 32 | desc->dst_addr;
+        if (!_cdma_model_copy(cdma, src, dst, desc->control & 0x3FFFFFF)) {
+            desc->status = CDMA_DESC_CMPLT | (1u << 30); // DMADecErr
+            break;
+        }
+        desc->status = CDMA_DESC_CMPLT | (desc->control & 0x3FFFFFF);
+        completed++;
+
+        model->regs[CDMA_REG_CURDESC / 4] = current;
+        model->regs[CDMA_REG_CURDESC_MSB / 4] = current >> 32;
+        if (current == tail)
+            break;
+        current = (uint64_t)desc->next_desc_msb << 32 | desc->next_desc;
+    }
+
+    if (completed)
+        model->regs[CDMA_REG_SR / 4] |= CDMA_SR_IOC_IRQ;
+}
+
+static void _cdma_model_write(recacc_cdma* cdma, unsigned offset, uint32_t value) {
+    struct recacc_cdma_model* model = cdma->model;
+    uint32_t* regs = model->regs;
+
+    switch (offset) {
+        case CDMA_REG_CR:
+            if (value & CDMA_CR_RESET)
+                _cdma_model_reset(model);
+            else
+                regs[CDMA_REG_CR / 4] = value;
+            break;
+        case CDMA_REG_SR:
+            // interrupt flags are write-1-to-clear, all other bits are read-only
+            regs[CDMA_REG_SR / 4] &= ~(value & CDMA_SR_IRQ_MASK);
+            break;
+        case CDMA_REG_TAILDESC:
+            regs[CDMA_REG_TAILDESC / 4] = value;
+            if (regs[CDMA_REG_CR / 4] & CDMA_CR_SGMODE) {
+                // transfers complete instantly, so the engine is idle again before the write returns
+                regs[CDMA_REG_SR / 4] &= ~CDMA_SR_IDLE;
+                _cdma_model_run_chain(cdma);
+                regs[CDMA_REG_SR / 4] |= CDMA_SR_IDLE;
+            }
+            break;
+        case CDMA_REG_BTT:
+            regs[CDMA_REG_BTT / 4] = value;
+            if (!(regs[CDMA_REG_CR / 4] & CDMA_CR_SGMODE)
+                    && _cdma_model_copy(cdma, _cdma_model_reg64(model, CDMA_REG_SA), _cdma_model_reg64(model, CDMA_REG_DA), value))
+                regs[CDMA_REG_SR / 4] |= CDMA_SR_IOC_IRQ;
+            break;
+        default:
+            if (offset / 4 < CDMA_REG_COUNT)
+                regs[offset / 4] = value;
+    }
+}
+
+// dma buffers
+
+static int _read_sysfs_u64(const char* dir, const char* name, uint64_t* value) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/%s", dir, name);
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        printf("Failed to open %s: %s\n", path, strerror(errno));
+        return errno;
+    }
+    int ret = fscanf(f, "%" SCNi64, value) == 1 ? 0 : EINVAL;
+    fclose(f);
+    return ret;
+}
+
+int recacc_dma_buffer_open(recacc_dma_buffer* buf, const char* name, size_t size) {
+    buf->fd = -1;
+    buf->sim = strcmp(name, RECACC_SIM_DEVICE) == 0;
+
+    if (buf->sim) {
+        buf->virt = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buf->virt == MAP_FAILED) {
+            printf("Failed to allocate dma buffer: %s\n", strerror(errno));
+            buf->virt = NULL;
+            return ENOMEM;
+        }
+        buf->phys = (uintptr_t)buf->virt;
+        buf->size = size;
+
+        // the register model could not tell this buffer from the scratchpad window
+        if (buf->phys < RECACC_PHYS_BASE + RECACC_MEM_MAP_SIZE && buf->phys + size > RECACC_PHYS_BASE) {
+            recacc_dma_buffer_close(buf);
+            return EADDRINUSE;
+        }
+        return 0;
+    }
+
+    char dev_name[PATH_MAX];
+    strncpy(dev_name, name, sizeof(dev_name) - 1);
+    dev_name[sizeof(dev_name) - 1] = 0;
+    const char* dir = basename(dev_name);
+
+    uint64_t phys, buf_size;
+    int ret = _read_sysfs_u64(dir, "phys_addr", &phys);
+    if (!ret)
+        ret = _read_sysfs_u64(dir, "size", &buf_size);
+    if (ret)
+        return ret;
+
+    // O_SYNC maps the buffer uncached, the CDMA does not snoop the cpu caches
+    buf->fd = open(name, O_RDWR | O_SYNC);
+    if (buf->fd == -1) {
+        printf("Failed to open %s: %s\n", name, strerror(errno));
+        return errno;
+    }
+
+    buf->virt = mmap(NULL, buf_size, PROT_READ | PROT_WRITE, MAP_SHARED, buf->fd, 0);
+    if (buf->virt == MAP_FAILED) {
+        int err = errno;
+        printf("Failed to map dma buffer: %s\n", strerror(err));
+        buf->virt = NULL;
+        recacc_dma_buffer_close(buf);
+        return err;
+    }
+    buf->phys = phys;
+    buf->size = buf_size;
+
+    return 0;
+}
+
+int recacc_dma_buffer_close(recacc_dma_buffer* buf) {
+    int ret = 0;
+
+    if (buf->virt && (buf->fd != -1 || buf->sim)) {
+        ret = munmap(buf->virt, buf->size);
+        if (ret)
+            return ret;
+    }
+    buf->virt = NULL;
+
+    if (buf->fd != -1) {
+        ret = close(buf->fd);
+        if (ret)
+            return ret;
+        buf->fd = -1;
+    }
+
+    return ret;
+}
+
+int recacc_dma_buffer_slice(recacc_dma_buffer* slice, const recacc_dma_buffer* buf, size_t offset, size_t size) {
+    if (offset > buf->size || size > buf->size - offset)
+        return EINVAL;
+
+    slice->virt = (uint8_t*)buf->virt + offset;
+    slice->phys = buf->phys + offset;
+    slice->size = size;
+    slice->fd = -1;
+    slice->sim = false; // slices never own the mapping
+    return 0;
+}
+
+uint64_t recacc_dma_buffer_phys(const recacc_dma_buffer* buf, const void* ptr, size_t bytes) {
+    const uint8_t* p = ptr;
+    const uint8_t* base = buf->virt;
+    if (!base || p < base || p > base + buf->size || bytes > (size_t)(base + buf->size - p))
+        return 0;
+    return buf->phys + (p - base);
+}
+
+// cdma
+
+int recacc_cdma_open(recacc_cdma* cdma, const char* uio_name, const recacc_device* dev, const recacc_dma_buffer* desc_mem) {
+    memset(cdma, 0, sizeof(*cdma));
+    cdma->fd = -1;
+    cdma->spad_phys = RECACC_PHYS_BASE + RECACC_MEM_OFFSET_SPAD;
+    cdma->desc = *desc_mem;
+    cdma->desc.fd = -1;
+    cdma->desc.sim = false;
+
+    if (desc_mem->phys % sizeof(recacc_cdma_desc) || (uintptr_t)desc_mem->virt % sizeof(recacc_cdma_desc)) {
+        printf("CDMA descriptor memory must be %zu-byte aligned\n", sizeof(recacc_cdma_desc));
+        return EINVAL;
+    }
+    cdma->desc_capacity = desc_mem->size / sizeof(recacc_cdma_desc);
+
+    if (strcmp(uio_name, RECACC_SIM_DEVICE) == 0) {
+        if (!dev->sim) {
+            printf("The CDMA register model requires a simulated accelerator\n");
+            return EINVAL;
+        }
+
+        cdma->model = calloc(1, sizeof(*cdma->model));
+        if (!cdma->model)
+            return ENOMEM;
+        cdma->model->dev = dev;
+        cdma->regs = cdma->model->regs;
+        cdma->addr_width = 64;
+        _cdma_model_reset(cdma->model);
+        return 0;
+    }
+
+    cdma->fd = open(uio_name, O_RDWR);
+    if (cdma->fd == -1) {
+        printf("Failed to open %s: %s\n", uio_name, strerror(errno));
+        return errno;
+    }
+
+    void* regs = mmap(NULL, CDMA_MAP_SIZE, PROT_WRITE | PROT_READ, MAP_SHARED, cdma->fd, 0);
+    if (regs == MAP_FAILED) {
+        int err = errno;
+        printf("Failed to map CDMA registers: %s\n", strerror(err));
+        recacc_cdma_close(cdma);
+        return err;
+    }
+    cdma->regs = regs;
+    cdma->addr_width = 32; // xlnx,addrwidth in the device tree
+
+    // re-arm the uio interrupt, a previous user may have left it masked
+    uint32_t enable = 1;
+    if (write(cdma->fd, &enable, sizeof(enable)) != sizeof(enable))
+        printf("Failed to enable CDMA interrupt: %s\n", strerror(errno));
+
+    int ret = recacc_cdma_reset(cdma);
+    if (ret) {
+        printf("CDMA does not leave reset\n");
+        recacc_cdma_close(cdma);
+        return ret;
+    }
+
+    if (!(_cdma_read(cdma, CDMA_REG_SR) & CDMA_SR_SG_INCLD)) {
+        printf("CDMA was built without scatter-gather support\n");
+        recacc_cdma_close(cdma);
+        return ENOTSUP;
+    }
+
+    return 0;
+}
+
+int recacc_cdma_close(recacc_cdma* cdma) {
+    int ret = 0;
+
+    if (cdma->busy)
+        recacc_cdma_wait(cdma, POLL_TIMEOUT_US);
+
+    if (cdma->model) {
+        free(cdma->model);
+        cdma->model = NULL;
+    } else if (cdma->regs) {
+        ret = munmap((void*)cdma->regs, CDMA_MAP_SIZE);
+        if (ret)
+            return ret;
+    }
+    cdma->regs = NULL;
+
+    if (cdma->fd != -1) {
+        ret = close(cdma->fd);
+        if (ret)
+            return ret;
+        cdma->fd = -1;
+    }
+
+    return ret;
+}
+
+int recacc_cdma_reset(recacc_cdma* cdma) {
+    _cdma_write(cdma, CDMA_REG_CR, CDMA_CR_RESET);
+
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 10000 };
+    for (unsigned waited = 0; _cdma_read(cdma, CDMA_REG_CR) & CDMA_CR_RESET; waited += 10) {
+        if (waited >= CDMA_RESET_TIMEOUT_US)
+            return ETIMEDOUT;
+        nanosleep(&ts, NULL);
+    }
+
+    cdma->busy = false;
+    return 0;
+}
+
+void recacc_cdma_chain_clear(recacc_cdma* cdma) {
+    if (!cdma->busy)
+        cdma->desc_count = 0;
+}
+
+int recacc_cdma_chain_add(recacc_cdma* cdma, uint64_t src, uint64_t dst, size_t bytes) {
+    if (cdma->busy)
+        return EBUSY;
+
+    if (bytes == 0)
+        return 0;
+
+    if (cdma->addr_width < 64) {
+        const uint64_t limit = 1ull << cdma->addr_width;
+        if (src >= limit || dst >= limit || bytes > limit - src || bytes > limit - dst)
+            return EINVAL;
+    }
+
+    // extend the previous descriptor if this transfer continues it on both sides
+    volatile recacc_cdma_desc* last = NULL;
+    size_t merged = 0;
+    if (cdma->desc_count) {
+        last = _cdma_desc(cdma, cdma->desc_count - 1);
+        uint64_t last_src = (uint64_t)last->src_addr_msb << 32 | last->src_addr;
+        uint64_t last_dst = (uint64_t)last->dst_addr_msb << 32 | last->dst_addr;
+        uint32_t last_bytes = last->control;
+        if (last_src + last_bytes == src && last_dst + last_bytes == dst && last_bytes < CDMA_MAX_BTT)
+            merged = CDMA_MAX_BTT - last_bytes < bytes ? CDMA_MAX_BTT - last_bytes : bytes;
+    }
+
+    // all or nothing, callers flush the chain and retry on ENOSPC
+    size_t needed = (bytes - merged + CDMA_MAX_BTT - 1) / CDMA_MAX_BTT;
+    if (needed > cdma->desc_capacity - cdma->desc_count)
+        return ENOSPC;
+
+    if (merged) {
+        last->control += merged;
+        src += merged;
+        dst += merged;
+        bytes -= merged;
+    }
+
+    while (bytes) {
+        size_t chunk = bytes > CDMA_MAX_BTT ? CDMA_MAX_BTT : bytes;
+        volatile recacc_cdma_desc* desc = _cdma_desc(cdma, cdma->desc_count++);
+        desc->src_addr = src;
+        desc->src_addr_msb = src >> 32;
+        desc->dst_addr = dst;
+        desc->dst_addr_msb = dst >> 32;
+        desc->control = chunk;
+        desc->status = 0;
+
+        src += chunk;
+        dst += chunk;
+        bytes -= chunk;
+    }
+
+    return 0;
+}
+
+size_t recacc_cdma_chain_length(const recacc_cdma* cdma) {
+    return cdma->desc_count;
+}
+
+uint64_t recacc_cdma_spad_addr(const recacc_cdma* cdma, size_t offset) {
+    return cdma->spad_phys + offset;
+}
+
+int recacc_cdma_start(recacc_cdma* cdma) {
+    if (cdma->busy)
+        return EBUSY;
+
+    if (cdma->desc_count == 0)
+        return 0;
+
+    if (!(_cdma_read(cdma, CDMA_REG_SR) & CDMA_SR_IDLE))
+        return EBUSY;
+
+    // link the chain, the tail's next pointer is never followed
+    for (size_t n = 0; n < cdma->desc_count; n++) {
+        volatile recacc_cdma_desc* desc = _cdma_desc(cdma, n);
+        uint64_t next = _cdma_desc_phys(cdma, n + 1 < cdma->desc_count ? n + 1 : 0);
+        desc->next_desc = next;
+        desc->next_desc_msb = next >> 32;
+        desc->status = 0;
+    }
+    __sync_synchronize();
+
+    // leaving and re-entering sg mode makes the engine fetch from CURDESC again (like the xilinx_dma driver)
+    // coalesce the completion interrupt over the chain, the delay timer covers the remainder
+    unsigned threshold = cdma->desc_count < CDMA_MAX_THRESHOLD ? cdma->desc_count : CDMA_MAX_THRESHOLD;
+    uint32_t cr = CDMA_CR_IOC_IRQ_EN | CDMA_CR_DLY_IRQ_EN | CDMA_CR_ERR_IRQ_EN
+        | threshold << CDMA_CR_IRQ_THRESHOLD_SHIFT | 1u << CDMA_CR_IRQ_DELAY_SHIFT;
+    _cdma_write(cdma, CDMA_REG_CR, cr);
+    _cdma_write(cdma, CDMA_REG_CR, cr | CDMA_CR_SGMODE);
+    _cdma_write(cdma, CDMA_REG_SR, CDMA_SR_IRQ_MASK);
+
+    uint64_t head = _cdma_desc_phys(cdma, 0);
+    uint64_t tail = _cdma_desc_phys(cdma, cdma->desc_count - 1);
+    _cdma_write(cdma, CDMA_REG_CURDESC_MSB, head >> 32);
+    _cdma_write(cdma, CDMA_REG_CURDESC, head);
+    _cdma_write(cdma, CDMA_REG_TAILDESC_MSB, tail >> 32);
+    cdma->busy = true;
+    _cdma_write(cdma, CDMA_REG_TAILDESC, tail); // starts the transfer
+
+    return 0;
+}
+
+// returns 0 if done, EINPROGRESS if still running and EIO if the transfer failed
+static int _cdma_check(recacc_cdma* cdma) {
+    uint32_t sr = _cdma_read(cdma, CDMA_REG_SR);
+    if (sr & CDMA_SR_ERR_MASK)
+        return EIO;
+
+    uint32_t status = _cdma_desc(cdma, cdma->desc_count - 1)->status;
+    if (status & CDMA_DESC_ERR_MASK)
+        return EIO;
+
+    return (sr & CDMA_SR_IDLE) && (status & CDMA_DESC_CMPLT) ? 0 : EINPROGRESS;
+}
+
+bool recacc_cdma_busy(recacc_cdma* cdma) {
+    if (!cdma->busy)
+        return false;
+
+    if (_cdma_check(cdma) == EINPROGRESS)
+        return true;
+
+    recacc_cdma_wait(cdma, 0);
+    return false;
+}
+
+int recacc_cdma_wait(recacc_cdma* cdma, uint32_t timeout_us) {
+    if (!cdma->busy)
+        return 0;
+
+    struct timespec now, end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    end.tv_sec += timeout_us / 1000000;
+    end.tv_nsec += (timeout_us % 1000000) * 1000L;
+    if (end.tv_nsec >= 1000000000L) {
+        end.tv_sec++;
+        end.tv_nsec -= 1000000000L;
+    }
+
+    int ret;
+    while ((ret = _cdma_check(cdma)) == EINPROGRESS) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t remaining_us = (end.tv_sec - now.tv_sec) * 1000000LL + (end.tv_nsec - now.tv_nsec) / 1000;
+        if (remaining_us <= 0)
+            return ETIMEDOUT;
+
+        if (cdma->fd == -1) {
+            struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000 };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        // block on the uio interrupt, then acknowledge it and re-arm
+        struct pollfd pfd = { .fd = cdma->fd, .events = POLLIN };
+        struct timespec ts = { .tv_sec = remaining_us / 1000000, .tv_nsec = (remaining_us % 1000000) * 1000L };
+        if (ppoll(&pfd, 1, &ts, NULL) > 0 && (pfd.revents & POLLIN)) {
+            uint32_t irq_count;
+            if (read(cdma->fd, &irq_count, sizeof(irq_count)) != sizeof(irq_count))
+                return EIO;
+            _cdma_write(cdma, CDMA_REG_SR, CDMA_SR_IRQ_MASK);
+            uint32_t enable = 1;
+            if (write(cdma->fd, &enable, sizeof(enable)) != sizeof(enable))
+                return EIO;
+        }
+    }
+
+    _cdma_write(cdma, CDMA_REG_SR, CDMA_SR_IRQ_MASK);
+    cdma->busy = false;
+    if (ret) {
+        // the engine halts on errors and only recovers through a reset
+        recacc_cdma_reset(cdma);
+        return ret;
+    }
+
+    return 0;
+}
+
+int recacc_cdma_get_fd(const recacc_cdma* cdma) {
+    return cdma->fd;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+
+// scatter-gather transfers between pinned host memory and the scratchpad using the AXI CDMA
+// next to the accelerator (see devicetree/zcu104-uio-cdma.dtsi, which exposes it as generic-uio).
+// a chain of descriptors is built in dma-capable memory, started asynchronously and completion is
+// signalled by the CDMA interrupt. opening RECACC_SIM_DEVICE selects a userspace model of the CDMA
+// register interface instead, which executes chains against a simulated accelerator and ordinary memory.
+
+// physically contiguous, dma-capable host memory (e.g. provided by the u-dma-buf kernel module)
+typedef struct {
+    void*    virt;
+    uint64_t phys;
+    size_t   size;
+    int      fd;   // -1 for slices and simulated buffers
+    bool     sim;  // allocated for the register model, phys equals virt
+} recacc_dma_buffer;
+
+// scatter-gather descriptor as defined by the AXI CDMA (PG034), 64-byte aligned
+typedef struct {
+    uint32_t next_desc;
+    uint32_t next_desc_msb;
+    uint32_t src_addr;
+    uint32_t src_addr_msb;
+    uint32_t dst_addr;
+    uint32_t dst_addr_msb;
+    uint32_t control;       // bytes to transfer
+    uint32_t status;
+    uint32_t reserved[8];
+} recacc_cdma_desc;
+
+// userspace register model state, see cdma.c
+struct recacc_cdma_model;
+
+typedef struct {
+    int fd;                   // uio device of the CDMA, signals completion
+    volatile uint32_t* regs;
+    uint64_t spad_phys;       // bus address of the accelerator scratchpad
+    uint8_t addr_width;       // bus address width of the CDMA
+    recacc_dma_buffer desc;   // descriptor memory
+    size_t desc_capacity;
+    size_t desc_count;        // descriptors in the current chain
+    bool busy;
+    struct recacc_cdma_model* model;
+} recacc_cdma;
+
+// open the u-dma-buf device at name (e.g. /dev/udmabuf0), size is ignored and read from sysfs
+// passing RECACC_SIM_DEVICE allocates size bytes of ordinary memory for use with the register model
+int recacc_dma_buffer_open(recacc_dma_buffer* buf, const char* name, size_t size);
+
+// unmap and close the buffer, slices must not be used afterwards
+int recacc_dma_buffer_close(recacc_dma_buffer* buf);
+
+// describe size bytes at offset within buf, e.g. to carve descriptor memory from a data buffer
+int recacc_dma_buffer_slice(recacc_dma_buffer* slice, const recacc_dma_buffer* buf, size_t offset, size_t size);
+
+// bus address of ptr, returns 0 if [ptr, ptr+bytes) is not within buf
+uint64_t recacc_dma_buffer_phys(const recacc_dma_buffer* buf, const void* ptr, size_t bytes);
+
+// open the CDMA at uio_name (e.g. /dev/uio5) transferring to and from the scratchpad of dev
+// RECACC_SIM_DEVICE selects the register model, which requires dev to be a simulated device
+// descriptors are placed in desc_mem, which must stay valid until recacc_cdma_close
+int recacc_cdma_open(recacc_cdma* cdma, const char* uio_name, const recacc_device* dev, const recacc_dma_buffer* desc_mem);
+
+// wait for a running chain and close the CDMA
+int recacc_cdma_close(recacc_cdma* cdma);
+
+// soft reset the CDMA, aborts a running chain
+int recacc_cdma_reset(recacc_cdma* cdma);
+
+// discard all descriptors of the current chain, not allowed while busy
+void recacc_cdma_chain_clear(recacc_cdma* cdma);
+
+// append a transfer of bytes from src to dst (bus addresses), merges with the previous descriptor if contiguous
+// returns 0, EBUSY if a chain is running, ENOSPC if descriptor memory is exhausted or EINVAL for unreachable addresses
+int recacc_cdma_chain_add(recacc_cdma* cdma, uint64_t src, uint64_t dst, size_t bytes);
+
+// number of descriptors in the current chain
+size_t recacc_cdma_chain_length(const recacc_cdma* cdma);
+
+// bus address of the scratchpad byte at offset
+uint64_t recacc_cdma_spad_addr(const recacc_cdma* cdma, size_t offset);
+
+// start the current chain, returns immediately
+int recacc_cdma_start(recacc_cdma* cdma);
+
+// true while a started chain did not complete
+bool recacc_cdma_busy(recacc_cdma* cdma);
+
+// block until the started chain completed or timeout_us passed (interrupt driven, polling for the model)
+// returns 0 on completion (or if nothing was started), ETIMEDOUT or EIO on transfer errors
+int recacc_cdma_wait(recacc_cdma* cdma, uint32_t timeout_us);
+
+// file descriptor which becomes readable on completion interrupts, -1 for the register model
+// use recacc_cdma_wait (with timeout 0) to acknowledge after it signalled
+int recacc_cdma_get_fd(const recacc_cdma* cdma);
@@ -0,0 +1,149 @@
+#include "cmdbuf.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "generic.h"
+
+#ifdef __linux__
+#include "sim.h"
+#endif
+
+void recacc_cmdbuf_init(recacc_cmdbuf* cb) {
+    cb->run_count = 0;
+    cb->value_count = 0;
+    cb->has_cfg = false;
+}
+
+int recacc_cmdbuf_write(recacc_cmdbuf* cb, int regidx, uint32_t value) {
+    return recacc_cmdbuf_write_range(cb, regidx, &value, 1);
+}
+
+int recacc_cmdbuf_write_range(recacc_cmdbuf* cb, int regidx, const uint32_t* values, unsigned count) {
+    if (!count)
+        return 0;
+    if (cb->value_count + count > RECACC_CMDBUF_MAX_VALUES)
+        return ENOSPC;
+
+    recacc_cmd_run* run = cb->run_count ? &cb->runs[cb->run_count - 1] : NULL;
+    if (!run || regidx != run->first + run->count) {
+        if (cb->run_count >= RECACC_CMDBUF_MAX_RUNS)
+            return ENOSPC;
+        run = &cb->runs[cb->run_count++];
+        run->first = regidx;
+        run->count = 0;
+        run->offset = cb->value_count;
+    }
+
+    memcpy(&cb->values[cb->value_count], values, count * sizeof(uint32_t));
+    cb->value_count += count;
+    run->count += count;
+    return 0;
+}
+
+int recacc_cmdbuf_config(recacc_cmdbuf* cb, const recacc_config* cfg, uint8_t hw_revision) {
+    // in register order, so that everything ends up in one run
+    const uint32_t values[] = {
+        cfg->input_channels,   // RECACC_REG_IDX_INPUTCHS
+        cfg->output_channels,  // RECACC_REG_IDX_OUTPUTCHS
+        cfg->iact_dimension,   // RECACC_REG_IDX_IMAGE_Y, rectangular shapes only (for now)
+        cfg->iact_dimension,   // RECACC_REG_IDX_IMAGE_X
+        cfg->wght_dimension,   // RECACC_REG_IDX_KERNEL_SIZE
+        cfg->c1,
+        cfg->w1,
+        cfg->h2,
+        cfg->m1,
+        cfg->m0,
+        cfg->m0_last_m1,
+        cfg->rows_last_h2,
+        cfg->c0,
+        cfg->c0_last_c1,
+        cfg->c0w0,
+        cfg->c0w0_last_c1,
+        cfg->psum_throttle,
+        (uint32_t)cfg->pad_y << 8 | cfg->pad_x,
+        cfg->base_addr_iact,
+        cfg->base_addr_wght,
+        cfg->base_addr_psum,
+        cfg->base_addr_pad,
+        cfg->stride_iact_w,
+        cfg->stride_iact_hw,
+        cfg->stride_wght_krnl,
+        cfg->stride_wght_och,
+        cfg->stride_psum_och,
+    };
+    _Static_assert(sizeof(values) / sizeof(values[0]) == RECACC_REG_IDX_STRIDE_PSUM_OCH - RECACC_REG_IDX_INPUTCHS + 1,
+        "configuration registers are not contiguous");
+
+    int ret = recacc_cmdbuf_write_range(cb, RECACC_REG_IDX_INPUTCHS, values, sizeof(values) / sizeof(values[0]));
+    if (ret)
+        return ret;
+
+    if (hw_revision >= 100) {
+        ret = recacc_cmdbuf_write(cb, RECACC_REG_IDX_CONV_STRIDE, cfg->stride);
+        if (ret)
+            return ret;
+    }
+
+    cb->cfg = *cfg;
+    cb->has_cfg = true;
+    return 0;
+}
+
+int recacc_cmdbuf_control_start(recacc_cmdbuf* cb, bool requantize, enum activation_mode mode, bool enable_interrupt, bool enable_padding) {
+    union recacc_control_reg control;
+    control.raw = 0;
+    control.decoded.start = 1;
+    control.decoded.requantize = requantize ? 1 : 0;
+    control.decoded.activation_mode = (uint8_t) mode;
+    control.decoded.irq_en = enable_interrupt ? 1 : 0;
+    control.decoded.padding = enable_padding ? 1 : 0;
+    return recacc_cmdbuf_write(cb, RECACC_REG_IDX_CONTROL, control.raw);
+}
+
+unsigned recacc_cmdbuf_length(const recacc_cmdbuf* cb) {
+    return cb->value_count;
+}
+
+// contiguous stores over one run of registers, pairs at 8-byte aligned addresses are merged into one 64 bit store
+static void _recacc_cmdbuf_store_run(const recacc_device* dev, const recacc_cmd_run* run, const uint32_t* values) {
+    volatile uint8_t* base = (volatile uint8_t*)dev->mem + RECACC_REG_ADDR(run->first);
+    unsigned n = 0;
+
+    #ifndef RECACC_CMDBUF_32BIT_WRITES
+    if ((uintptr_t)base % 8 && run->count) {
+        *(volatile uint32_t*)base = values[0];
+        n = 1;
+    }
+    for (; n + 2 <= run->count; n += 2) {
+        uint64_t pair = (uint64_t)values[n + 1] << 32 | values[n]; // registers are little endian
+        *(volatile uint64_t*)(base + 4 * n) = pair;
+    }
+    #endif
+
+    for (; n < run->count; n++)
+        *(volatile uint32_t*)(base + 4 * n) = values[n];
+}
+
+void recacc_cmdbuf_replay(recacc_device* dev, const recacc_cmdbuf* cb) {
+    for (unsigned r = 0; r < cb->run_count; r++) {
+        const recacc_cmd_run* run = &cb->runs[r];
+        const uint32_t* values = &cb->values[run->offset];
+
+        #ifdef __linux__
+        if (dev->sim) {
+            // the register model reacts on single writes (e.g. the control register)
+            for (unsigned n = 0; n < run->count; n++)
+                recacc_sim_reg_write(dev, run->first + n, values[n]);
+            continue;
+        }
+        #endif
+
+        _recacc_cmdbuf_store_run(dev, run, values);
+    }
+
+    if (cb->has_cfg) {
+        dev->shadow_cfg = cb->cfg;
+        dev->shadow_valid = true;
+    }
+}
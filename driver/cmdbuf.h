@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "defs.h"
+#include "types.h"
+
+// a recorded sequence of register writes that can be replayed any number of times
+// writes to consecutive registers are grouped into runs, which are replayed as a contiguous block with
+// 64 bit stores where the register pair is 8-byte aligned (unless RECACC_CMDBUF_32BIT_WRITES is defined).
+// a job's whole register programming (configuration, postprocessing, control) is recorded once and replayed
+// per job, e.g. from a submission thread. the buffer does not refer to any device until it is replayed.
+
+#define RECACC_CMDBUF_MAX_VALUES 1024
+#define RECACC_CMDBUF_MAX_RUNS   16
+
+typedef struct {
+    uint16_t first;  // register index of the first value
+    uint16_t count;  // number of consecutive registers
+    uint16_t offset; // index of the first value in recacc_cmdbuf.values
+} recacc_cmd_run;
+
+typedef struct {
+    recacc_cmd_run runs[RECACC_CMDBUF_MAX_RUNS];
+    uint32_t values[RECACC_CMDBUF_MAX_VALUES];
+    uint16_t run_count;
+    uint16_t value_count;
+    bool has_cfg;      // contains a recacc_cmdbuf_config, the device shadow copy is updated on replay
+    recacc_config cfg;
+} recacc_cmdbuf;
+
+// empty the buffer
+void recacc_cmdbuf_init(recacc_cmdbuf* cb);
+
+// append a single register write, returns ENOSPC if the buffer is full
+int recacc_cmdbuf_write(recacc_cmdbuf* cb, int regidx, uint32_t value);
+
+// append writes of count values to consecutive registers starting at regidx, returns ENOSPC if the buffer is full
+int recacc_cmdbuf_write_range(recacc_cmdbuf* cb, int regidx, const uint32_t* values, unsigned count);
+
+// append all configuration registers as written by recacc_config_write (without shadow comparison)
+// hw_revision selects the optional registers, as in recacc_config_write
+int recacc_cmdbuf_config(recacc_cmdbuf* cb, const recacc_config* cfg, uint8_t hw_revision);
+
+// append the control register write of recacc_control_start, it should be the last write of a job
+// unlike recacc_control_start, the remaining control bits are not read back from the device but zero
+int recacc_cmdbuf_control_start(recacc_cmdbuf* cb, bool requantize, enum activation_mode mode, bool enable_interrupt, bool enable_padding);
+
+// number of register writes in the buffer
+unsigned recacc_cmdbuf_length(const recacc_cmdbuf* cb);
+
+// write all recorded registers to the device in recording order
+void recacc_cmdbuf_replay(recacc_device* dev, const recacc_cmdbuf* cb);
@@ -4,6 +4,12 @@
 #define RECACC_MEM_OFFSET_REGS 0xFFF000
 #define RECACC_MEM_MAP_SIZE    0x1000000 // covers all mapped areas
 
+// bus address of the accelerator mapping as configured in the device tree overlays
+#define RECACC_PHYS_BASE       0xa0000000
+
+// device name for recacc_open selecting the software simulation instead of a uio device
+#define RECACC_SIM_DEVICE "sim"
+
 // fixed definitions of frequency for latency and throttle estimation
 // this could be moved to hardware once the hwinfo register knows the frequencies
 #define RECACC_ARRAY_CLK_MHZ 100
@@ -12,6 +18,12 @@
 #define POLL_TIMEOUT_US  1000000
 #define POLL_INTERVAL_US  100000
 
+// defaults for the adaptive wait mode (spin, then sleep with exponential backoff, then interrupt)
+#define WAIT_SPIN_US        50
+#define WAIT_SLEEP_MIN_US   10
+#define WAIT_SLEEP_MAX_US 1000
+#define WAIT_SLEEP_TOTAL_US 20000
+
 #define RECACC_MAGIC "ACC"
 #define RECACC_MIN_HW_REV 6
 #define RECACC_MAX_HW_REV 6
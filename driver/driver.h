@@ -6,10 +6,12 @@
 #include "defs.h"
 #include "types.h"
 #include "generic.h"
+#include "cmdbuf.h"
 
 // os-specific functions
 #ifdef __linux__
 #include "linux.h"
+#include "cdma.h"
 #else
 #include "baremetal.h"
 #endif
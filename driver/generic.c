@@ -3,8 +3,10 @@
 #include "types.h"
 
 #define __USE_MISC
+#define __USE_POSIX199309
 
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <math.h>
@@ -12,6 +14,11 @@
 #include <unistd.h>
 #include <time.h>
 
+#ifdef __linux__
+#include "linux.h"
+#include "sim.h"
+#endif
+
 bool recacc_verify(recacc_device* dev, bool print_info) {
     uint32_t magic_reg = recacc_reg_read(dev, RECACC_REG_IDX_MAGIC);
     char magic_str[4] = {
@@ -51,6 +58,15 @@ void recacc_reset(recacc_device* dev) {
     for(volatile int i=0; i<10000; i++);
     #endif
     recacc_reg_write(dev, RECACC_REG_IDX_CONTROL, 0);
+    recacc_config_invalidate(dev);
+}
+
+void recacc_config_invalidate(recacc_device* dev) {
+    dev->shadow_valid = false;
+}
+
+uint64_t recacc_config_skipped_writes(const recacc_device* dev) {
+    return dev->skipped_writes;
 }
 
 int recacc_config_read(const recacc_device* dev, recacc_config* cfg) {
@@ -89,41 +105,55 @@ int recacc_config_read(const recacc_device* dev, recacc_config* cfg) {
     return 0;
 }
 
-int recacc_config_write(const recacc_device* dev, const recacc_config* cfg) {
+// write a configuration register unless the shadow copy proves it already holds this value
+static inline void _recacc_config_write_reg(recacc_device* dev, int regidx, uint32_t value, uint32_t shadow_value) {
+    if (dev->shadow_valid && value == shadow_value) {
+        dev->skipped_writes++;
+        return;
+    }
+    recacc_reg_write(dev, regidx, value);
+}
+
+int recacc_config_write(recacc_device* dev, const recacc_config* cfg) {
+    const recacc_config* shadow = &dev->shadow_cfg;
+
     // RECACC_REG_IDX_CONTROL is excluded
     // RECACC_REG_IDX_STATUS can't be written
-    recacc_reg_write(dev, RECACC_REG_IDX_IMAGE_X, cfg->iact_dimension); // rectangular shapes only (for now)
-    recacc_reg_write(dev, RECACC_REG_IDX_IMAGE_Y, cfg->iact_dimension);
-    recacc_reg_write(dev, RECACC_REG_IDX_KERNEL_SIZE, cfg->wght_dimension);
-    recacc_reg_write(dev, RECACC_REG_IDX_INPUTCHS, cfg->input_channels);
-    recacc_reg_write(dev, RECACC_REG_IDX_OUTPUTCHS, cfg->output_channels);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_C1, cfg->c1);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_W1, cfg->w1);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_H2, cfg->h2);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_M1, cfg->m1);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_M0, cfg->m0);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_M0_LAST_M1, cfg->m0_last_m1);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_ROWS_LAST_H2, cfg->rows_last_h2);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_C0, cfg->c0);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_C0_LAST_C1, cfg->c0_last_c1);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_C0W0, cfg->c0w0);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_C0W0_LAST_C1, cfg->c0w0_last_c1);
-    recacc_reg_write(dev, RECACC_REG_IDX_PSUM_THROTTLE, cfg->psum_throttle);
-    recacc_reg_write(dev, RECACC_REG_IDX_CONV_PADDING, cfg->pad_y << 8 | cfg->pad_x);
-    recacc_reg_write(dev, RECACC_REG_IDX_BASE_ADDR_IACT, cfg->base_addr_iact);
-    recacc_reg_write(dev, RECACC_REG_IDX_BASE_ADDR_WGHT, cfg->base_addr_wght);
-    recacc_reg_write(dev, RECACC_REG_IDX_BASE_ADDR_PSUM, cfg->base_addr_psum);
-    recacc_reg_write(dev, RECACC_REG_IDX_BASE_ADDR_PAD, cfg->base_addr_pad);
-    recacc_reg_write(dev, RECACC_REG_IDX_STRIDE_IACT_W, cfg->stride_iact_w);
-    recacc_reg_write(dev, RECACC_REG_IDX_STRIDE_IACT_HW, cfg->stride_iact_hw);
-    recacc_reg_write(dev, RECACC_REG_IDX_STRIDE_WGHT_KRNL, cfg->stride_wght_krnl);
-    recacc_reg_write(dev, RECACC_REG_IDX_STRIDE_WGHT_OCH, cfg->stride_wght_och);
-    recacc_reg_write(dev, RECACC_REG_IDX_STRIDE_PSUM_OCH, cfg->stride_psum_och);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_IMAGE_X, cfg->iact_dimension, shadow->iact_dimension); // rectangular shapes only (for now)
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_IMAGE_Y, cfg->iact_dimension, shadow->iact_dimension);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_KERNEL_SIZE, cfg->wght_dimension, shadow->wght_dimension);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_INPUTCHS, cfg->input_channels, shadow->input_channels);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_OUTPUTCHS, cfg->output_channels, shadow->output_channels);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_C1, cfg->c1, shadow->c1);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_W1, cfg->w1, shadow->w1);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_H2, cfg->h2, shadow->h2);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_M1, cfg->m1, shadow->m1);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_M0, cfg->m0, shadow->m0);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_M0_LAST_M1, cfg->m0_last_m1, shadow->m0_last_m1);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_ROWS_LAST_H2, cfg->rows_last_h2, shadow->rows_last_h2);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_C0, cfg->c0, shadow->c0);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_C0_LAST_C1, cfg->c0_last_c1, shadow->c0_last_c1);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_C0W0, cfg->c0w0, shadow->c0w0);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_C0W0_LAST_C1, cfg->c0w0_last_c1, shadow->c0w0_last_c1);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_PSUM_THROTTLE, cfg->psum_throttle, shadow->psum_throttle);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_PADDING, cfg->pad_y << 8 | cfg->pad_x, shadow->pad_y << 8 | shadow->pad_x);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_BASE_ADDR_IACT, cfg->base_addr_iact, shadow->base_addr_iact);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_BASE_ADDR_WGHT, cfg->base_addr_wght, shadow->base_addr_wght);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_BASE_ADDR_PSUM, cfg->base_addr_psum, shadow->base_addr_psum);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_BASE_ADDR_PAD, cfg->base_addr_pad, shadow->base_addr_pad);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_STRIDE_IACT_W, cfg->stride_iact_w, shadow->stride_iact_w);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_STRIDE_IACT_HW, cfg->stride_iact_hw, shadow->stride_iact_hw);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_STRIDE_WGHT_KRNL, cfg->stride_wght_krnl, shadow->stride_wght_krnl);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_STRIDE_WGHT_OCH, cfg->stride_wght_och, shadow->stride_wght_och);
+    _recacc_config_write_reg(dev, RECACC_REG_IDX_STRIDE_PSUM_OCH, cfg->stride_psum_och, shadow->stride_psum_och);
 
     if (dev->hw_revision >= 100)
-        recacc_reg_write(dev, RECACC_REG_IDX_CONV_STRIDE, cfg->stride);
+        _recacc_config_write_reg(dev, RECACC_REG_IDX_CONV_STRIDE, cfg->stride, shadow->stride);
 
     // RECACC_REG_IDX_MAGIC can't be written
+
+    dev->shadow_cfg = *cfg;
+    dev->shadow_valid = true;
     return 0;
 }
 
@@ -134,6 +164,13 @@ uint32_t recacc_reg_read(const recacc_device* dev, int regidx) {
 }
 
 void recacc_reg_write(const recacc_device* dev, int regidx, uint32_t value) {
+    #ifdef __linux__
+    if (dev->sim) {
+        recacc_sim_reg_write(dev, regidx, value);
+        return;
+    }
+    #endif
+
     volatile uint32_t *ptr = (volatile uint32_t*)(dev->mem + RECACC_REG_ADDR(regidx));
     // printf("recacc_reg_write reg %d off %d ptr %p val 0x%08x\n", regidx, RECACC_BYTE_OFFSET(regidx), ptr, value);
     *ptr = value;
@@ -209,39 +246,101 @@ bool recacc_poll(const recacc_device* dev) {
     return status.ready || status.done;
 }
 
+void recacc_wait_params_init(recacc_wait_params* params) {
+    params->spin_us = WAIT_SPIN_US;
+    params->sleep_min_us = WAIT_SLEEP_MIN_US;
+    params->sleep_max_us = WAIT_SLEEP_MAX_US;
+    params->sleep_total_us = WAIT_SLEEP_TOTAL_US;
+    params->irq_fallback = true;
+}
+
 #ifdef __linux__
-#include <sys/select.h>
+static inline uint64_t _recacc_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// block on the completion thread or the uio device for at most timeout_us
+// returns 0 if an interrupt was observed, ETIMEDOUT on timeout and an errno on other errors
+static int _recacc_wait_irq_linux(const recacc_device* dev, uint32_t timeout_us) {
+    int ret;
+    if (dev->irq_thread)
+        ret = recacc_irq_thread_wait(dev, timeout_us);
+    else
+        ret = recacc_irq_wait(dev, timeout_us);
+
+    if (ret && ret != ETIMEDOUT)
+        printf("Failed to wait for interrupt: %s\n", strerror(ret));
+
+    return ret;
+}
+
 static inline bool _recacc_wait_linux(const recacc_device* dev, bool poll) {
     if (poll) {
         unsigned max_poll = POLL_TIMEOUT_US / POLL_INTERVAL_US;
-        while (max_poll) {
+        while (max_poll--) {
             if (recacc_poll(dev))
                 return true;
             usleep(POLL_INTERVAL_US);
         }
         return false;
     } else {
-        struct timeval timeout;
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(dev->fd, &readfds);
-        int nfds = dev->fd;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 100000;
-        int ret = select(nfds+1, &readfds, 0, 0, &timeout);
-
-        if (ret < 0) {
-            perror("Error while waiting for data");
-            return false;
+        // interrupts left over from earlier jobs are filtered by checking the status register
+        const uint64_t timeout_end = _recacc_time_ns() + (uint64_t)POLL_TIMEOUT_US * 1000;
+        uint64_t now;
+        while ((now = _recacc_time_ns()) < timeout_end) {
+            int ret = _recacc_wait_irq_linux(dev, (timeout_end - now) / 1000);
+            if (ret && ret != ETIMEDOUT)
+                return false;
+            if (!ret && recacc_poll(dev))
+                return true;
         }
+        return recacc_poll(dev);
+    }
+}
+
+static bool _recacc_wait_adaptive_linux(const recacc_device* dev, const recacc_wait_params* params, uint64_t* latency_ns) {
+    const uint64_t start = _recacc_time_ns();
+    const uint64_t spin_end = start + (uint64_t)params->spin_us * 1000;
+    const uint64_t timeout_end = start + (uint64_t)POLL_TIMEOUT_US * 1000;
+    uint64_t sleep_end = spin_end + (uint64_t)params->sleep_total_us * 1000;
+    if (!params->irq_fallback || sleep_end > timeout_end)
+        sleep_end = timeout_end;
+
+    bool done = recacc_poll(dev);
+    uint64_t now = start;
+
+    // phase 1: spin on the status register
+    while (!done && now < spin_end) {
+        done = recacc_poll(dev);
+        now = _recacc_time_ns();
+    }
 
-        if (FD_ISSET(dev->fd, &readfds)) {
-            uint32_t irq_count = 0;
-            size_t cnt = read(dev->fd, &irq_count, sizeof(irq_count));
-            return cnt == 4 && irq_count > 0;
-        } else
-            return false;
+    // phase 2: sleep, doubling the interval after each poll
+    uint32_t sleep_us = params->sleep_min_us ? params->sleep_min_us : 1;
+    while (!done && now < sleep_end) {
+        struct timespec ts = { .tv_sec = sleep_us / 1000000, .tv_nsec = (sleep_us % 1000000) * 1000L };
+        nanosleep(&ts, NULL);
+        done = recacc_poll(dev);
+        now = _recacc_time_ns();
+        if (sleep_us < params->sleep_max_us)
+            sleep_us = sleep_us * 2 < params->sleep_max_us ? sleep_us * 2 : params->sleep_max_us;
     }
+
+    // phase 3: block on the interrupt, stale interrupts from earlier jobs are filtered by polling again
+    while (!done && now < timeout_end) {
+        int ret = _recacc_wait_irq_linux(dev, (timeout_end - now) / 1000);
+        if (ret && ret != ETIMEDOUT)
+            break;
+        done = recacc_poll(dev);
+        now = _recacc_time_ns();
+    }
+
+    if (latency_ns)
+        *latency_ns = now - start;
+
+    return done;
 }
 #else
 static inline bool _recacc_wait_baremetal(const recacc_device* dev, bool poll) {
@@ -257,6 +356,16 @@ static inline bool _recacc_wait_baremetal(const recacc_device* dev, bool poll) {
 }
 #endif
 
+bool recacc_wait_adaptive(const recacc_device* dev, const recacc_wait_params* params, uint64_t* latency_ns) {
+    #ifdef __linux__
+    return _recacc_wait_adaptive_linux(dev, params, latency_ns);
+    #else
+    if (latency_ns)
+        *latency_ns = 0;
+    return _recacc_wait_baremetal(dev, true);
+    #endif
+}
+
 bool recacc_wait(const recacc_device* dev, bool poll) {
     #ifdef __linux__
     return _recacc_wait_linux(dev, poll);
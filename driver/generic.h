@@ -19,7 +19,15 @@ int recacc_config_read(const recacc_device* dev, recacc_config* cfg);
 
 // write a full set of configuration data to the accelerator
 // does not write the control register (RECACC_REG_IDX_CONTROL)
-int recacc_config_write(const recacc_device* dev, const recacc_config* cfg);
+// registers matching the shadow copy of the previous call are skipped
+int recacc_config_write(recacc_device* dev, const recacc_config* cfg);
+
+// drop the shadow copy of the configuration registers, the next recacc_config_write writes all registers
+// required after anything else modified the configuration registers (recacc_reset calls this already)
+void recacc_config_invalidate(recacc_device* dev);
+
+// number of register writes skipped by recacc_config_write since the device was opened
+uint64_t recacc_config_skipped_writes(const recacc_device* dev);
 
 // read a single register from the accelerator
 // see defs.h for index definitions
@@ -35,11 +43,22 @@ void recacc_reg_write(const recacc_device* dev, int regidx, uint32_t value);
 bool recacc_poll(const recacc_device* dev);
 
 // wait until the accelerator is ready
-// this call blocks until an interrupt is received
+// if poll is false, this call blocks until an interrupt is received
+// (through the completion thread if one is running, see linux.h)
 // returns true if wait was successful
 // returns false after a 1-second timeout (hardware stuck)
 bool recacc_wait(const recacc_device* dev, bool poll);
 
+// fill params with the default adaptive wait parameters (WAIT_* in defs.h)
+void recacc_wait_params_init(recacc_wait_params* params);
+
+// wait until the accelerator is ready with low latency for short jobs:
+// spin on the status register for params->spin_us, then sleep with exponential backoff,
+// and finally block on the interrupt (requires enable_interrupt in recacc_control_start)
+// latency_ns receives the time spent waiting (may be NULL, always 0 on baremetal)
+// returns false after POLL_TIMEOUT_US (hardware stuck)
+bool recacc_wait_adaptive(const recacc_device* dev, const recacc_wait_params* params, uint64_t* latency_ns);
+
 // read the status register and return its value as a decoded struct
 recacc_status recacc_get_status(const recacc_device* dev);
 
@@ -1,29 +1,59 @@
+#define _GNU_SOURCE
+
 #include "linux.h"
 #include "defs.h"
+#include "generic.h"
+#include "sim.h"
 
+#include <sys/eventfd.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+struct recacc_irq_thread {
+    pthread_t thread;
+    const recacc_device* dev;
+    int event_fd; // incremented once per interrupt
+    int stop_fd;  // written by recacc_irq_thread_stop to terminate the thread
+};
+
 int recacc_open(recacc_device* dev, const char* uio_name) {
+    // recacc_close relies on these when opening fails halfway
+    dev->fd = -1;
+    dev->mem = MAP_FAILED;
+    dev->hw_revision = 0;
+    dev->shadow_valid = false;
+    dev->skipped_writes = 0;
+    dev->irq_thread = NULL;
+    dev->sim = NULL;
+
+    if (strcmp(uio_name, RECACC_SIM_DEVICE) == 0)
+        return recacc_sim_open(dev);
+
     dev->fd = open(uio_name, O_RDWR);
     if (dev->fd == -1) {
-        printf("Failed to open %s: %s\n", uio_name, strerror(errno));
-        return errno;
+        int err = errno;
+        printf("Failed to open %s: %s\n", uio_name, strerror(err));
+        return err;
     }
 
     dev->mem = mmap(NULL, RECACC_MEM_MAP_SIZE, PROT_WRITE | PROT_READ, MAP_SHARED, dev->fd, 0);
     if (dev->mem == MAP_FAILED) {
         int err = errno;
-        printf("Failed to map memory: %s\n", strerror(errno));
+        printf("Failed to map memory: %s\n", strerror(err));
         recacc_close(dev);
         return err;
     }
 
-    dev->hw_revision = 0;
+    // a previous user may have left the interrupt masked, failing here just means no irq support
+    recacc_irq_enable(dev);
 
     return 0;
 }
@@ -31,19 +61,179 @@ int recacc_open(recacc_device* dev, const char* uio_name) {
 int recacc_close(recacc_device* dev) {
     int ret = 0;
 
-    if (dev->mem) {
-        ret = munmap(dev->mem, RECACC_MEM_MAP_SIZE);
+    if (dev->irq_thread) {
+        ret = recacc_irq_thread_stop(dev);
         if (ret)
             return ret;
-        dev->mem = 0;
     }
 
-    if (dev->fd) {
-        ret = close(dev->fd);
+    if (dev->sim) {
+        ret = recacc_sim_close(dev);
         if (ret)
             return ret;
-        dev->fd = 0;
+    }
+
+    if (dev->mem && dev->mem != MAP_FAILED) {
+        if (munmap(dev->mem, RECACC_MEM_MAP_SIZE))
+            return errno;
+        dev->mem = 0;
+    }
+
+    if (dev->fd >= 0) {
+        if (close(dev->fd))
+            return errno;
+        dev->fd = -1;
     }
 
     return ret;
 }
+
+int recacc_irq_enable(const recacc_device* dev) {
+    uint32_t enable = 1;
+    if (write(dev->fd, &enable, sizeof(enable)) != sizeof(enable))
+        return errno;
+    return 0;
+}
+
+// wait for fd to become readable, returns 0 if readable, ETIMEDOUT on timeout or signal and errno on errors
+static int _recacc_poll_fd(int fd, uint32_t timeout_us) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    struct timespec ts = { .tv_sec = timeout_us / 1000000, .tv_nsec = (timeout_us % 1000000) * 1000L };
+    int ret = ppoll(&pfd, 1, &ts, NULL);
+    if (ret < 0)
+        return errno == EINTR ? ETIMEDOUT : errno;
+    return ret > 0 && (pfd.revents & POLLIN) ? 0 : ETIMEDOUT;
+}
+
+// consume the interrupt count from the uio device, clear the flag and re-arm
+static int _recacc_irq_acknowledge(const recacc_device* dev) {
+    uint32_t irq_count = 0;
+    ssize_t cnt = read(dev->fd, &irq_count, sizeof(irq_count));
+    if (cnt != sizeof(irq_count))
+        return cnt < 0 ? errno : EIO;
+
+    // clear the status flag before re-arming, otherwise the level interrupt fires again immediately
+    recacc_control_clear_irq(dev);
+    int ret = recacc_irq_enable(dev);
+    if (ret)
+        return ret;
+
+    return irq_count > 0 ? 0 : ETIMEDOUT;
+}
+
+int recacc_irq_wait(const recacc_device* dev, uint32_t timeout_us) {
+    int ret = _recacc_poll_fd(dev->fd, timeout_us);
+    if (ret)
+        return ret;
+    return _recacc_irq_acknowledge(dev);
+}
+
+static void* _recacc_irq_thread_main(void* arg) {
+    struct recacc_irq_thread* ctx = arg;
+    struct pollfd pfds[2] = {
+        { .fd = ctx->dev->fd, .events = POLLIN },
+        { .fd = ctx->stop_fd, .events = POLLIN },
+    };
+
+    while (1) {
+        int ret = poll(pfds, 2, -1);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            printf("Failed to wait for interrupt in completion thread: %s\n", strerror(errno));
+            break;
+        }
+
+        if (pfds[1].revents & POLLIN)
+            break;
+
+        if (pfds[0].revents & POLLIN) {
+            if (_recacc_irq_acknowledge(ctx->dev) == 0) {
+                uint64_t one = 1;
+                if (write(ctx->event_fd, &one, sizeof(one)) != sizeof(one))
+                    printf("Failed to signal completion: %s\n", strerror(errno));
+            }
+        } else if (pfds[0].revents & (POLLERR | POLLHUP)) {
+            printf("Failed to wait for interrupt in completion thread: uio device error\n");
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int recacc_irq_thread_start(recacc_device* dev) {
+    if (dev->irq_thread)
+        return EBUSY;
+
+    struct recacc_irq_thread* ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return ENOMEM;
+
+    ctx->dev = dev;
+    ctx->event_fd = eventfd(0, EFD_CLOEXEC);
+    ctx->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (ctx->event_fd == -1 || ctx->stop_fd == -1) {
+        int err = errno;
+        printf("Failed to create eventfd: %s\n", strerror(err));
+        if (ctx->event_fd != -1)
+            close(ctx->event_fd);
+        if (ctx->stop_fd != -1)
+            close(ctx->stop_fd);
+        free(ctx);
+        return err;
+    }
+
+    int ret = pthread_create(&ctx->thread, NULL, _recacc_irq_thread_main, ctx);
+    if (ret) {
+        printf("Failed to start completion thread: %s\n", strerror(ret));
+        close(ctx->event_fd);
+        close(ctx->stop_fd);
+        free(ctx);
+        return ret;
+    }
+
+    dev->irq_thread = ctx;
+    return 0;
+}
+
+int recacc_irq_thread_stop(recacc_device* dev) {
+    struct recacc_irq_thread* ctx = dev->irq_thread;
+    if (!ctx)
+        return 0;
+
+    uint64_t one = 1;
+    if (write(ctx->stop_fd, &one, sizeof(one)) != sizeof(one))
+        return errno;
+
+    int ret = pthread_join(ctx->thread, NULL);
+    if (ret)
+        return ret;
+
+    close(ctx->event_fd);
+    close(ctx->stop_fd);
+    free(ctx);
+    dev->irq_thread = NULL;
+
+    return 0;
+}
+
+int recacc_irq_get_eventfd(const recacc_device* dev) {
+    return dev->irq_thread ? dev->irq_thread->event_fd : -1;
+}
+
+int recacc_irq_thread_wait(const recacc_device* dev, uint32_t timeout_us) {
+    int fd = recacc_irq_get_eventfd(dev);
+    if (fd < 0)
+        return EINVAL;
+
+    int ret = _recacc_poll_fd(fd, timeout_us);
+    if (ret)
+        return ret;
+
+    uint64_t completions = 0;
+    if (read(fd, &completions, sizeof(completions)) != sizeof(completions))
+        return errno;
+
+    return completions > 0 ? 0 : ETIMEDOUT;
+}
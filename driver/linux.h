@@ -3,9 +3,34 @@
 #include "types.h"
 
 // open the accelerator device at uio_name (e.g. /dev/uio4)
+// passing RECACC_SIM_DEVICE opens a software-simulated device instead (see sim.h)
 // dev needs to be allocated by the caller
 int recacc_open(recacc_device* dev, const char* uio_name);
 
 // close the accelerator device
 // the caller keeps ownership of dev and needs to release it
 int recacc_close(recacc_device* dev);
+
+// re-enable the uio interrupt, generic-uio masks it after every delivered interrupt
+// returns 0 on success and an errno on errors
+int recacc_irq_enable(const recacc_device* dev);
+
+// block until the accelerator raised an interrupt or timeout_us passed
+// the interrupt flag is cleared and the interrupt is re-armed before returning
+// returns 0 on interrupt, ETIMEDOUT on timeout and an errno on other errors
+int recacc_irq_wait(const recacc_device* dev, uint32_t timeout_us);
+
+// start a thread which blocks on the uio interrupt and signals an eventfd on each completion
+// waiters (recacc_wait, recacc_wait_adaptive) use the eventfd instead of the uio device afterwards
+int recacc_irq_thread_start(recacc_device* dev);
+
+// stop the completion thread and release its resources
+int recacc_irq_thread_stop(recacc_device* dev);
+
+// eventfd signalled by the completion thread, can be added to own poll/epoll sets
+// reading it consumes the pending completions; returns -1 if no thread is running
+int recacc_irq_get_eventfd(const recacc_device* dev);
+
+// wait on the completion thread's eventfd for at most timeout_us
+// returns 0 if a completion was signalled, ETIMEDOUT on timeout and an errno on other errors
+int recacc_irq_thread_wait(const recacc_device* dev, uint32_t timeout_us);
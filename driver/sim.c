@@ -0,0 +1,371 @@
+#define _GNU_SOURCE
+
+#include "sim.h"
+#include "defs.h"
+#include "generic.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// simulated hardware configuration, matches the single-tile ZCU104 prototype
+#define SIM_ARRAY_SIZE_X     7
+#define SIM_ARRAY_SIZE_Y     10
+#define SIM_LINE_LENGTH_IACT 64
+#define SIM_LINE_LENGTH_WGHT 64
+#define SIM_LINE_LENGTH_PSUM 128
+#define SIM_FIFO_SIZE_PSUM   128
+#define SIM_DATA_WIDTH_IACT  8
+#define SIM_DATA_WIDTH_WGHT  8
+#define SIM_DATA_WIDTH_PSUM  32
+#define SIM_SPAD_ADDR_WIDTH  19 // 512 KiB
+#define SIM_SPAD_WORD_SIZE   8
+#define SIM_MAX_OUTPUT_CHS   10
+#define SIM_STARTUP_CYCLES   100
+
+struct recacc_sim {
+    const recacc_device* dev;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool start_pending;
+    bool stop;
+    uint32_t job_id;   // incremented by start, stop and reset to discard results of cancelled jobs
+    int irq_fd;        // simulation end of the socketpair, dev->fd is the host end
+    bool irq_armed;
+    uint32_t irq_count;
+};
+
+static inline volatile uint32_t* _sim_reg(const recacc_device* dev, int regidx) {
+    return (volatile uint32_t*)((uint8_t*)dev->mem + RECACC_REG_ADDR(regidx));
+}
+
+static inline void _sim_set_reg(const recacc_device* dev, int regidx, uint32_t value) {
+    // release ordering publishes the psum data before the done flag
+    __atomic_store_n((uint32_t*)_sim_reg(dev, regidx), value, __ATOMIC_RELEASE);
+}
+
+static uint32_t _sim_idle_status(bool done, bool irq) {
+    union recacc_status_reg status;
+    status.raw = 0;
+    status.decoded.ready = !done;
+    status.decoded.done = done;
+    status.decoded.irq = irq;
+    status.decoded.spad_iact_empty = 1;
+    status.decoded.spad_wght_empty = 1;
+    status.decoded.spad_psum_empty = 1;
+    return status.raw;
+}
+
+static void _sim_init_regs(const recacc_device* dev) {
+    _sim_set_reg(dev, RECACC_REG_IDX_MAGIC,
+        (uint32_t)RECACC_MAGIC[0] << 24 | (uint32_t)RECACC_MAGIC[1] << 16 | (uint32_t)RECACC_MAGIC[2] << 8 | RECACC_MAX_HW_REV);
+    _sim_set_reg(dev, RECACC_REG_IDX_ARRAY_SIZE, SIM_ARRAY_SIZE_Y << 16 | SIM_ARRAY_SIZE_X);
+    _sim_set_reg(dev, RECACC_REG_IDX_LINE_LENGTH_1, SIM_LINE_LENGTH_WGHT << 16 | SIM_LINE_LENGTH_IACT);
+    _sim_set_reg(dev, RECACC_REG_IDX_LINE_LENGTH_2, SIM_FIFO_SIZE_PSUM << 16 | SIM_LINE_LENGTH_PSUM);
+    _sim_set_reg(dev, RECACC_REG_IDX_DATA_WIDTH, SIM_DATA_WIDTH_PSUM << 16 | SIM_DATA_WIDTH_WGHT << 8 | SIM_DATA_WIDTH_IACT);
+    _sim_set_reg(dev, RECACC_REG_IDX_ADDR_WIDTH, SIM_SPAD_WORD_SIZE << 8 | SIM_SPAD_ADDR_WIDTH);
+    _sim_set_reg(dev, RECACC_REG_IDX_CAPABILITIES, 1 << RECACC_BIT_IDX_CAP_BIAS_REQUANT | SIM_MAX_OUTPUT_CHS);
+    _sim_set_reg(dev, RECACC_REG_IDX_CONTROL, 0);
+    _sim_set_reg(dev, RECACC_REG_IDX_STATUS, _sim_idle_status(false, false));
+}
+
+// raise the uio interrupt unless the host did not re-arm it since the last one (like generic-uio)
+static void _sim_raise_irq(struct recacc_sim* sim) {
+    uint32_t enable;
+    while (recv(sim->irq_fd, &enable, sizeof(enable), MSG_DONTWAIT) == sizeof(enable))
+        if (enable)
+            sim->irq_armed = true;
+
+    if (!sim->irq_armed)
+        return;
+
+    sim->irq_count++;
+    if (send(sim->irq_fd, &sim->irq_count, sizeof(sim->irq_count), MSG_DONTWAIT) == sizeof(sim->irq_count))
+        sim->irq_armed = false;
+}
+
+// rough estimate of the hardware run time: every mapping pass (m1 x h2) preloads the weights,
+// streams all input channels for each output column and drains the psums through the scratchpad
+static uint32_t _sim_cycles(const recacc_config* cfg, unsigned bytes_per_pixel) {
+    uint64_t passes = (uint64_t)cfg->m1 * cfg->h2;
+    uint64_t preload = (uint64_t)cfg->input_channels * cfg->wght_dimension;
+    uint64_t compute = (uint64_t)(cfg->w1 + cfg->wght_dimension - 1) * cfg->input_channels * cfg->wght_dimension;
+    uint64_t drain = (uint64_t)cfg->m0 * cfg->w1 * SIM_ARRAY_SIZE_X * bytes_per_pixel / SIM_SPAD_WORD_SIZE;
+    uint64_t cycles = SIM_STARTUP_CYCLES + passes * (preload + compute + drain);
+    return cycles > UINT32_MAX ? UINT32_MAX : cycles;
+}
+
+static float _sim_reg_float(const recacc_device* dev, int regidx) {
+    uint32_t raw = *_sim_reg(dev, regidx);
+    float value;
+    memcpy(&value, &raw, sizeof(value));
+    return value;
+}
+
+// compute the convolution described by the register file on the scratchpad contents
+// returns the number of saturated output values
+static uint32_t _sim_convolve(const recacc_device* dev, const recacc_config* cfg, union recacc_control_reg control) {
+    const int8_t* spad = (const int8_t*)dev->mem + RECACC_MEM_OFFSET_SPAD;
+    int8_t* spad_out = (int8_t*)dev->mem + RECACC_MEM_OFFSET_SPAD;
+    const size_t column_stride = (1 << SIM_SPAD_ADDR_WIDTH) / SIM_SPAD_WORD_SIZE;
+    const unsigned channels_per_column = cfg->input_channels / SIM_SPAD_WORD_SIZE;
+    const int image = cfg->iact_dimension;
+    const int kernel = cfg->wght_dimension;
+    const int pad = control.decoded.padding ? cfg->pad_x : 0;
+    const int out = cfg->w1;
+    const unsigned bytes_per_pixel = control.decoded.requantize ? 1 : SIM_DATA_WIDTH_PSUM / 8;
+    uint32_t overflows = 0;
+
+    if (channels_per_column == 0)
+        return 0;
+
+    for (unsigned och = 0; och < cfg->output_channels; och++) {
+        int32_t bias = 0;
+        float scale = 0.0f, zeropoint = 0.0f;
+        if (och < SIM_MAX_OUTPUT_CHS) {
+            bias = *_sim_reg(dev, RECACC_REG_IDX_BIAS_REQUANT_BASE + och);
+            scale = _sim_reg_float(dev, RECACC_REG_IDX_BIAS_REQUANT_BASE + SIM_MAX_OUTPUT_CHS + och);
+            zeropoint = _sim_reg_float(dev, RECACC_REG_IDX_BIAS_REQUANT_BASE + 2 * SIM_MAX_OUTPUT_CHS + och);
+        }
+
+        int8_t* psum_addr = spad_out + cfg->base_addr_psum
+            + (size_t)cfg->stride_psum_och * (och / SIM_SPAD_WORD_SIZE) * SIM_SPAD_WORD_SIZE
+            + column_stride * (och % SIM_SPAD_WORD_SIZE);
+
+        for (int oy = 0; oy < out; oy++) {
+            for (int ox = 0; ox < out; ox++) {
+                int64_t acc = 0;
+                for (unsigned ch = 0; ch < cfg->input_channels; ch++) {
+                    const size_t column = column_stride * (ch / channels_per_column);
+                    const unsigned slot = ch % channels_per_column;
+                    const int8_t* iact = spad + column + cfg->base_addr_iact + (size_t)slot * cfg->stride_iact_hw;
+                    const int8_t* wght = spad + column + cfg->base_addr_wght
+                        + (size_t)och * cfg->stride_wght_och + (size_t)slot * cfg->stride_wght_krnl;
+                    for (int ky = 0; ky < kernel; ky++) {
+                        int y = oy + ky - pad;
+                        if (y < 0 || y >= image)
+                            continue;
+                        for (int kx = 0; kx < kernel; kx++) {
+                            int x = ox + kx - pad;
+                            if (x < 0 || x >= image)
+                                continue;
+                            acc += iact[y * cfg->stride_iact_w + x] * wght[ky * kernel + kx];
+                        }
+                    }
+                }
+
+                acc += bias;
+                if (acc > INT32_MAX || acc < INT32_MIN) {
+                    acc = acc > INT32_MAX ? INT32_MAX : INT32_MIN;
+                    overflows++;
+                }
+
+                int32_t psum = acc;
+                if (control.decoded.activation_mode == act_relu && psum < 0)
+                    psum = 0;
+
+                const size_t pixel = (size_t)oy * out + ox;
+                if (control.decoded.requantize) {
+                    float requantized = psum * scale + zeropoint;
+                    long rounded = lround(requantized);
+                    psum_addr[pixel] = rounded > INT8_MAX ? INT8_MAX : rounded < INT8_MIN ? INT8_MIN : rounded;
+                } else
+                    memcpy(psum_addr + pixel * bytes_per_pixel, &psum, bytes_per_pixel);
+            }
+        }
+    }
+
+    return overflows;
+}
+
+static void* _sim_thread_main(void* arg) {
+    struct recacc_sim* sim = arg;
+    const recacc_device* dev = sim->dev;
+
+    pthread_mutex_lock(&sim->lock);
+    while (1) {
+        while (!sim->start_pending && !sim->stop)
+            pthread_cond_wait(&sim->cond, &sim->lock);
+        if (sim->stop)
+            break;
+
+        sim->start_pending = false;
+        uint32_t job_id = sim->job_id;
+        union recacc_control_reg control;
+        control.raw = *_sim_reg(dev, RECACC_REG_IDX_CONTROL);
+        pthread_mutex_unlock(&sim->lock);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        recacc_config cfg;
+        recacc_config_read(dev, &cfg);
+        uint32_t overflows = _sim_convolve(dev, &cfg, control);
+        uint32_t cycles = _sim_cycles(&cfg, control.decoded.requantize ? 1 : SIM_DATA_WIDTH_PSUM / 8);
+
+        // finish no earlier than the modelled hardware run time
+        uint64_t run_ns = (uint64_t)cycles * 1000 / RECACC_ARRAY_CLK_MHZ;
+        struct timespec end = start;
+        end.tv_sec += run_ns / 1000000000;
+        end.tv_nsec += run_ns % 1000000000;
+        if (end.tv_nsec >= 1000000000) {
+            end.tv_sec++;
+            end.tv_nsec -= 1000000000;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end, NULL) == EINTR);
+
+        pthread_mutex_lock(&sim->lock);
+        if (job_id != sim->job_id)
+            continue; // stopped or reset while running
+
+        _sim_set_reg(dev, RECACC_REG_IDX_CYCLE_COUNTER, cycles);
+        _sim_set_reg(dev, RECACC_REG_IDX_PSUM_OVERFLOWS, overflows);
+        _sim_set_reg(dev, RECACC_REG_IDX_STATUS, _sim_idle_status(true, control.decoded.irq_en));
+        if (control.decoded.irq_en)
+            _sim_raise_irq(sim);
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    return NULL;
+}
+
+int recacc_sim_open(recacc_device* dev) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds)) {
+        int err = errno;
+        printf("Failed to create simulated interrupt channel: %s\n", strerror(err));
+        return err;
+    }
+
+    dev->mem = mmap(NULL, RECACC_MEM_MAP_SIZE, PROT_WRITE | PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (dev->mem == MAP_FAILED) {
+        int err = errno;
+        printf("Failed to map simulated memory: %s\n", strerror(err));
+        close(fds[0]);
+        close(fds[1]);
+        dev->mem = 0;
+        return err;
+    }
+
+    struct recacc_sim* sim = calloc(1, sizeof(*sim));
+    if (!sim) {
+        munmap(dev->mem, RECACC_MEM_MAP_SIZE);
+        close(fds[0]);
+        close(fds[1]);
+        dev->mem = 0;
+        return ENOMEM;
+    }
+
+    dev->fd = fds[0];
+    dev->sim = sim;
+
+    sim->dev = dev;
+    sim->irq_fd = fds[1];
+    sim->irq_armed = true;
+    pthread_mutex_init(&sim->lock, NULL);
+    pthread_cond_init(&sim->cond, NULL);
+    _sim_init_regs(dev);
+
+    int ret = pthread_create(&sim->thread, NULL, _sim_thread_main, sim);
+    if (ret) {
+        printf("Failed to start simulation thread: %s\n", strerror(ret));
+        pthread_mutex_destroy(&sim->lock);
+        pthread_cond_destroy(&sim->cond);
+        munmap(dev->mem, RECACC_MEM_MAP_SIZE);
+        close(fds[0]);
+        close(fds[1]);
+        free(sim);
+        dev->sim = NULL;
+        dev->mem = 0;
+        dev->fd = -1;
+        return ret;
+    }
+
+    return 0;
+}
+
+int recacc_sim_close(recacc_device* dev) {
+    struct recacc_sim* sim = dev->sim;
+    if (!sim)
+        return 0;
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stop = true;
+    pthread_cond_signal(&sim->cond);
+    pthread_mutex_unlock(&sim->lock);
+
+    int ret = pthread_join(sim->thread, NULL);
+    if (ret)
+        return ret;
+
+    close(sim->irq_fd);
+    pthread_mutex_destroy(&sim->lock);
+    pthread_cond_destroy(&sim->cond);
+    free(sim);
+    dev->sim = NULL;
+
+    return 0;
+}
+
+void recacc_sim_reg_write(const recacc_device* dev, int regidx, uint32_t value) {
+    struct recacc_sim* sim = dev->sim;
+
+    switch (regidx) {
+        case RECACC_REG_IDX_CONTROL: {
+            union recacc_control_reg old_ctrl, new_ctrl;
+            pthread_mutex_lock(&sim->lock);
+            old_ctrl.raw = *_sim_reg(dev, RECACC_REG_IDX_CONTROL);
+            new_ctrl.raw = value;
+            _sim_set_reg(dev, RECACC_REG_IDX_CONTROL, value);
+            if (new_ctrl.decoded.reset) {
+                sim->job_id++;
+                sim->start_pending = false;
+                _sim_set_reg(dev, RECACC_REG_IDX_STATUS, _sim_idle_status(false, false));
+            } else if (new_ctrl.decoded.start && !old_ctrl.decoded.start) {
+                sim->job_id++;
+                sim->start_pending = true;
+                union recacc_status_reg busy;
+                busy.raw = _sim_idle_status(false, false);
+                busy.decoded.ready = 0;
+                _sim_set_reg(dev, RECACC_REG_IDX_STATUS, busy.raw);
+                pthread_cond_signal(&sim->cond);
+            } else if (!new_ctrl.decoded.start && old_ctrl.decoded.start) {
+                sim->job_id++;
+                sim->start_pending = false;
+                _sim_set_reg(dev, RECACC_REG_IDX_STATUS, _sim_idle_status(false, false));
+            }
+            pthread_mutex_unlock(&sim->lock);
+            break;
+        }
+        case RECACC_REG_IDX_STATUS: {
+            // only the interrupt flag can be cleared
+            union recacc_status_reg status;
+            pthread_mutex_lock(&sim->lock);
+            status.raw = *_sim_reg(dev, RECACC_REG_IDX_STATUS);
+            status.decoded.irq = 0;
+            _sim_set_reg(dev, RECACC_REG_IDX_STATUS, status.raw);
+            pthread_mutex_unlock(&sim->lock);
+            break;
+        }
+        case RECACC_REG_IDX_MAGIC:
+        case RECACC_REG_IDX_ARRAY_SIZE:
+        case RECACC_REG_IDX_LINE_LENGTH_1:
+        case RECACC_REG_IDX_LINE_LENGTH_2:
+        case RECACC_REG_IDX_DATA_WIDTH:
+        case RECACC_REG_IDX_ADDR_WIDTH:
+        case RECACC_REG_IDX_CAPABILITIES:
+        case RECACC_REG_IDX_CYCLE_COUNTER:
+        case RECACC_REG_IDX_PSUM_OVERFLOWS:
+            break; // read-only
+        default:
+            *_sim_reg(dev, regidx) = value;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "types.h"
+
+// software model of the accelerator for hosts without FPGA (selected via recacc_open(dev, RECACC_SIM_DEVICE))
+// the register file and scratchpad live in anonymous memory with the same layout as the uio mapping.
+// starting the accelerator computes the convolution from the scratchpad contents on a simulation thread,
+// fills CYCLE_COUNTER from a rough timing model and raises done (and the interrupt if enabled) after
+// the modelled run time. dev->fd behaves like a uio device (read the interrupt count, write 1 to re-arm).
+
+// set up a simulated device, dev needs to be allocated by the caller
+int recacc_sim_open(recacc_device* dev);
+
+// stop the simulation thread and release the simulation state, called by recacc_close
+int recacc_sim_close(recacc_device* dev);
+
+// register write hook, recacc_reg_write forwards all writes to simulated devices here
+void recacc_sim_reg_write(const recacc_device* dev, int regidx, uint32_t value);
@@ -3,12 +3,6 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-typedef struct {
-    int fd;
-    void* mem;
-    uint8_t hw_revision;
-} recacc_device;
-
 typedef struct {
     uint16_t iact_dimension;  // width and height of input activations (rectangular shape)
     uint8_t  wght_dimension;  // width and height of kernels
@@ -40,6 +34,23 @@ typedef struct {
     uint8_t  stride;
 } recacc_config;
 
+// completion thread state, only available on linux (see linux.h)
+struct recacc_irq_thread;
+
+// simulated device state, only available on linux (see sim.h)
+struct recacc_sim;
+
+typedef struct {
+    int fd;
+    void* mem;
+    uint8_t hw_revision;
+    struct recacc_irq_thread* irq_thread; // NULL if no completion thread is running
+    struct recacc_sim* sim;               // NULL for real hardware
+    recacc_config shadow_cfg; // configuration last written by recacc_config_write
+    bool shadow_valid;        // shadow_cfg matches the register contents
+    uint64_t skipped_writes;  // register writes avoided by the shadow comparison
+} recacc_device;
+
 typedef struct {
     uint32_t array_size_x;
     uint32_t array_size_y;
@@ -95,5 +106,17 @@ enum activation_mode {
     act_none, act_relu
 };
 
+enum wait_mode {
+    wait_poll, wait_irq, wait_adaptive
+};
+
+typedef struct {
+    uint32_t spin_us;        // busy-poll the status register for this long
+    uint32_t sleep_min_us;   // first sleep interval after spinning, doubled after each poll
+    uint32_t sleep_max_us;   // upper bound for the sleep interval
+    uint32_t sleep_total_us; // stop sleeping after this long and block on the interrupt instead
+    bool     irq_fallback;   // if false, keep sleeping until POLL_TIMEOUT_US is reached
+} recacc_wait_params;
+
 typedef int8_t input_t;
 typedef int32_t psum_t;
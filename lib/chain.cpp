@@ -0,0 +1,153 @@
+#include "chain.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+using namespace std;
+
+Conv2DChain::Conv2DChain(recacc_device* dev, const recacc_hwinfo& hwinfo) : dev(dev), hwinfo(hwinfo), spad(hwinfo) {}
+
+void Conv2DChain::add_layer(Conv2D op, const void* wght_buf, size_t wght_bytes,
+        const vector<psum_t>& bias, const vector<float>& factors, const vector<float>& zeropoints) {
+    op.set_recacc_device(dev);
+    op.set_hwinfo(hwinfo);
+
+    bool reads_in_place = false;
+    if (!layers.empty()) {
+        Layer& prev = layers.back();
+        if (!prev.op.get_requantize())
+            throw runtime_error("chained layers must requantize, the next layer reads int8 activations");
+        if (prev.op.get_output_size() != op.get_image_size() || get<1>(prev.op.get_channel_count()) != get<0>(op.get_channel_count()))
+            throw runtime_error("input of " + op.get_parameter_string() + " does not match the output of the previous layer");
+
+        // the previous layer computes its output channels in the order this one reads them from its columns
+        vector<unsigned> order = op.get_in_place_channel_order();
+        reads_in_place = !order.empty();
+        if (reads_in_place)
+            reorder_output_channels(prev, order);
+    }
+
+    layers.push_back({std::move(op), wght_buf, wght_bytes, bias, factors, zeropoints, {}, reads_in_place});
+    reset();
+}
+
+Conv2DResult Conv2DChain::run(const void* iact_buf, size_t iact_bytes, void* psum_buf, size_t psum_bytes) {
+    if (layers.empty())
+        throw runtime_error("no layers to run");
+
+    Conv2DResult result;
+    result.success = true;
+    in_place_count = 0;
+    avoided_bytes = 0;
+    try {
+        for (size_t n = 0; n < layers.size(); n++, step++) {
+            Layer& layer = layers[n];
+            Conv2D& op = layer.op;
+            const string name = "layer" + to_string(n);
+            const bool last = n + 1 == layers.size();
+            spad.advance(step);
+
+            // the previous output is already laid out as iact, it is handed over and kept by allocate_spad.
+            // weights stay for all later runs, psum until the next layer has read it
+            if (n > 0 && layer.reads_in_place)
+                spad.rename("layer" + to_string(n - 1) + ".psum", name + ".iact");
+            op.allocate_spad(spad, name, step);
+            spad.set_last_step(name + ".wght", SpadAllocator::forever);
+            if (!last)
+                spad.set_last_step(name + ".psum", step + 1);
+            op.compute_accelerator_parameters(true);
+
+            const void* wght_buf = layer.reordered_wght.empty() ? layer.wght_buf : layer.reordered_wght.data();
+            if (weights_resident)
+                wght_buf = nullptr;
+            if (n == 0) {
+                op.copy_data_in(iact_buf, iact_bytes, wght_buf, layer.wght_bytes);
+            } else {
+                Conv2D& prev = layers[n - 1].op;
+                op.copy_data_in(nullptr, 0, wght_buf, layer.wght_bytes);
+                if (op.iact_matches_psum_of(prev)) {
+                    in_place_count++;
+                    avoided_bytes += 2 * prev.get_output_channel_bytes() * get<1>(prev.get_channel_count());
+                }
+                op.copy_iact_from_psum(prev);
+            }
+
+            op.configure_accelerator();
+            op.set_postproc_data(layer.bias, layer.factors, layer.zeropoints);
+            op.run_accelerator();
+            bool success = op.wait_until_accelerator_done();
+            result.cycles += op.get_cycle_count();
+            result.wait_latency_ns += op.get_wait_latency_ns();
+            if (!success) {
+                recacc_control_stop(dev);
+                result.success = false;
+                step += layers.size() - n;
+                reset();
+                return result;
+            }
+
+            if (last)
+                op.copy_data_out(psum_buf, psum_bytes);
+            else
+                recacc_control_stop(dev);
+        }
+    } catch (...) {
+        // the scratchpad contents are unknown, start over with the next run
+        reset();
+        throw;
+    }
+
+    weights_resident = true;
+    return result;
+}
+
+size_t Conv2DChain::get_layer_count() const {
+    return layers.size();
+}
+
+size_t Conv2DChain::get_in_place_count() const {
+    return in_place_count;
+}
+
+size_t Conv2DChain::get_avoided_bytes() const {
+    return avoided_bytes;
+}
+
+const SpadAllocator& Conv2DChain::get_allocator() const {
+    return spad;
+}
+
+// output channel och of layer computes what was output channel order[och]: its kernel set, bias, factor and zeropoint
+void Conv2DChain::reorder_output_channels(Layer& layer, const vector<unsigned>& order) {
+    vector<unsigned> identity(order.size());
+    iota(identity.begin(), identity.end(), 0);
+    if (order == identity)
+        return;
+
+    auto reorder = [&](auto& values) {
+        if (values.size() != order.size())
+            return;
+        auto original = values;
+        for (size_t och = 0; och < order.size(); och++)
+            values[och] = original[order[och]];
+    };
+    reorder(layer.bias);
+    reorder(layer.factors);
+    reorder(layer.zeropoints);
+
+    // the weight buffer holds one dense block of kernels per output channel
+    if (layer.wght_buf) {
+        const input_t* wght = static_cast<const input_t*>(layer.wght_buf);
+        const size_t block = layer.wght_bytes / order.size();
+        layer.reordered_wght.resize(layer.wght_bytes);
+        for (size_t och = 0; och < order.size(); och++)
+            copy(wght + order[och] * block, wght + (order[och] + 1) * block, layer.reordered_wght.begin() + och * block);
+    }
+}
+
+void Conv2DChain::reset() {
+    spad.clear();
+    weights_resident = false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "conv2d.hpp"
+#include "executor.hpp"
+#include "spadalloc.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// runs a sequence of layers on one device, each layer reading the requantized output of the previous one directly
+// from the scratchpad. only the input of the first layer is copied in and only the output of the last layer is
+// copied out. the psum region of a layer becomes the iact region of the next one in place if the next layer has one
+// channel per column or channel planes filling whole scratchpad words; for the latter the output channels of the layer
+// are reordered (weights and postprocessing data, see Conv2D::get_in_place_channel_order). other handovers are
+// rearranged by the CPU column by column (see Conv2D::copy_iact_from_psum).
+// weights of all layers stay resident, so repeated runs (e.g. one per image) only copy the input. other operations
+// on the device overwrite them, call reset() after using the scratchpad elsewhere.
+class Conv2DChain {
+public:
+    Conv2DChain(recacc_device* dev, const recacc_hwinfo& hwinfo);
+
+    // append a layer, its input has to match the output of the previous layer, which must requantize
+    // wght is owned by the caller and must stay valid until the first run, unless the output channels are reordered
+    // for the next layer (a reordered copy is kept then)
+    void add_layer(Conv2D op, const void* wght_buf, size_t wght_bytes,
+        const std::vector<psum_t>& bias, const std::vector<float>& factors, const std::vector<float>& zeropoints);
+
+    // run all layers on iact, the dense CHW output of the last layer lands in psum_buf
+    // throws if the tensors of a layer and the resident weights do not fit the scratchpad together
+    Conv2DResult run(const void* iact_buf, size_t iact_bytes, void* psum_buf, size_t psum_bytes);
+
+    size_t get_layer_count() const;
+    size_t get_in_place_count() const; // layers of the last run reading the previous output without any copy
+    size_t get_avoided_bytes() const;  // host traffic avoided by the last run, copy-out plus copy-in of every output read in place
+    const SpadAllocator& get_allocator() const;
+
+    // drop the resident weights, the next run copies them again
+    void reset();
+
+private:
+    struct Layer {
+        Conv2D op;
+        const void* wght_buf;
+        size_t wght_bytes;
+        std::vector<psum_t> bias;
+        std::vector<float> factors;
+        std::vector<float> zeropoints;
+        std::vector<input_t> reordered_wght; // weights in the output channel order of reorder_output_channels
+        bool reads_in_place = false;         // the psum region of the previous layer is the iact region
+    };
+
+    static void reorder_output_channels(Layer& layer, const std::vector<unsigned>& order);
+
+    recacc_device* dev;
+    recacc_hwinfo hwinfo;
+    std::vector<Layer> layers;
+    SpadAllocator spad;
+    unsigned step = 0;
+    bool weights_resident = false;
+    size_t in_place_count = 0;
+    size_t avoided_bytes = 0;
+};
@@ -0,0 +1,63 @@
+#include "cmdqueue.hpp"
+
+using namespace std;
+
+CommandQueue::CommandQueue(recacc_device* dev) : dev(dev) {
+    thread = std::thread(&CommandQueue::worker, this);
+}
+
+// replays all queued buffers before returning
+CommandQueue::~CommandQueue() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    queue_cv.notify_all();
+    thread.join();
+}
+
+future<void> CommandQueue::submit(const recacc_cmdbuf* cb) {
+    promise<void> done;
+    auto fut = done.get_future();
+    {
+        lock_guard<std::mutex> lock(mutex);
+        queue.emplace_back(cb, std::move(done));
+    }
+    queue_cv.notify_one();
+    return fut;
+}
+
+size_t CommandQueue::pending() const {
+    lock_guard<std::mutex> lock(mutex);
+    return queue.size() + running;
+}
+
+void CommandQueue::wait_idle() {
+    unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this] { return queue.empty() && running == 0; });
+}
+
+void CommandQueue::worker() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queue_cv.wait(lock, [this] { return stop || !queue.empty(); });
+        if (queue.empty())
+            break; // stop requested and everything is done
+
+        // take everything queued so far, replaying needs no lock
+        deque<QueuedCommands> batch;
+        batch.swap(queue);
+        running = batch.size();
+        lock.unlock();
+
+        for (auto& commands : batch) {
+            recacc_cmdbuf_replay(dev, commands.first);
+            commands.second.set_value();
+        }
+
+        lock.lock();
+        running = 0;
+        if (queue.empty())
+            idle_cv.notify_all();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+extern "C" {
+    #include <driver.h>
+}
+
+// replays recorded register sequences (see cmdbuf.h) on a dedicated submission thread, in submission order
+// the caller only queues a pointer, so a job's register programming costs the caller no MMIO at all
+// the device must not be programmed from other threads while commands are pending
+class CommandQueue {
+public:
+    explicit CommandQueue(recacc_device* dev);
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    // cb is owned by the caller and must stay valid until the future is ready
+    std::future<void> submit(const recacc_cmdbuf* cb);
+
+    // number of buffers queued or being replayed
+    size_t pending() const;
+
+    // block until all submitted buffers are replayed
+    void wait_idle();
+
+private:
+    using QueuedCommands = std::pair<const recacc_cmdbuf*, std::promise<void>>;
+
+    void worker();
+
+    recacc_device* dev;
+
+    mutable std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::condition_variable idle_cv;
+    std::deque<QueuedCommands> queue;
+    size_t running = 0;
+    bool stop = false;
+    std::thread thread;
+};
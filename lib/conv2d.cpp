@@ -1,5 +1,6 @@
 #include "conv2d.hpp"
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
@@ -9,6 +10,7 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "spadcopy.hpp"
 #include "utils.hpp"
 
 using namespace std;
@@ -16,6 +18,7 @@ using namespace std;
 Conv2D::Conv2D() {
     hwinfo.array_size_x = 0;
     dev = nullptr;
+    recacc_wait_params_init(&wait_params);
 };
 
 Conv2D::~Conv2D() {}
@@ -60,12 +63,23 @@ void Conv2D::set_hwinfo(const recacc_hwinfo& hwinfo) {
     this->hwinfo = hwinfo;
 }
 
-void Conv2D::set_recacc_device(const recacc_device* dev) {
+// a transfer engine of another device is dropped, copies fall back to the cpu until an engine of dev is set
+void Conv2D::set_recacc_device(recacc_device* dev) {
     this->dev = dev;
+    if (transfer && transfer->get_device() != dev)
+        transfer = nullptr;
 }
 
 void Conv2D::use_interrupts(bool enabled) {
-    use_irq = enabled;
+    wait = enabled ? wait_irq : wait_poll;
+}
+
+void Conv2D::set_wait_mode(enum wait_mode mode) {
+    wait = mode;
+}
+
+void Conv2D::set_wait_params(const recacc_wait_params& params) {
+    wait_params = params;
 }
 
 void Conv2D::set_padding_mode(bool enable_same_size_padding) {
@@ -76,6 +90,24 @@ void Conv2D::set_psum_throttle(int value) {
     throttle = value;
 }
 
+// spread copy_data_in over a persistent pool of threads (including the caller), 0 or 1 copies sequentially
+// not combined with a transfer engine, which queues its transfers sequentially anyway
+void Conv2D::set_copy_threads(unsigned threads) {
+    if (threads <= 1)
+        copy_pool.reset();
+    else if (!copy_pool || copy_pool->size() != threads)
+        copy_pool = make_shared<ThreadPool>(threads);
+}
+
+// copy data in and out through engine (e.g. a CdmaTransferEngine), the engine must outlive the operation
+// copy_data_in only starts the transfers, run_accelerator waits for them to complete
+// the engine must belong to the device of the operation if that is set already
+void Conv2D::set_transfer_engine(TransferEngine* engine) {
+    if (engine && dev && engine->get_device() != dev)
+        throw runtime_error("transfer engine belongs to another device");
+    transfer = engine;
+}
+
 // automatically throttle psum output if we expect the bandwidth to be insufficient, since there is no backpressure mechanism
 // calculate an estimate by comparing scratchpad and psum output bandwidth
 void Conv2D::guess_psum_throttle() {
@@ -107,9 +139,27 @@ std::tuple<unsigned, unsigned> Conv2D::get_channel_count() const {
     return {input_channels, output_channels};
 }
 
+std::tuple<unsigned, unsigned> Conv2D::get_output_size() const {
+    if (padding)
+        return {iact_w, iact_h};
+    return {iact_w - wght_w + 1, iact_h - wght_h + 1};
+}
+
+// size of one output channel as written by copy_data_out
+size_t Conv2D::get_output_channel_bytes() {
+    ensure_hwinfo();
+    auto [w, h] = get_output_size();
+    unsigned bits = requantize ? hwinfo.data_width_bits_iact : hwinfo.data_width_bits_psum;
+    return static_cast<size_t>(w) * h * static_cast<size_t>(pow(2, ceil(log2(bits)) - 3));
+}
+
 bool Conv2D::get_padding_mode() const {
     return padding;
 }
+
+int Conv2D::get_psum_throttle() const {
+    return throttle;
+}
 bool Conv2D::get_requantize() const {
     return requantize;
 }
@@ -120,6 +170,7 @@ enum activation_mode Conv2D::get_activation_mode() const {
 
 void Conv2D::compute_accelerator_parameters(bool fixup_channel_alignment) {
     ensure_hwinfo();
+    plan.reset();
 
     assert(iact_w > 0);
     assert(wght_w > 0);
@@ -244,6 +295,53 @@ void Conv2D::compute_accelerator_parameters(bool fixup_channel_alignment) {
     }
 }
 
+Conv2DPlan Conv2D::compile_plan() const {
+    Conv2DPlan p;
+    p.cfg = cfg;
+    p.base_iact = base_iact;
+    p.base_wght = base_wght;
+    p.base_psum = base_psum;
+    p.base_padding = base_padding;
+    p.alloc_size_iact = alloc_size_iact;
+    p.alloc_size_wght = alloc_size_wght;
+    p.alloc_size_psum = alloc_size_psum;
+    p.spad_column_stride = spad_column_stride;
+    p.channels_per_column = channels_per_column;
+    p.bytes_per_psum = bytes_per_psum;
+    p.bytes_per_channel = bytes_per_channel;
+    p.bytes_per_kernel = bytes_per_kernel;
+    p.bytes_per_output_channel = bytes_per_output_channel;
+    p.dummy_channels = dummy_channels;
+    p.throttle = throttle;
+
+    p.iact_bytes = static_cast<size_t>(input_channels) * bytes_per_channel;
+    p.iact_column_offsets.assign(hwinfo.spad_word_size + 1, 0);
+    for (unsigned col = 0; col < hwinfo.spad_word_size; col++)
+        p.iact_column_offsets[col + 1] = p.iact_column_offsets[col] + _column_input_bytes(col, bytes_per_channel, p.iact_bytes - p.iact_column_offsets[col]);
+    return p;
+}
+
+void Conv2D::apply_plan(shared_ptr<const Conv2DPlan> p) {
+    ensure_hwinfo();
+    cfg = p->cfg;
+    base_iact = p->base_iact;
+    base_wght = p->base_wght;
+    base_psum = p->base_psum;
+    base_padding = p->base_padding;
+    alloc_size_iact = p->alloc_size_iact;
+    alloc_size_wght = p->alloc_size_wght;
+    alloc_size_psum = p->alloc_size_psum;
+    spad_column_stride = p->spad_column_stride;
+    channels_per_column = p->channels_per_column;
+    bytes_per_psum = p->bytes_per_psum;
+    bytes_per_channel = p->bytes_per_channel;
+    bytes_per_kernel = p->bytes_per_kernel;
+    bytes_per_output_channel = p->bytes_per_output_channel;
+    dummy_channels = p->dummy_channels;
+    throttle = p->throttle;
+    plan = std::move(p);
+}
+
 void Conv2D::print_accelerator_parameters() {
     cout << "Accelerator run parameters:" << endl;
     cout << "  iact_dimension   " << cfg.iact_dimension << endl;
@@ -273,9 +371,10 @@ void Conv2D::print_accelerator_parameters() {
         cout << "  dummy_channels   " << dummy_channels << " (align to scratchpad layout)" << endl;
 }
 
-// this function is a simple greedy memory allocator and just places iact, wght, psum after each other
-void Conv2D::allocate_spad_auto() {
+// sizes of the buffers in one scratchpad column, shared by the allocators
+void Conv2D::_compute_buffer_sizes() {
     ensure_hwinfo();
+    plan.reset();
 
     bytes_per_channel = iact_h * iact_w;
     bytes_per_kernel = wght_h * wght_w;
@@ -294,6 +393,17 @@ void Conv2D::allocate_spad_auto() {
 
     spad_column_stride = hwinfo.spad_size / hwinfo.spad_word_size;
     channels_per_column = ceil(1.0 * input_channels / hwinfo.spad_word_size);
+}
+
+// this function is a simple greedy memory allocator and just places iact, wght, psum after each other
+// within one of region_count equal slices of every scratchpad column
+void Conv2D::allocate_spad_auto(unsigned region, unsigned region_count) {
+    assert(region < region_count);
+    _compute_buffer_sizes();
+
+    const unsigned region_size = spad_column_stride / region_count / 8 * 8;
+    const unsigned region_begin = region * region_size;
+    const unsigned region_end = region_begin + region_size;
     unsigned output_channels_per_column = ceil(1.0 * output_channels / hwinfo.spad_word_size);
 
     unsigned size_iact = channels_per_column * bytes_per_channel;
@@ -301,11 +411,11 @@ void Conv2D::allocate_spad_auto() {
     unsigned alloc_size_kernel_set = make_multiple_of(8, size_kernel_set);
     unsigned size_wght = output_channels * alloc_size_kernel_set;
 
-    // place iact at scratchpad start
-    base_iact = 0;
+    // place iact at region start
+    base_iact = region_begin;
 
     // place wght directly after iact, aligned to 8 bytes
-    base_wght = make_multiple_of(8, size_iact);
+    base_wght = base_iact + make_multiple_of(8, size_iact);
 
     base_padding = 0;
     // if padding is enabled, a row of zeros is required (1 pixel per column):
@@ -314,8 +424,8 @@ void Conv2D::allocate_spad_auto() {
     // 3) try to fit after kernels and before psum
     // 4) move psum start to make space for padding bytes
     if (padding) {
-        if (size_iact < base_wght)
-            base_padding = size_iact;
+        if (base_iact + size_iact < base_wght)
+            base_padding = base_iact + size_iact;
         else if (size_kernel_set < alloc_size_kernel_set)
             base_padding = base_wght + size_kernel_set;
     }
@@ -333,21 +443,106 @@ void Conv2D::allocate_spad_auto() {
     }
 
     // calculate total allocated memory size per data type in bytes
-    alloc_size_iact = base_wght * hwinfo.spad_word_size;
+    alloc_size_iact = (base_wght - base_iact) * hwinfo.spad_word_size;
     alloc_size_wght = (base_psum - base_wght) * hwinfo.spad_word_size;
-    alloc_size_psum = hwinfo.spad_size - alloc_size_iact - alloc_size_wght;
+    alloc_size_psum = base_psum < region_end ? (region_end - base_psum) * hwinfo.spad_word_size : 0;
 
     // preliminary sanity checks, iact and wght should be fine
-    if (base_iact >= spad_column_stride || alloc_size_iact < bytes_per_channel * input_channels)
+    if (base_iact >= region_end || alloc_size_iact < bytes_per_channel * input_channels)
         throw runtime_error("spad allocation size too small for iact data!");
 
-    if (base_wght >= spad_column_stride || alloc_size_wght < bytes_per_kernel * input_channels * output_channels)
+    if (base_wght >= region_end || alloc_size_wght < bytes_per_kernel * input_channels * output_channels)
         throw runtime_error("spad allocation size too small for wght data!");
 
-    if (base_psum >= spad_column_stride || output_channels_per_column * bytes_per_output_channel >= spad_column_stride - base_psum)
+    if (base_psum >= region_end || output_channels_per_column * bytes_per_output_channel >= region_end - base_psum)
         throw runtime_error("spad allocation size too small for psum data!");
 }
 
+// bytes per scratchpad column taken by the kernel sets of all output channels
+unsigned Conv2D::get_wght_column_bytes() {
+    _compute_buffer_sizes();
+    return output_channels * make_multiple_of(8, channels_per_column * bytes_per_kernel);
+}
+
+// bytes per scratchpad column taken by iact, padding and psum as placed by allocate_spad_wght_at
+unsigned Conv2D::get_data_column_bytes() {
+    _compute_buffer_sizes();
+    unsigned size_iact = channels_per_column * bytes_per_channel;
+    unsigned size_data = make_multiple_of(8, size_iact);
+    if (padding && size_iact == size_data)
+        size_data += 8;
+    unsigned output_channels_per_column = ceil(1.0 * output_channels / hwinfo.spad_word_size);
+    return make_multiple_of(8, size_data + output_channels_per_column * bytes_per_output_channel);
+}
+
+// places the weights at a fixed column offset (e.g. where WeightCache keeps them resident),
+// iact, padding and psum are placed from the column start and have to end before offset_wght
+void Conv2D::allocate_spad_wght_at(unsigned offset_wght) {
+    _compute_buffer_sizes();
+    unsigned size_iact = channels_per_column * bytes_per_channel;
+    unsigned size_wght = get_wght_column_bytes();
+
+    base_iact = 0;
+    base_psum = make_multiple_of(8, size_iact);
+    base_padding = 0;
+    if (padding) {
+        if (size_iact < base_psum)
+            base_padding = size_iact;
+        else {
+            base_padding = base_psum;
+            base_psum += 8; // 1 byte would be sufficient but unaligned
+        }
+    }
+    base_wght = offset_wght;
+
+    if (offset_wght % 8 || offset_wght < get_data_column_bytes() || offset_wght + size_wght > spad_column_stride)
+        throw runtime_error("spad allocation does not fit around wght at offset " + to_string(offset_wght));
+
+    alloc_size_iact = make_multiple_of(8, size_iact) * hwinfo.spad_word_size;
+    alloc_size_psum = (base_wght - base_psum) * hwinfo.spad_word_size;
+    alloc_size_wght = size_wght * hwinfo.spad_word_size;
+}
+
+void Conv2D::allocate_spad(SpadAllocator& spad, const string& name, unsigned last_step) {
+    _compute_buffer_sizes();
+    unsigned output_channels_per_column = ceil(1.0 * output_channels / hwinfo.spad_word_size);
+    const unsigned size_iact = channels_per_column * bytes_per_channel;
+    const unsigned size_wght = output_channels * make_multiple_of(8, channels_per_column * bytes_per_kernel);
+    const unsigned size_psum = output_channels_per_column * make_multiple_of(hwinfo.spad_word_size, bytes_per_output_channel);
+
+    // everything allocated by this call is released again if a later tensor does not fit
+    vector<string> allocated;
+    auto place = [&](const string& tensor, unsigned bytes) {
+        const string full_name = name + "." + tensor;
+        if (spad.contains(full_name)) {
+            const SpadAllocator::Allocation& existing = spad.get(full_name);
+            if (existing.bytes >= bytes) {
+                spad.set_last_step(full_name, max(existing.last_step, last_step));
+                return existing.offset;
+            }
+            spad.release(full_name);
+        }
+        try {
+            unsigned offset = spad.allocate(full_name, bytes, last_step);
+            allocated.push_back(full_name);
+            return offset;
+        } catch (const runtime_error&) {
+            for (const string& n : allocated)
+                spad.release(n);
+            throw;
+        }
+    };
+
+    base_iact = place("iact", size_iact);
+    base_wght = place("wght", size_wght);
+    base_psum = place("psum", size_psum);
+    base_padding = padding ? place("pad", 1) : 0;
+
+    alloc_size_iact = spad.get(name + ".iact").bytes * hwinfo.spad_word_size;
+    alloc_size_wght = spad.get(name + ".wght").bytes * hwinfo.spad_word_size;
+    alloc_size_psum = spad.get(name + ".psum").bytes * hwinfo.spad_word_size;
+}
+
 std::tuple<unsigned, unsigned, unsigned, unsigned> Conv2D::get_buffer_offsets() const {
     return {base_iact, base_wght, base_psum, base_padding};
 }
@@ -359,45 +554,54 @@ void Conv2D::set_buffer_offsets(unsigned offset_iact, unsigned offset_wght, unsi
     base_padding = offset_padding;
 }
 
+// number of bytes taken from the input buffer for column col, the rest of the column is zero padded
+size_t Conv2D::_column_input_bytes(unsigned col, size_t stride_size, size_t bytes_avail) const {
+    // global channels_per_column can be used for both iact and wght channel count per column
+    size_t col_bytes_buf = channels_per_column * stride_size;
+
+    // don't copy all channels if dummies are used, if so reduce by one channel
+    if (col >= hwinfo.spad_word_size - dummy_channels)
+        col_bytes_buf -= stride_size;
+
+    return min(col_bytes_buf, bytes_avail);
+}
+
+// fills column col starting at dst, consumes at most bytes_avail bytes from buf and returns the number of consumed bytes
+size_t Conv2D::_copy_in_column(unsigned col, input_t* dst, size_t stride_size, const input_t* buf, size_t bytes_avail, bool zeropad) {
+    size_t col_bytes = channels_per_column * stride_size;
+    size_t col_bytes_buf = _column_input_bytes(col, stride_size, bytes_avail);
+
+    const input_t* spad = static_cast<const input_t*>(recacc_get_buffer(dev));
+    if (col_bytes_buf && transfer) {
+        // the transfer engine moves exact byte counts, no alignment workaround required
+        transfer->copy_in(dst - spad, buf, col_bytes_buf);
+    } else if (col_bytes_buf) {
+        // cout << "col " << col << " copy " << col_bytes_buf << " bytes to " << (void*)dst << endl;
+        // align copy to multiples of spad_word_size, byte-wise access may be illegal
+        // the aligned remainder is taken from the input buffer if available, otherwise it is zero
+        size_t col_bytes_buf_aligned = make_multiple_of(hwinfo.spad_word_size, col_bytes_buf);
+        size_t copy_bytes = bytes_avail >= col_bytes_buf_aligned ? col_bytes_buf_aligned : col_bytes_buf;
+        spad_copy_in(dst, buf, copy_bytes, col_bytes_buf_aligned);
+    }
+
+    // if input buffer is insufficient, pad with zeros (happens when dummy_channels > 0 or insufficient data provided by caller)
+    if (zeropad && col_bytes > col_bytes_buf) {
+        // cout << "col " << col << " zero " << col_bytes - col_bytes_buf << " bytes at " << (void*)(dst + col_bytes_buf) << endl;
+        if (transfer)
+            transfer->zero(dst + col_bytes_buf - spad, col_bytes - col_bytes_buf);
+        else
+            spad_zero(dst + col_bytes_buf, col_bytes - col_bytes_buf);
+    }
+
+    return col_bytes_buf;
+}
+
 // consumes at most bytes_avail bytes from buf, returns number of remaining bytes in buf
 size_t Conv2D::_copy_in_columnwise(input_t* dst, size_t stride_size, const input_t* buf, size_t bytes_avail, bool zeropad) {
     for (unsigned col = 0; col < hwinfo.spad_word_size; col++) {
-        // global channels_per_column can be used for both iact and wght channel count per column
-        size_t col_bytes = channels_per_column * stride_size;
-
-        // try to copy all data for this column from the input buffer
-        size_t col_bytes_buf = col_bytes;
-
-        // don't copy all channels if dummies are used, if so reduce by one channel
-        if (col >= hwinfo.spad_word_size - dummy_channels)
-            col_bytes_buf -= stride_size;
-
-        if (col_bytes_buf > bytes_avail)
-            col_bytes_buf = bytes_avail;
-
-        if (col_bytes_buf) {
-            // cout << "col " << col << " copy " << col_bytes_buf << " bytes to " << (void*)dst << endl;
-            // align copy to multiples of spad_word_size, byte-wise access may be illegal
-            size_t col_bytes_buf_aligned = make_multiple_of(hwinfo.spad_word_size, col_bytes_buf);
-            if (bytes_avail >= col_bytes_buf_aligned)
-                copy(buf, buf + col_bytes_buf_aligned, dst);
-            else {
-                // make a temporary copy if the buffer is too small
-                input_t tmp[col_bytes_buf_aligned];
-                copy(buf, buf + col_bytes_buf, tmp);
-                fill(tmp + col_bytes_buf, tmp + col_bytes_buf_aligned, 0);
-                copy(tmp, tmp + col_bytes_buf_aligned, dst);
-            }
-            buf += col_bytes_buf;
-            bytes_avail -= col_bytes_buf;
-            col_bytes -= col_bytes_buf;
-        }
-
-        // if input buffer is insufficient, pad with zeros (happens when dummy_channels > 0 or insufficient data provided by caller)
-        if (zeropad && col_bytes) {
-            // cout << "col " << col << " zero " << col_bytes << " bytes at " << (void*)(dst + col_bytes_buf) << endl;
-            fill(dst + col_bytes_buf, dst + col_bytes_buf + col_bytes, 0);
-        }
+        size_t consumed = _copy_in_column(col, dst, stride_size, buf, bytes_avail, zeropad);
+        buf += consumed;
+        bytes_avail -= consumed;
 
         // advance to next column
         dst += spad_column_stride;
@@ -418,6 +622,39 @@ void Conv2D::copy_data_in(const void* iact_buf, size_t iact_bytes, const void* w
 
     input_t* spad = static_cast<input_t*>(recacc_get_buffer(dev));
 
+    if (copy_pool && !transfer) {
+        // iact columns and the kernel sets of all output channels occupy disjoint scratchpad regions,
+        // so they are copied in parallel with the same byte placement as the sequential path below
+        const input_t* iact = static_cast<const input_t*>(iact_buf);
+        const input_t* wght = static_cast<const input_t*>(wght_buf);
+        const unsigned iact_tasks = iact ? hwinfo.spad_word_size : 0;
+        const unsigned wght_tasks = wght ? output_channels : 0;
+
+        vector<size_t> iact_offsets;
+        if (plan && iact_bytes >= plan->iact_bytes) {
+            iact_offsets = plan->iact_column_offsets;
+        } else {
+            iact_offsets.assign(iact_tasks + 1, 0);
+            for (unsigned col = 0; col < iact_tasks; col++)
+                iact_offsets[col + 1] = iact_offsets[col] + _column_input_bytes(col, bytes_per_channel, iact_bytes - iact_offsets[col]);
+        }
+
+        copy_pool->parallel_for(iact_tasks + wght_tasks, [&](size_t task) {
+            if (task < iact_tasks) {
+                _copy_in_column(task, spad + base_iact + task * spad_column_stride, bytes_per_channel,
+                    iact + iact_offsets[task], iact_bytes - iact_offsets[task], false);
+            } else {
+                size_t och = task - iact_tasks;
+                size_t offset = och * input_channels * bytes_per_kernel;
+                _copy_in_columnwise(spad + base_wght + och * cfg.stride_wght_och, bytes_per_kernel,
+                    wght + offset, wght_bytes > offset ? wght_bytes - offset : 0, true);
+            }
+        });
+
+        iact_buf = nullptr;
+        wght_buf = nullptr;
+    }
+
     if (iact_buf != nullptr) {
         // copy iact data column-wise
         // to speed up copying, channels are not mapped ch0+ch8 -> col0, ch1+ch9 -> col1,
@@ -442,47 +679,272 @@ void Conv2D::copy_data_in(const void* iact_buf, size_t iact_bytes, const void* w
         // make sure there is one zero bytes per column for zero padding
         input_t* pad_addr = spad + base_padding;
         for (unsigned col = 0; col < hwinfo.spad_word_size; col++) {
-            *pad_addr = 0;
+            if (transfer)
+                transfer->zero(pad_addr - spad, 1);
+            else
+                *pad_addr = 0;
             pad_addr += spad_column_stride;
         }
     }
+
+    if (transfer)
+        transfer->start();
 }
 
-void Conv2D::set_postproc_data(const vector<psum_t>& bias, const vector<float>& factors, const vector<float>& zeropoints) {
-    ensure_hwinfo();
+// writes the planes of channels first_channel.. of image (or output channel) n of src one after another to the column
+// at dst, followed by zeros up to bytes_total. strided elements are gathered through a small host buffer, so the
+// scratchpad only sees the wide aligned stores of spad_copy_in and the source is read once
+void Conv2D::_gather_column(input_t* dst, const HostTensor& src, unsigned n, unsigned first_channel, unsigned channels, size_t bytes_total) {
+    constexpr size_t chunk_bytes = 4096;
+    alignas(64) input_t chunk[chunk_bytes];
+    size_t fill = 0;
+    size_t written = 0;
+
+    // a plane whose rows follow each other with the element stride (not a region of interest) is one long row
+    const bool flat = src.stride_y == src.w * src.stride_x;
+    const unsigned rows = flat ? 1 : src.h;
+    const unsigned row_length = flat ? src.h * src.w : src.w;
+
+    for (unsigned c = first_channel; c < first_channel + channels; c++) {
+        for (unsigned y = 0; y < rows; y++) {
+            const input_t* row = src.at(n, c, y, 0);
+            for (unsigned x = 0; x < row_length;) {
+                const size_t count = min<size_t>(row_length - x, chunk_bytes - fill);
+                if (src.stride_x == 1) {
+                    memcpy(chunk + fill, row + x, count);
+                } else {
+                    const input_t* s = row + x * src.stride_x;
+                    for (size_t i = 0; i < count; i++, s += src.stride_x)
+                        chunk[fill + i] = *s;
+                }
+                fill += count;
+                x += count;
+                if (fill == chunk_bytes) {
+                    spad_copy_in(dst + written, chunk, chunk_bytes, chunk_bytes);
+                    written += chunk_bytes;
+                    fill = 0;
+                }
+            }
+        }
+    }
 
-    // cout << "writing " << static_cast<unsigned>(hwinfo.max_output_channels) << " bias/scale regs" << endl;
+    spad_copy_in(dst + written, chunk, fill, max(fill, bytes_total > written ? bytes_total - written : 0));
+}
 
-    // write to bias birst, then factors, then zeropoints continuously to potentially merge writes on AXI
-    for (size_t n = 0; n < hwinfo.max_output_channels; n++) {
-        const unsigned idx = RECACC_REG_IDX_BIAS_REQUANT_BASE + n;
-        uint32_t value = 0;
-        if (n < bias.size())
-            value = bias[n];
-        recacc_reg_write(dev, idx, value);
+void Conv2D::copy_data_in(const HostTensor* iact, const HostTensor* wght) {
+    ensure_hwinfo();
+
+    if (iact && (iact->n != 1 || iact->c != input_channels || iact->h != iact_h || iact->w != iact_w))
+        throw runtime_error("iact tensor does not match " + get_parameter_string());
+    if (wght && (wght->n != output_channels || wght->c != input_channels || wght->h != wght_h || wght->w != wght_w))
+        throw runtime_error("wght tensor does not match " + get_parameter_string());
+
+    // dense tensors are plain buffers. the transfer engine needs contiguous host memory, other layouts are converted
+    // on the host for it. the buffer path also writes the padding row
+    vector<input_t> iact_dense, wght_dense;
+    const input_t* iact_buf = nullptr;
+    const input_t* wght_buf = nullptr;
+    const HostTensor* iact_gather = nullptr;
+    const HostTensor* wght_gather = nullptr;
+    if (iact && iact->is_dense_nchw()) {
+        iact_buf = iact->data;
+    } else if (iact && transfer) {
+        iact_dense.resize(iact->size());
+        iact->copy_to_nchw(iact_dense.data());
+        iact_buf = iact_dense.data();
+    } else {
+        iact_gather = iact;
+    }
+    if (wght && wght->is_dense_nchw()) {
+        wght_buf = wght->data;
+    } else if (wght && transfer) {
+        wght_dense.resize(wght->size());
+        wght->copy_to_nchw(wght_dense.data());
+        wght_buf = wght_dense.data();
+    } else {
+        wght_gather = wght;
     }
 
-    for (size_t n = 0; n < hwinfo.max_output_channels; n++) {
-        const unsigned idx = RECACC_REG_IDX_BIAS_REQUANT_BASE + hwinfo.max_output_channels + n;
-        float value = 0.0;
-        if (n < factors.size())
-            value = factors[n];
-        uint32_t buf;
-        memcpy(&buf, &value, sizeof(buf));
-        recacc_reg_write(dev, idx, buf);
+    if (iact_gather && static_cast<size_t>(input_channels) * bytes_per_channel > alloc_size_iact)
+        throw runtime_error("spad memory too small for iact data!");
+    if (wght_gather && wght_gather->size() > alloc_size_wght)
+        throw runtime_error("spad memory too small for wght data!");
+
+    // iact columns and the kernel sets of all output channels are written in the layout of _copy_in_columnwise
+    input_t* spad = static_cast<input_t*>(recacc_get_buffer(dev));
+    const unsigned iact_tasks = iact_gather ? hwinfo.spad_word_size : 0;
+    const unsigned wght_tasks = wght_gather ? output_channels : 0;
+    vector<unsigned> first_channel(hwinfo.spad_word_size + 1, 0);
+    for (unsigned col = 0; col < hwinfo.spad_word_size; col++)
+        first_channel[col + 1] = first_channel[col]
+            + _column_input_bytes(col, 1, input_channels - first_channel[col]);
+
+    auto gather = [&](size_t task) {
+        if (task < iact_tasks) {
+            unsigned col = task;
+            size_t col_bytes_buf = (first_channel[col + 1] - first_channel[col]) * bytes_per_channel;
+            if (col_bytes_buf)
+                _gather_column(spad + base_iact + col * spad_column_stride, *iact_gather, 0, first_channel[col],
+                    first_channel[col + 1] - first_channel[col], make_multiple_of(hwinfo.spad_word_size, col_bytes_buf));
+        } else {
+            unsigned och = task - iact_tasks;
+            input_t* wght_addr = spad + base_wght + och * cfg.stride_wght_och;
+            for (unsigned col = 0; col < hwinfo.spad_word_size; col++) {
+                // unused kernel slots of dummy channels are zero, as with zeropad in _copy_in_column
+                size_t col_bytes_buf = (first_channel[col + 1] - first_channel[col]) * bytes_per_kernel;
+                size_t col_bytes = channels_per_column * bytes_per_kernel;
+                _gather_column(wght_addr + col * spad_column_stride, *wght_gather, och, first_channel[col],
+                    first_channel[col + 1] - first_channel[col], max(make_multiple_of(hwinfo.spad_word_size, col_bytes_buf), col_bytes));
+            }
+        }
+    };
+    if (copy_pool)
+        copy_pool->parallel_for(iact_tasks + wght_tasks, gather);
+    else
+        for (size_t task = 0; task < iact_tasks + wght_tasks; task++)
+            gather(task);
+
+    copy_data_in(iact_buf, iact_buf ? iact->size() : 0, wght_buf, wght_buf ? wght->size() : 0);
+}
+
+bool Conv2D::iact_matches_psum_of(const Conv2D& producer) const {
+    if (base_iact != producer.base_psum)
+        return false;
+    // one channel per column, output channel och is in column och just as input channel och
+    if (channels_per_column == 1)
+        return true;
+    // output channel och is in slot och / spad_word_size of column och % spad_word_size, the slots of the psum
+    // rounds have to be as large as the iact channel slots
+    return producer.cfg.stride_psum_och * hwinfo.spad_word_size == bytes_per_channel;
+}
+
+vector<unsigned> Conv2D::get_in_place_channel_order() {
+    _compute_buffer_sizes();
+    const unsigned columns = hwinfo.spad_word_size;
+    if (channels_per_column > 1 && bytes_per_channel % columns)
+        return {};
+
+    // same distribution as _column_input_bytes, the last dummy columns hold one channel less
+    const unsigned full_columns = columns - (make_multiple_of(columns, input_channels) - input_channels);
+    vector<unsigned> order(input_channels);
+    for (unsigned och = 0; och < input_channels; och++) {
+        unsigned col = och % columns;
+        unsigned first_channel = col < full_columns ? col * channels_per_column
+            : full_columns * channels_per_column + (col - full_columns) * (channels_per_column - 1);
+        order[och] = first_channel + och / columns;
     }
+    return order;
+}
 
-    for (size_t n = 0; n < hwinfo.max_output_channels; n++) {
-        const unsigned idx = RECACC_REG_IDX_BIAS_REQUANT_BASE + 2 * hwinfo.max_output_channels + n;
-        float value = 0.0;
-        if (n < zeropoints.size())
-            value = zeropoints[n];
-        uint32_t buf;
-        memcpy(&buf, &value, sizeof(buf));
-        recacc_reg_write(dev, idx, buf);
+void Conv2D::copy_iact_from_psum(const Conv2D& producer) {
+    ensure_hwinfo();
+    auto [producer_w, producer_h] = producer.get_output_size();
+    if (!producer.requantize)
+        throw runtime_error("chained operation requires requantized output of the previous operation");
+    if (producer.output_channels != input_channels || producer_w != iact_w || producer_h != iact_h)
+        throw runtime_error("output of the previous operation does not match the input of " + get_parameter_string());
+    if (producer.bytes_per_output_channel != bytes_per_channel)
+        throw runtime_error("previous operation does not produce one byte per pixel");
+
+    if (iact_matches_psum_of(producer))
+        return;
+
+    // gather the channels of every iact column from the psum layout (output channel och in column och % spad_word_size)
+    // and write the column at once, the same channel distribution as _copy_in_columnwise
+    input_t* spad = static_cast<input_t*>(recacc_get_buffer(dev));
+    const size_t col_bytes = channels_per_column * bytes_per_channel;
+    const SpadTensorLayout psum_layout = producer.get_psum_layout();
+    vector<input_t> column(make_multiple_of(hwinfo.spad_word_size, col_bytes));
+    const size_t iact_bytes = static_cast<size_t>(input_channels) * bytes_per_channel;
+    size_t consumed = 0;
+    for (unsigned col = 0; col < hwinfo.spad_word_size; col++) {
+        size_t col_bytes_buf = _column_input_bytes(col, bytes_per_channel, iact_bytes - consumed);
+        unsigned first_channel = consumed / bytes_per_channel;
+        for (unsigned n = 0; n < col_bytes_buf / bytes_per_channel; n++)
+            spad_copy_out(column.data() + n * bytes_per_channel, spad + psum_layout.plane_offset(first_channel + n), bytes_per_channel);
+        spad_copy_in(spad + base_iact + col * spad_column_stride, column.data(), col_bytes_buf, make_multiple_of(hwinfo.spad_word_size, col_bytes_buf));
+        consumed += col_bytes_buf;
     }
 }
 
+SpadTensorLayout Conv2D::get_iact_layout() const {
+    SpadTensorLayout layout;
+    layout.base = base_iact;
+    layout.column_stride = spad_column_stride;
+    layout.columns = hwinfo.spad_word_size;
+    layout.channels = input_channels;
+    layout.height = iact_h;
+    layout.width = iact_w;
+    layout.element_bytes = sizeof(input_t);
+    layout.plane_bytes = bytes_per_channel;
+    // same distribution as _column_input_bytes, the last dummy_channels columns hold one channel less
+    layout.channels_per_column = channels_per_column;
+    layout.full_columns = hwinfo.spad_word_size - dummy_channels;
+    return layout;
+}
+
+SpadTensorLayout Conv2D::get_wght_layout(unsigned output_channel) const {
+    if (output_channel >= output_channels)
+        throw runtime_error("output channel " + to_string(output_channel) + " out of range for " + get_parameter_string());
+
+    // the kernels of one output channel are distributed like the iact channels
+    SpadTensorLayout layout = get_iact_layout();
+    layout.base = base_wght + output_channel * cfg.stride_wght_och;
+    layout.height = wght_h;
+    layout.width = wght_w;
+    layout.plane_bytes = bytes_per_kernel;
+    return layout;
+}
+
+SpadTensorLayout Conv2D::get_psum_layout() const {
+    auto [w, h] = get_output_size();
+    SpadTensorLayout layout;
+    layout.base = base_psum;
+    layout.column_stride = spad_column_stride;
+    layout.columns = hwinfo.spad_word_size;
+    layout.channels = output_channels;
+    layout.height = h;
+    layout.width = w;
+    layout.element_bytes = bytes_per_psum;
+    layout.plane_bytes = bytes_per_output_channel;
+    // output channel och is in column och % spad_word_size, see copy_data_out
+    layout.channels_per_column = 0;
+    layout.round_stride = cfg.stride_psum_och * hwinfo.spad_word_size;
+    return layout;
+}
+
+SpadTensorView<input_t> Conv2D::iact_view() {
+    return SpadTensorView<input_t>(recacc_get_buffer(dev), get_iact_layout());
+}
+
+SpadTensorView<input_t> Conv2D::wght_view(unsigned output_channel) {
+    return SpadTensorView<input_t>(recacc_get_buffer(dev), get_wght_layout(output_channel));
+}
+
+// register values of bias, then factors, then zeropoints, each padded to max_output_channels
+vector<uint32_t> Conv2D::_postproc_register_values(const vector<psum_t>& bias, const vector<float>& factors, const vector<float>& zeropoints) {
+    ensure_hwinfo();
+
+    vector<uint32_t> values(3 * hwinfo.max_output_channels, 0);
+    for (size_t n = 0; n < hwinfo.max_output_channels && n < bias.size(); n++)
+        values[n] = bias[n];
+
+    for (size_t n = 0; n < hwinfo.max_output_channels && n < factors.size(); n++)
+        memcpy(&values[hwinfo.max_output_channels + n], &factors[n], sizeof(uint32_t));
+
+    for (size_t n = 0; n < hwinfo.max_output_channels && n < zeropoints.size(); n++)
+        memcpy(&values[2 * hwinfo.max_output_channels + n], &zeropoints[n], sizeof(uint32_t));
+
+    return values;
+}
+
+void Conv2D::set_postproc_data(const vector<psum_t>& bias, const vector<float>& factors, const vector<float>& zeropoints) {
+    // write to bias birst, then factors, then zeropoints continuously to potentially merge writes on AXI
+    vector<uint32_t> values = _postproc_register_values(bias, factors, zeropoints);
+    for (size_t n = 0; n < values.size(); n++)
+        recacc_reg_write(dev, RECACC_REG_IDX_BIAS_REQUANT_BASE + n, values[n]);
+}
+
 void Conv2D::configure_accelerator() {
     recacc_config_write(dev, &cfg);
 }
@@ -526,7 +988,21 @@ unsigned Conv2D::get_cycle_count() const {
     return cycles;
 }
 
-void Conv2D::run_accelerator() {
+unsigned Conv2D::get_copy_threads() const {
+    return copy_pool ? copy_pool->size() : 1;
+}
+
+TransferEngine* Conv2D::get_transfer_engine() const {
+    return transfer;
+}
+
+// time between entering wait_until_accelerator_done and observing completion
+uint64_t Conv2D::get_wait_latency_ns() const {
+    return wait_latency_ns;
+}
+
+// throws if the hardware can't run this operation, waits for a pending copy-in
+void Conv2D::_check_start() {
     ensure_hwinfo();
 
     if (!hwinfo.bias_requant_available) {
@@ -537,13 +1013,58 @@ void Conv2D::run_accelerator() {
             throw runtime_error("activation requested but no postproc support in hardware");
     }
 
-    recacc_control_start(dev, requantize, act_mode, use_irq, padding);
+    if (transfer && !transfer->wait())
+        throw runtime_error("transfer to scratchpad failed");
+}
+
+void Conv2D::run_accelerator() {
+    _check_start();
+
+    bool enable_irq = wait == wait_irq || (wait == wait_adaptive && wait_params.irq_fallback);
+    recacc_control_start(dev, requantize, act_mode, enable_irq, padding);
+}
+
+void Conv2D::record_accelerator_job(recacc_cmdbuf& cb, const vector<psum_t>& bias, const vector<float>& factors,
+    const vector<float>& zeropoints, bool start) {
+    ensure_hwinfo();
+    recacc_cmdbuf_init(&cb);
+
+    int ret = recacc_cmdbuf_config(&cb, &cfg, dev->hw_revision);
+
+    if (!ret) {
+        vector<uint32_t> values = _postproc_register_values(bias, factors, zeropoints);
+        ret = recacc_cmdbuf_write_range(&cb, RECACC_REG_IDX_BIAS_REQUANT_BASE, values.data(), values.size());
+    }
+
+    if (start && !ret) {
+        bool enable_irq = wait == wait_irq || (wait == wait_adaptive && wait_params.irq_fallback);
+        ret = recacc_cmdbuf_control_start(&cb, requantize, act_mode, enable_irq, padding);
+    }
+
+    if (ret)
+        throw runtime_error("register command buffer too small");
+}
+
+void Conv2D::run_recorded(const recacc_cmdbuf& cb) {
+    _check_start();
+    recacc_cmdbuf_replay(dev, &cb);
 }
 
 // wait for accelerator to finish and copy data back, returns true on success
 bool Conv2D::wait_until_accelerator_done() {
     // wait for accelerator to finish
-    bool success = recacc_wait(dev, !use_irq);
+    bool success;
+    if (wait == wait_adaptive)
+        success = recacc_wait_adaptive(dev, &wait_params, &wait_latency_ns);
+    else {
+        #ifdef __linux__
+        auto t1 = chrono::steady_clock::now();
+        #endif
+        success = recacc_wait(dev, wait == wait_poll);
+        #ifdef __linux__
+        wait_latency_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t1).count();
+        #endif
+    }
     if (!success) {
         cerr << "ERROR: timeout waiting for hardware, probably stuck!" << endl;
         return false;
@@ -560,7 +1081,8 @@ bool Conv2D::wait_until_accelerator_done() {
     return true;
 }
 
-void Conv2D::copy_data_out(void* psum_buf, size_t psum_bytes) {
+// stop_accelerator = false leaves the control logic alone, e.g. if the next job already runs from another region
+void Conv2D::copy_data_out(void* psum_buf, size_t psum_bytes, bool stop_accelerator) {
     // we actually don't care if the buffer is too small, the user does not get all results
     if (psum_bytes > alloc_size_psum)
         throw runtime_error("copy_data_out requesting more data than allocated");
@@ -572,40 +1094,268 @@ void Conv2D::copy_data_out(void* psum_buf, size_t psum_bytes) {
 
     // cout << "copy_data_out psum_bytes " << psum_bytes << " copy_och_count " << copy_och_count << " bytes_per_output_channel " << bytes_per_output_channel << endl;
 
+    const SpadTensorLayout layout = get_psum_layout();
+    if (transfer) {
+        int8_t* dst = static_cast<int8_t*>(psum_buf);
+        for (unsigned och = 0; och < copy_och_count; och++) {
+            transfer->copy_out(dst, layout.plane_offset(och), bytes_per_output_channel);
+            dst += bytes_per_output_channel;
+        }
+        transfer->start();
+        bool ok = transfer->wait();
+        if (stop_accelerator)
+            recacc_control_stop(dev);
+        if (!ok)
+            throw runtime_error("transfer from scratchpad failed");
+        return;
+    }
+
     int8_t* dst = static_cast<int8_t*>(psum_buf);
     int8_t* psum_addr = nullptr;
     for (unsigned och = 0; och < copy_och_count; och++) {
-        psum_addr = static_cast<int8_t*>(recacc_get_buffer(dev)) + base_psum
-                    + cfg.stride_psum_och * (och / hwinfo.spad_word_size) * hwinfo.spad_word_size
-                    + spad_column_stride * (och % hwinfo.spad_word_size);
+        psum_addr = static_cast<int8_t*>(recacc_get_buffer(dev)) + layout.plane_offset(och);
 
         // cout << "copy_data_out och " << och << " psum_addr " << (void*)(psum_addr) << " dst " << (void*)(dst) << endl;
 
-        // TODO: improve copy-out. we do manual 32bit reads here to allow 4-byte aligned output channel sizes
-        // i.e. reading 900 bytes for 30x30 output image would fail with memcpy for 2nd channel,
-        // cause the target address + 900 is not aligned to 8-byte anymore (and on aarch64 64bit copy is default)
-        // we can at least choose whether we need a single-byte copy. std::copy does still lead to bus errors in some cases.
-        if (reinterpret_cast<uint64_t>(psum_addr) % 4 || reinterpret_cast<uint64_t>(dst) % 4) {
-            for (size_t n = 0; n < bytes_per_output_channel; n++)
-                dst[n] = psum_addr[n];
-        } else /* if (reinterpret_cast<uint64_t>(psum_addr) % 8 || reinterpret_cast<uint64_t>(dst) % 8) */ {
-            uint32_t* psum_addr32 = reinterpret_cast<uint32_t*>(psum_addr);
-            uint32_t* dst32 = reinterpret_cast<uint32_t*>(dst);
-            for (size_t n = 0; n < (bytes_per_output_channel + 3) / 4; n++)
-                dst32[n] = psum_addr32[n];
-        // } else {
-        //     copy(psum_addr, psum_addr + bytes_per_output_channel, dst);
-        }
-
-        // this special memcpy makes sure to align the call to actual memcpy to work around device memory alignment issues
-        // however, it turns out to be even slower than the 32bit for-loop copy
-        // memcpy_align_src(dst, psum_addr, bytes_per_output_channel);
+        // aligned wide loads from the scratchpad, output channels of e.g. 30x30 bytes leave dst unaligned for every other channel
+        spad_copy_out(dst, psum_addr, bytes_per_output_channel);
 
         dst += bytes_per_output_channel;
     }
 
     // deassert start bit, this resets the control logic and allows for starting the next iteration
-    recacc_control_stop(dev);
+    if (stop_accelerator)
+        recacc_control_stop(dev);
+}
+
+// writes count elements of T from chunk row by row with the element stride of dst, starting at (ch, y, x)
+// returns the position after the last element
+template<typename T> static tuple<unsigned, unsigned> scatter_elements(const HostOutputTensor& dst, unsigned ch, unsigned y, unsigned x,
+        const uint8_t* chunk, size_t count) {
+    const T* src = reinterpret_cast<const T*>(chunk);
+    while (count) {
+        const size_t n = min<size_t>(count, dst.w - x);
+        T* out = static_cast<T*>(dst.at(ch, y, x));
+        for (size_t i = 0; i < n; i++)
+            out[i * dst.stride_x] = src[i];
+        src += n;
+        count -= n;
+        x += n;
+        if (x == dst.w) {
+            x = 0;
+            y++;
+        }
+    }
+    return {y, x};
+}
+
+void Conv2D::copy_data_out(const HostOutputTensor& psum, bool stop_accelerator) {
+    auto [w, h] = get_output_size();
+    if (psum.w != w || psum.h != h || psum.c > output_channels || psum.element_bytes != bytes_per_psum)
+        throw runtime_error("psum tensor does not match " + get_parameter_string());
+
+    if (psum.is_dense_chw()) {
+        copy_data_out(psum.data, psum.c * bytes_per_output_channel, stop_accelerator);
+        return;
+    }
+
+    const SpadTensorLayout layout = get_psum_layout();
+    const size_t row_bytes = static_cast<size_t>(w) * bytes_per_psum;
+
+    // the transfer engine writes packed rows straight to their pitch, whole planes if the rows of a plane are packed
+    if (transfer && psum.stride_x == 1) {
+        const bool packed_planes = psum.stride_y == static_cast<ptrdiff_t>(w);
+        for (unsigned och = 0; och < psum.c; och++) {
+            if (packed_planes)
+                transfer->copy_out(psum.at(och, 0, 0), layout.plane_offset(och), bytes_per_output_channel);
+            else
+                for (unsigned y = 0; y < h; y++)
+                    transfer->copy_out(psum.at(och, y, 0), layout.plane_offset(och) + y * row_bytes, row_bytes);
+        }
+        transfer->start();
+        bool ok = transfer->wait();
+        if (stop_accelerator)
+            recacc_control_stop(dev);
+        if (!ok)
+            throw runtime_error("transfer from scratchpad failed");
+        return;
+    }
+
+    const uint8_t* spad = static_cast<const uint8_t*>(recacc_get_buffer(dev));
+    constexpr size_t chunk_bytes = 4096;
+    alignas(64) uint8_t chunk[chunk_bytes];
+    for (unsigned och = 0; och < psum.c; och++) {
+        const uint8_t* psum_addr = spad + layout.plane_offset(och);
+
+        if (psum.stride_x == 1) {
+            // packed rows at a pitch, every row straight from the scratchpad
+            for (unsigned y = 0; y < h; y++)
+                spad_copy_out(psum.at(och, y, 0), psum_addr + y * row_bytes, row_bytes);
+            continue;
+        }
+
+        // interleaved channels: aligned reads of the plane into a small host buffer, scattered with the element stride
+        unsigned y = 0, x = 0;
+        for (size_t offset = 0; offset < bytes_per_output_channel; offset += chunk_bytes) {
+            const size_t bytes = min<size_t>(chunk_bytes, bytes_per_output_channel - offset);
+            spad_copy_out(chunk, psum_addr + offset, bytes);
+            if (bytes_per_psum == sizeof(psum_t))
+                tie(y, x) = scatter_elements<psum_t>(psum, och, y, x, chunk, bytes / sizeof(psum_t));
+            else
+                tie(y, x) = scatter_elements<int8_t>(psum, och, y, x, chunk, bytes);
+        }
+    }
+
+    if (stop_accelerator)
+        recacc_control_stop(dev);
+}
+
+// pools the planes of the psum layout into the channels of dst. the window rows of one output row are kept in a
+// small host buffer: each step reads the stride new rows with one copy and keeps the rows shared with the next windows
+// (one for 3x3 at stride 2), so every row is read once and only the rows covered by windows are read
+template<typename T> static void pool_channels(const Pool2D& pool, const HostOutputTensor& dst, unsigned width,
+        const uint8_t* spad, const SpadTensorLayout& layout) {
+    const size_t row_bytes = width * sizeof(T);
+    const unsigned new_rows = min(pool.stride, pool.size);
+    const unsigned kept_rows = pool.size - new_rows;
+    vector<T> window(static_cast<size_t>(pool.size) * width);
+    vector<const T*> rows(pool.size);
+    for (unsigned i = 0; i < pool.size; i++)
+        rows[i] = &window[i * width];
+
+    for (unsigned och = 0; och < dst.c; och++) {
+        const uint8_t* plane = spad + layout.plane_offset(och);
+        for (unsigned py = 0; py < dst.h; py++) {
+            const unsigned first = py ? py * pool.stride + kept_rows : 0;
+            const unsigned count = py ? new_rows : pool.size;
+            if (py && kept_rows)
+                memmove(window.data(), &window[new_rows * width], kept_rows * row_bytes);
+            T* target = &window[(pool.size - count) * width];
+            spad_copy_out(target, plane + first * row_bytes, count * row_bytes);
+            pool.pool_row(rows.data(), width, static_cast<T*>(dst.at(och, py, 0)), dst.stride_x);
+        }
+    }
+}
+
+void Conv2D::copy_data_out(const HostOutputTensor& psum, const Pool2D& pool, bool stop_accelerator) {
+    auto [w, h] = get_output_size();
+    if (!pool.size || !pool.stride)
+        throw runtime_error("pooling size and stride must not be zero");
+    if (psum.w != pool.output_size(w) || psum.h != pool.output_size(h) || !psum.w || !psum.h
+            || psum.c > output_channels || psum.element_bytes != bytes_per_psum)
+        throw runtime_error("pooled psum tensor does not match " + get_parameter_string());
+
+    // the CPU pools the window rows as it reads them, a transfer engine set on this operation is not used
+    const uint8_t* spad = static_cast<const uint8_t*>(recacc_get_buffer(dev));
+    if (bytes_per_psum == sizeof(psum_t))
+        pool_channels<psum_t>(pool, psum, w, spad, get_psum_layout());
+    else
+        pool_channels<int8_t>(pool, psum, w, spad, get_psum_layout());
+
+    if (stop_accelerator)
+        recacc_control_stop(dev);
+}
+
+Conv2DBatchResult Conv2D::run_batch(const vector<const void*>& iact_bufs, size_t iact_bytes,
+        const void* wght_buf, size_t wght_bytes, const vector<void*>& psum_bufs, size_t psum_bytes,
+        const vector<psum_t>& bias, const vector<float>& factors, const vector<float>& zeropoints) {
+    using timer = chrono::steady_clock;
+    if (iact_bufs.size() != psum_bufs.size())
+        throw runtime_error("run_batch requires one psum buffer per iact buffer");
+    if (wght_buf == nullptr)
+        throw runtime_error("run_batch requires the weights");
+    ensure_hwinfo();
+
+    Conv2DBatchResult result;
+    auto t_start = timer::now();
+
+    // plan the operation in one of region_count scratchpad regions, throws if it does not fit
+    auto plan_region = [this](unsigned region, unsigned region_count) {
+        Conv2D planned = *this;
+        planned.allocate_spad_auto(region, region_count);
+        planned.compute_accelerator_parameters(true);
+        return make_shared<const Conv2DPlan>(planned.compile_plan());
+    };
+
+    // image n runs in plans[n % plans.size()]. with both scratchpad halves, the iact of the next image is copied
+    // into the idle half while the accelerator runs, and the psums are read back while the next image runs
+    vector<shared_ptr<const Conv2DPlan>> plans;
+    if (iact_bufs.size() > 1) {
+        try {
+            plans = {plan_region(0, 2), plan_region(1, 2)};
+        } catch (const runtime_error&) {
+            plans.clear();
+        }
+    }
+    if (plans.empty())
+        plans = {plan_region(0, 1)};
+    result.double_buffered = plans.size() > 1;
+    auto use_plan = [&](size_t n) { apply_plan(plans[n % plans.size()]); };
+
+    // the weights are copied into every region once, the configuration only differs in the base addresses
+    for (size_t n = 0; n < plans.size(); n++) {
+        use_plan(n);
+        copy_data_in(nullptr, 0, wght_buf, wght_bytes);
+        if (transfer && !transfer->wait())
+            throw runtime_error("transfer to scratchpad failed");
+    }
+    set_postproc_data(bias, factors, zeropoints);
+    result.setup = timer::now() - t_start;
+
+    const size_t count = iact_bufs.size();
+    result.images.resize(count);
+    auto copy_in = [&](size_t n) {
+        auto t = timer::now();
+        use_plan(n);
+        copy_data_in(iact_bufs[n], iact_bytes, nullptr, 0);
+        result.images[n].copy_in = timer::now() - t;
+    };
+    timer::time_point t_run;
+    auto start = [&](size_t n) {
+        use_plan(n);
+        configure_accelerator();
+        run_accelerator();
+        t_run = timer::now();
+    };
+
+    result.success = true;
+    if (count) {
+        copy_in(0);
+        start(0);
+    }
+    for (size_t n = 0; n < count; n++) {
+        Conv2DImageTiming& timing = result.images[n];
+        const bool overlap = plans.size() > 1 && n + 1 < count;
+        if (overlap)
+            copy_in(n + 1);
+
+        bool done = wait_until_accelerator_done();
+        timing.run = timer::now() - t_run;
+        recacc_control_stop(dev);
+        if (!done) {
+            result.success = false;
+            result.images.resize(n + 1);
+            break;
+        }
+        timing.cycles = cycles;
+        result.cycles += cycles;
+
+        if (overlap)
+            start(n + 1);
+
+        auto t = timer::now();
+        use_plan(n);
+        copy_data_out(psum_bufs[n], psum_bytes, false);
+        timing.copy_out = timer::now() - t;
+
+        if (!overlap && n + 1 < count) {
+            copy_in(n + 1);
+            start(n + 1);
+        }
+    }
+
+    result.total = timer::now() - t_start;
+    return result;
 }
 
 bool Conv2D::validate_hw_state() {
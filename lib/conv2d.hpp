@@ -1,15 +1,57 @@
 #pragma once
 
 #include "types.h"
+#include <chrono>
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "hosttensor.hpp"
+#include "pooling.hpp"
+#include "spadalloc.hpp"
+#include "tensorview.hpp"
+#include "threadpool.hpp"
+#include "transfer.hpp"
+
 extern "C" {
     #include <driver.h>
 }
 
+// timings of one image of Conv2D::run_batch
+struct Conv2DImageTiming {
+    std::chrono::duration<float, std::micro> copy_in{0};
+    std::chrono::duration<float, std::micro> run{0}; // start until completion was observed
+    std::chrono::duration<float, std::micro> copy_out{0};
+    unsigned cycles = 0;
+};
+
+struct Conv2DBatchResult {
+    bool success = false; // false if the hardware timed out, the remaining images are not run
+    std::vector<Conv2DImageTiming> images;
+    std::chrono::duration<float, std::micro> setup{0}; // placement, weight and postprocessing upload
+    bool double_buffered = false; // images alternated between both scratchpad halves
+    std::chrono::duration<float, std::micro> total{0};
+    uint64_t cycles = 0;
+};
+
+// everything Conv2D computes before a run: the scratchpad placement, the complete register image and the
+// host buffer offset of every iact column. plans are immutable and can be shared between threads and
+// operations of the same shape, see PlanCache in plan.hpp
+struct Conv2DPlan {
+    recacc_config cfg;
+    unsigned base_iact, base_wght, base_psum, base_padding;
+    unsigned alloc_size_iact, alloc_size_wght, alloc_size_psum;
+    unsigned spad_column_stride;
+    unsigned channels_per_column;
+    unsigned bytes_per_psum, bytes_per_channel, bytes_per_kernel, bytes_per_output_channel;
+    unsigned dummy_channels;
+    int throttle;
+    size_t iact_bytes;                       // size of a complete dense iact buffer
+    std::vector<size_t> iact_column_offsets; // spad_word_size + 1 offsets into a complete iact buffer
+};
+
 // represents a 2D convolution operation with a set of parameters
 
 class Conv2D {
@@ -28,39 +70,119 @@ public:
     void set_activation_mode(enum activation_mode mode);
     virtual void set_requantize(bool enabled);
     void set_hwinfo(const recacc_hwinfo& hwinfo);
-    void set_recacc_device(const recacc_device* dev);
+    void set_recacc_device(recacc_device* dev);
     void use_interrupts(bool enabled);
+    void set_wait_mode(enum wait_mode mode);
+    void set_wait_params(const recacc_wait_params& params);
     void set_padding_mode(bool enable_same_size_padding);
     void set_psum_throttle(int value);
+    void set_transfer_engine(TransferEngine* engine);
+    void set_copy_threads(unsigned threads);
 
     std::tuple<unsigned, unsigned> get_image_size() const;
     std::tuple<unsigned, unsigned> get_kernel_size() const;
     std::tuple<unsigned, unsigned> get_channel_count() const;
+    std::tuple<unsigned, unsigned> get_output_size() const;
+    size_t get_output_channel_bytes();
     std::string get_parameter_string() const;
     unsigned get_cycle_count() const;
+    unsigned get_copy_threads() const;
+    TransferEngine* get_transfer_engine() const;
+    uint64_t get_wait_latency_ns() const;
     bool get_padding_mode() const;
+    int get_psum_throttle() const;
     bool get_requantize() const;
     enum activation_mode get_activation_mode() const;
 
-    void allocate_spad_auto();
+    // region_count > 1 splits every scratchpad column into equal regions, e.g. two for double buffering
+    void allocate_spad_auto(unsigned region = 0, unsigned region_count = 1);
+    void allocate_spad_wght_at(unsigned offset_wght);
+    // place iact, wght, psum and the padding row with spad as <name>.iact, .wght, .psum and .pad for the steps up
+    // to last_step. allocations of these names still present and large enough are kept (e.g. resident weights)
+    void allocate_spad(SpadAllocator& spad, const std::string& name, unsigned last_step = SpadAllocator::forever);
+    unsigned get_wght_column_bytes();
+    unsigned get_data_column_bytes();
     std::tuple<unsigned, unsigned, unsigned, unsigned> get_buffer_offsets() const;
     void set_buffer_offsets(unsigned offset_iact, unsigned offset_wght, unsigned offset_psum, unsigned offset_padding);
 
     void compute_accelerator_parameters(bool fixup_channel_alignment = true);
+
+    // snapshot of the state computed by allocate_spad_* and compute_accelerator_parameters
+    Conv2DPlan compile_plan() const;
+    // restore a compiled plan instead of allocating and computing parameters, the plan must match this shape
+    void apply_plan(std::shared_ptr<const Conv2DPlan> plan);
     void print_accelerator_parameters();
 
     void copy_data_in(const void* iact_buf, size_t iact_bytes, const void* wght_buf, size_t wght_bytes);
+    // copy_data_in from tensors in any layout, e.g. NHWC frames (one image, see HostTensor::slice) or HWIO weights
+    // the layout conversion is fused into the column-wise scratchpad writes, dense tensors take the buffer path
+    void copy_data_in(const HostTensor* iact, const HostTensor* wght);
+    // use the requantized output of producer, still in the scratchpad, as iact of this operation
+    // nothing is copied if the psum region of producer is the iact region and the column layouts match,
+    // otherwise the CPU reads the channels back and writes them into the iact columns, one column at a time
+    void copy_iact_from_psum(const Conv2D& producer);
+    bool iact_matches_psum_of(const Conv2D& producer) const; // true if copy_iact_from_psum has nothing to copy
+    // for reading the psums of a producer in place with more than one channel per column, output channel och of the
+    // producer has to compute input channel order[och] of this operation (identity with one channel per column)
+    // empty if the channel planes do not fill whole scratchpad words, the psum rounds cannot match the iact slots then
+    std::vector<unsigned> get_in_place_channel_order();
+
+    // placement of iact, the kernels of one output channel and the psums in the scratchpad
+    // valid after compute_accelerator_parameters until the next allocation
+    SpadTensorLayout get_iact_layout() const;
+    SpadTensorLayout get_wght_layout(unsigned output_channel) const;
+    SpadTensorLayout get_psum_layout() const;
+    // views to produce iact and weights and consume the results in place instead of copy_data_in and copy_data_out
+    // copy_data_in(nullptr, 0, nullptr, 0) still has to write the zero padding row
+    SpadTensorView<input_t> iact_view();
+    SpadTensorView<input_t> wght_view(unsigned output_channel);
+    // T has to match the psum width, e.g. int8_t with requantization and psum_t without
+    template<typename T> SpadTensorView<T> psum_view() {
+        return SpadTensorView<T>(recacc_get_buffer(dev), get_psum_layout());
+    }
     void set_postproc_data(const std::vector<psum_t>& bias, const std::vector<float>& factors, const std::vector<float>& zeropoints);
     void configure_accelerator();
     void run_accelerator();
+
+    // record configure_accelerator, set_postproc_data and (with start) run_accelerator into cb
+    // the buffer holds the complete register image of the job and can be replayed by run_recorded or a CommandQueue
+    // for every run with the same parameters, scratchpad placement and postprocessing data
+    void record_accelerator_job(recacc_cmdbuf& cb, const std::vector<psum_t>& bias, const std::vector<float>& factors,
+        const std::vector<float>& zeropoints, bool start = true);
+    // replaces configure_accelerator, set_postproc_data and run_accelerator with a buffer recorded for this operation
+    void run_recorded(const recacc_cmdbuf& cb);
     bool wait_until_accelerator_done();
-    void copy_data_out(void* psum_buf, size_t psum_bytes);
+    void copy_data_out(void* psum_buf, size_t psum_bytes, bool stop_accelerator = true);
+    // copy_data_out into a tensor of any layout, e.g. NHWC or a channel range of a concat buffer with a row pitch
+    // psum.c output channels from the first one on are written, elements have to match the psum width.
+    // a transfer engine copies packed rows straight to their pitch; it cannot scatter single elements, interleaved
+    // layouts such as NHWC are always read by the CPU
+    void copy_data_out(const HostOutputTensor& psum, bool stop_accelerator = true);
+    // copy_data_out with pooling of every output channel fused into the readback, psum has the pooled extents
+    // (Pool2D::output_size). only the rows covered by the windows are read, each once. the CPU reads and pools the
+    // rows, a transfer engine is not used
+    void copy_data_out(const HostOutputTensor& psum, const Pool2D& pool, bool stop_accelerator = true);
+
+    // run the operation on several images, uploading the weights and postprocessing data only once
+    // per image only the iact is swapped and the psums are read back, all images use iact_bytes / psum_bytes
+    // places the operation itself: if it fits half the scratchpad, images alternate between both halves and the
+    // copy-in of the next and the copy-out of the previous image overlap the run, otherwise they run one by one
+    Conv2DBatchResult run_batch(const std::vector<const void*>& iact_bufs, size_t iact_bytes,
+        const void* wght_buf, size_t wght_bytes, const std::vector<void*>& psum_bufs, size_t psum_bytes,
+        const std::vector<psum_t>& bias, const std::vector<float>& factors, const std::vector<float>& zeropoints);
     bool validate_hw_state();
     void guess_psum_throttle();
 
 protected:
     void ensure_hwinfo();
+    void _check_start();
+    std::vector<uint32_t> _postproc_register_values(const std::vector<psum_t>& bias, const std::vector<float>& factors,
+        const std::vector<float>& zeropoints);
+    void _compute_buffer_sizes();
+    size_t _column_input_bytes(unsigned col, size_t stride_size, size_t bytes_avail) const;
+    size_t _copy_in_column(unsigned col, input_t* dst, size_t stride_size, const input_t* buf, size_t bytes_avail, bool zeropad);
     size_t _copy_in_columnwise(input_t* dst, size_t stride_size, const input_t* buf, size_t bytes_avail, bool zeropad = true);
+    void _gather_column(input_t* dst, const HostTensor& src, unsigned n, unsigned first_channel, unsigned channels, size_t bytes_total);
 
     unsigned iact_w = 32;
     unsigned iact_h = 32;
@@ -72,7 +194,9 @@ protected:
     int throttle = -1; // negative throttle triggers autodetect
     unsigned cycles = 0;
     bool requantize = false;
-    bool use_irq = false;
+    enum wait_mode wait = wait_poll;
+    recacc_wait_params wait_params;
+    uint64_t wait_latency_ns = 0;
     enum activation_mode act_mode = act_none;
     bool padding = false;
 
@@ -90,7 +214,10 @@ protected:
     unsigned bytes_per_kernel = 0;
     unsigned bytes_per_output_channel = 0;
 
-    const recacc_device* dev;
+    recacc_device* dev;
+    TransferEngine* transfer = nullptr; // optional, copies are done directly by the cpu if unset
+    std::shared_ptr<ThreadPool> copy_pool; // shared by copies of this operation, unset for single-threaded copies
     recacc_hwinfo hwinfo;
     recacc_config cfg;
+    std::shared_ptr<const Conv2DPlan> plan; // set by apply_plan until the next allocation
 };
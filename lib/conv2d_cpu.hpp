@@ -3,6 +3,7 @@
 // act = 3d tensor with batch size always 1
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 
 template <typename Tin, typename Tout> void conv2d_cpu(
@@ -93,3 +94,25 @@ template <typename T> void relu_cpu(T* buffer, int count)
         buffer[n] = std::max(buffer[n], static_cast<T>(0));
     }
 }
+
+// valid pooling of each channel, mode 0 is max and 1 average (rounded half away from zero)
+template <typename T> void pool2d_cpu(
+    T* act, T* result, int channels, int height, int width, int size, int stride, int mode)
+{
+    const int out_height = (height - size) / stride + 1;
+    const int out_width = (width - size) / stride + 1;
+    for (int c = 0; c < channels; c++)
+    for (int oy = 0; oy < out_height; oy++)
+    for (int ox = 0; ox < out_width; ox++) {
+        int64_t sum = 0;
+        T maximum = act[(c * height + oy * stride) * width + ox * stride];
+        for (int ky = 0; ky < size; ky++)
+        for (int kx = 0; kx < size; kx++) {
+            T value = act[(c * height + oy * stride + ky) * width + ox * stride + kx];
+            sum += value;
+            maximum = std::max(maximum, value);
+        }
+        T average = static_cast<T>(round(static_cast<double>(sum) / (size * size)));
+        result[(c * out_height + oy) * out_width + ox] = mode == 0 ? maximum : average;
+    }
+}
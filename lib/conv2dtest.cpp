@@ -471,3 +471,121 @@ void Conv2DTest::set_bias(bool enabled) {
 void Conv2DTest::set_debug_clean_buffers(bool enabled) {
     debug_clean_buffers = enabled;
 }
+
+Conv2DTestData::Conv2DTestData(const Conv2D& op, unsigned images) {
+    auto [input_channels, output_channels] = op.get_channel_count();
+    auto [iact_w, iact_h] = op.get_image_size();
+    auto [wght_w, wght_h] = op.get_kernel_size();
+
+    iact.resize(images, vector<input_t>(iact_w * iact_h * input_channels));
+    for (auto& image : iact)
+        generate_random_data<input_t>(image.data(), image.size());
+    wght.resize(wght_w * wght_h * input_channels * output_channels);
+    generate_random_data<input_t>(wght.data(), wght.size());
+    bias.resize(output_channels);
+    generate_random_data<psum_t>(bias.data(), bias.size());
+
+    const bool requantize = op.get_requantize();
+    factors.assign(output_channels, requantize ? 0.0025 : 1.0);
+    zeropoints.assign(output_channels, requantize ? (op.get_activation_mode() == act_relu ? -100.0 : -5.0) : 0.0);
+}
+
+Conv2DJob Conv2DTestData::make_job(const Conv2D& op, void* psum_buf, size_t psum_bytes, unsigned image) const {
+    Conv2DJob job;
+    job.op = op;
+    job.iact_buf = iact[image].data();
+    job.iact_bytes = iact[image].size();
+    job.wght_buf = wght.data();
+    job.wght_bytes = wght.size();
+    job.bias = bias;
+    job.factors = factors;
+    job.zeropoints = zeropoints;
+    job.psum_buf = psum_buf;
+    job.psum_bytes = psum_bytes;
+    return job;
+}
+
+vector<uint8_t> Conv2DTestData::reference(const Conv2D& op, unsigned image) const {
+    auto [input_channels, output_channels] = op.get_channel_count();
+    auto [iact_w, iact_h] = op.get_image_size();
+    auto [wght_w, wght_h] = op.get_kernel_size();
+    auto [output_w, output_h] = op.get_output_size();
+    const size_t output_size = output_w * output_h;
+    const size_t num_result = output_size * output_channels;
+    const bool padding = op.get_padding_mode();
+
+    vector<psum_t> psums(num_result);
+    conv2d_cpu<input_t, psum_t>(const_cast<input_t*>(iact[image].data()), const_cast<input_t*>(wght.data()),
+        const_cast<psum_t*>(bias.data()), psums.data(),
+        input_channels, iact_w, iact_h,
+        output_channels, wght_w, wght_h,
+        1, 1, padding ? (wght_w - 1) / 2 : 0, padding ? (wght_h - 1) / 2 : 0);
+    if (op.get_activation_mode() == act_relu)
+        relu_cpu<psum_t>(psums.data(), num_result);
+
+    if (!op.get_requantize()) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(psums.data());
+        return vector<uint8_t>(bytes, bytes + num_result * sizeof(psum_t));
+    }
+    vector<uint8_t> result(num_result);
+    requantize_cpu<psum_t, input_t>(psums.data(), reinterpret_cast<input_t*>(result.data()),
+        const_cast<float*>(factors.data()), const_cast<float*>(zeropoints.data()), output_channels, output_size);
+    return result;
+}
+
+size_t Conv2DTestData::count_incorrect(const Conv2D& op, const void* result, unsigned image, size_t* first) const {
+    vector<uint8_t> expected = reference(op, image);
+    void* acc = const_cast<void*>(result);
+    void* cpu = expected.data();
+    size_t incorrect, deviations, offset;
+    if (op.get_requantize())
+        offset = compare_buffers<input_t>(static_cast<input_t*>(acc), static_cast<input_t*>(cpu), expected.size(), 3,
+            incorrect, deviations, nullptr);
+    else
+        offset = compare_buffers<psum_t>(static_cast<psum_t*>(acc), static_cast<psum_t*>(cpu), expected.size() / sizeof(psum_t), 0,
+            incorrect, deviations, nullptr);
+    if (first)
+        *first = offset;
+    return incorrect;
+}
+
+bool run_conv2d(recacc_device* dev, Conv2D& op, const Conv2DTestData& data) {
+    op.configure_accelerator();
+    op.set_postproc_data(data.bias, data.factors, data.zeropoints);
+    op.run_accelerator();
+    if (!op.wait_until_accelerator_done()) {
+        recacc_control_stop(dev);
+        return false;
+    }
+    return true;
+}
+
+int open_test_device(recacc_device* dev, const string& name, recacc_hwinfo* hwinfo) {
+    int ret = recacc_open(dev, name.c_str());
+    if (ret)
+        return ret;
+    if (!recacc_verify(dev, true)) {
+        recacc_close(dev);
+        return 1;
+    }
+    recacc_reset(dev);
+    if (hwinfo)
+        recacc_get_hwinfo(dev, hwinfo);
+    return 0;
+}
+
+void TestErrors::expect(bool ok, const string& what) {
+    if (!ok) {
+        cerr << "ERROR: " << what << endl;
+        errors++;
+    }
+}
+
+unsigned TestErrors::count() const {
+    return errors;
+}
+
+int TestErrors::report() const {
+    cout << (errors ? "FAILED" : "CORRECT") << endl;
+    return errors ? 1 : 0;
+}
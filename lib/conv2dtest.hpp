@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "conv2d.hpp"
+#include "executor.hpp"
 
 extern "C" {
     #include <driver.h>
@@ -70,3 +71,48 @@ private:
     bool debug_clean_buffers;
     Verbosity verbose;
 };
+
+// random data of one layer for the tests that run it through other paths than Conv2DTest (executor, tiling,
+// batches, chains, views), with the postprocessing parameters Conv2DTest uses: scale 0.0025 and zeropoint -5
+// (-100 with relu) when requantizing, 1 and 0 otherwise
+struct Conv2DTestData {
+    std::vector<std::vector<input_t>> iact; // one buffer per image
+    std::vector<input_t> wght;
+    std::vector<psum_t> bias;
+    std::vector<float> factors;
+    std::vector<float> zeropoints;
+
+    Conv2DTestData() = default;
+    explicit Conv2DTestData(const Conv2D& op, unsigned images = 1);
+
+    // a job for image n, psum_buf receives the results as copy_data_out writes them
+    Conv2DJob make_job(const Conv2D& op, void* psum_buf, size_t psum_bytes, unsigned image = 0) const;
+
+    // CPU reference of image n, laid out as copy_data_out writes it: int8 when requantizing, psums otherwise
+    std::vector<uint8_t> reference(const Conv2D& op, unsigned image = 0) const;
+
+    // number of result values differing from the CPU reference of image n, requantized values may be off by 3
+    // first receives the index of the first incorrect value if given
+    size_t count_incorrect(const Conv2D& op, const void* result, unsigned image = 0, size_t* first = nullptr) const;
+};
+
+// configure op, run it with the postprocessing data of data and wait; the data must be copied in before and the
+// psums stay in the scratchpad. false if the accelerator timed out, it is stopped then
+bool run_conv2d(recacc_device* dev, Conv2D& op, const Conv2DTestData& data);
+
+// open, verify and reset a device for a test program, hwinfo is read if given.
+// returns 0 or the exit code of the test, the device is closed on errors
+int open_test_device(recacc_device* dev, const std::string& name, recacc_hwinfo* hwinfo = nullptr);
+
+// error counter of the test programs
+class TestErrors {
+public:
+    void expect(bool ok, const std::string& what);
+    unsigned count() const;
+
+    // prints CORRECT or FAILED and returns the exit code of the test
+    int report() const;
+
+private:
+    unsigned errors = 0;
+};
@@ -0,0 +1,326 @@
+#include "executor.hpp"
+
+#include <exception>
+#include <stdexcept>
+
+#include "plan.hpp"
+#include "tiling.hpp"
+
+using namespace std;
+
+static recacc_hwinfo read_hwinfo(recacc_device* dev) {
+    recacc_hwinfo hwinfo;
+    recacc_get_hwinfo(dev, &hwinfo);
+    return hwinfo;
+}
+
+Conv2DExecutor::Conv2DExecutor(recacc_device* dev) : dev(dev), hwinfo(read_hwinfo(dev)), weight_cache(hwinfo) {
+    // hwinfo is read once up front, afterwards only the worker thread touches the device
+    thread = std::thread(&Conv2DExecutor::worker, this);
+}
+
+// finishes all queued jobs before returning
+Conv2DExecutor::~Conv2DExecutor() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    queue_cv.notify_all();
+    thread.join();
+}
+
+future<Conv2DResult> Conv2DExecutor::submit(Conv2DJob job) {
+    promise<Conv2DResult> result;
+    auto fut = result.get_future();
+    {
+        lock_guard<std::mutex> lock(mutex);
+        queue.emplace_back(std::move(job), std::move(result));
+    }
+    queue_cv.notify_one();
+    return fut;
+}
+
+size_t Conv2DExecutor::pending() const {
+    lock_guard<std::mutex> lock(mutex);
+    return queue.size() + running;
+}
+
+void Conv2DExecutor::wait_idle() {
+    unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this] { return queue.empty() && running == 0; });
+}
+
+const recacc_hwinfo& Conv2DExecutor::get_hwinfo() const {
+    return hwinfo;
+}
+
+recacc_device* Conv2DExecutor::get_device() const {
+    return dev;
+}
+
+void Conv2DExecutor::set_double_buffering(bool enabled) {
+    double_buffering = enabled;
+}
+
+bool Conv2DExecutor::get_double_buffering() const {
+    return double_buffering;
+}
+
+void Conv2DExecutor::set_weight_caching(bool enabled) {
+    weight_caching = enabled;
+}
+
+bool Conv2DExecutor::get_weight_caching() const {
+    return weight_caching;
+}
+
+WeightCache::Stats Conv2DExecutor::get_weight_cache_stats() const {
+    lock_guard<std::mutex> lock(cache_mutex);
+    return weight_cache.get_stats();
+}
+
+void Conv2DExecutor::set_transfer_engine(TransferEngine* engine) {
+    if (engine && engine->get_device() != dev)
+        throw runtime_error("transfer engine belongs to another device");
+    transfer = engine;
+}
+
+// move the job's operation to this device, an engine of another device is replaced by the executor's
+void Conv2DExecutor::attach(Conv2D& op) {
+    op.set_recacc_device(dev);
+    op.set_hwinfo(hwinfo);
+    if (!op.get_transfer_engine())
+        op.set_transfer_engine(transfer);
+}
+
+void Conv2DExecutor::forget_weights() {
+    lock_guard<std::mutex> lock(cache_mutex);
+    weight_cache.invalidate();
+}
+
+void Conv2DExecutor::worker() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queue_cv.wait(lock, [this] { return stop || !queue.empty(); });
+        if (queue.empty())
+            break; // stop requested and everything is done
+
+        QueuedJob job = std::move(queue.front());
+        queue.pop_front();
+        running++;
+        lock.unlock();
+
+        if (double_buffering) {
+            stream(std::move(job));
+        } else {
+            try {
+                job.second.set_value(execute(job.first));
+            } catch (...) {
+                job.second.set_exception(current_exception());
+            }
+            finish();
+        }
+
+        lock.lock();
+    }
+}
+
+// take the next queued job without blocking, it counts as running until finish() is called
+bool Conv2DExecutor::pop(QueuedJob& job) {
+    lock_guard<std::mutex> lock(mutex);
+    if (queue.empty())
+        return false;
+    job = std::move(queue.front());
+    queue.pop_front();
+    running++;
+    return true;
+}
+
+void Conv2DExecutor::finish() {
+    lock_guard<std::mutex> lock(mutex);
+    running--;
+    if (queue.empty() && running == 0)
+        idle_cv.notify_all();
+}
+
+// place the job into one scratchpad half and copy its data in, returns false if it does not fit
+bool Conv2DExecutor::stage(Conv2DJob& job, unsigned region) {
+    Conv2D& op = job.op;
+    attach(op);
+
+    // the postprocessing registers only cover max_output_channels, such layers run in output channel groups
+    // on the blocking tiled path
+    if (hwinfo.bias_requant_available && hwinfo.max_output_channels > 0
+        && get<1>(op.get_channel_count()) > hwinfo.max_output_channels)
+        return false;
+
+    shared_ptr<const Conv2DPlan> plan = PlanCache::global().get(op, hwinfo, region, 2);
+    if (!plan)
+        return false;
+
+    forget_weights();
+    op.apply_plan(std::move(plan));
+    op.copy_data_in(job.iact_buf, job.iact_bytes, job.wght_buf, job.wght_bytes);
+    return true;
+}
+
+// start the job on the idle accelerator, returns false if the job has already been completed instead
+// (not fitting a scratchpad half, or failed)
+bool Conv2DExecutor::start(QueuedJob& job, unsigned region) {
+    try {
+        if (!stage(job.first, region)) {
+            job.second.set_value(execute(job.first));
+            return false;
+        }
+        job.first.op.configure_accelerator();
+        job.first.op.set_postproc_data(job.first.bias, job.first.factors, job.first.zeropoints);
+        job.first.op.run_accelerator();
+        return true;
+    } catch (...) {
+        job.second.set_exception(current_exception());
+        return false;
+    }
+}
+
+// runs current and all jobs queued behind it, alternating between the two scratchpad halves
+void Conv2DExecutor::stream(QueuedJob current) {
+    unsigned region = 0;
+    bool started = start(current, region);
+    while (true) {
+        if (!started) {
+            // current was completed by start(), nothing is left on the accelerator
+            finish();
+            if (!pop(current))
+                return;
+            started = start(current, region);
+            continue;
+        }
+
+        // copy the next job into the other half while the accelerator is busy
+        QueuedJob next;
+        bool have_next = pop(next);
+        bool next_staged = false;
+        if (have_next) {
+            try {
+                next_staged = stage(next.first, region ^ 1);
+            } catch (...) {
+                next.second.set_exception(current_exception());
+                finish();
+                have_next = false;
+            }
+        }
+
+        Conv2D& op = current.first.op;
+        Conv2DResult result;
+        result.success = op.wait_until_accelerator_done();
+        result.wait_latency_ns = op.get_wait_latency_ns();
+        result.cycles = op.get_cycle_count();
+        recacc_control_stop(dev);
+
+        // after a timeout the accelerator may still write into the scratchpad: reset it, drop the resident
+        // weights and stage the next job again below instead of starting it on top of the failed one
+        if (!result.success) {
+            recacc_reset(dev);
+            forget_weights();
+            next_staged = false;
+        }
+
+        // start the next job before reading back the psums of the current one
+        bool next_started = false;
+        if (next_staged) {
+            try {
+                next.first.op.configure_accelerator();
+                next.first.op.set_postproc_data(next.first.bias, next.first.factors, next.first.zeropoints);
+                next.first.op.run_accelerator();
+                next_started = true;
+            } catch (...) {
+                next.second.set_exception(current_exception());
+                finish();
+                have_next = false;
+            }
+        }
+
+        try {
+            if (result.success)
+                op.copy_data_out(current.first.psum_buf, current.first.psum_bytes, false);
+            current.second.set_value(result);
+        } catch (...) {
+            current.second.set_exception(current_exception());
+        }
+        finish();
+
+        if (!have_next) {
+            if (!pop(current))
+                return;
+            started = start(current, region);
+            continue;
+        }
+
+        // a next job not fitting a scratchpad half is run on its own now
+        current = std::move(next);
+        region ^= 1;
+        started = next_started || start(current, region);
+    }
+}
+
+// the blocking sequence of Conv2D, run on the worker thread only
+Conv2DResult Conv2DExecutor::execute(Conv2DJob& job) {
+    Conv2D& op = job.op;
+    attach(op);
+
+    // known shapes start from a compiled plan, layers exceeding the scratchpad are split into spatial tiles
+    shared_ptr<const Conv2DPlan> plan = PlanCache::global().get(op, hwinfo);
+    if (!plan) {
+        forget_weights();
+        TiledConv2D tiler(dev, hwinfo);
+        return tiler.run(job);
+    }
+
+    bool resident = false;
+    bool placed_by_cache = false;
+    {
+        lock_guard<std::mutex> lock(cache_mutex);
+        if (weight_caching) {
+            resident = weight_cache.place(op, job.wght_buf, job.wght_bytes);
+            placed_by_cache = true;
+        } else {
+            weight_cache.invalidate();
+            op.apply_plan(std::move(plan));
+        }
+    }
+
+    try {
+        // the weight cache places the weights elsewhere than the plan
+        if (placed_by_cache)
+            op.compute_accelerator_parameters(true);
+        op.configure_accelerator();
+        op.set_postproc_data(job.bias, job.factors, job.zeropoints);
+        op.copy_data_in(job.iact_buf, job.iact_bytes, resident ? nullptr : job.wght_buf, resident ? 0 : job.wght_bytes);
+        op.run_accelerator();
+    } catch (...) {
+        // the weights of a miss may be incomplete
+        forget_weights();
+        throw;
+    }
+
+    Conv2DResult result;
+    try {
+        result.success = op.wait_until_accelerator_done();
+        result.wait_latency_ns = op.get_wait_latency_ns();
+        if (!result.success) {
+            recacc_control_stop(dev);
+            recacc_reset(dev);
+            forget_weights();
+            return result;
+        }
+
+        result.cycles = op.get_cycle_count();
+        op.copy_data_out(job.psum_buf, job.psum_bytes);
+    } catch (...) {
+        // leave the device ready for the next job
+        recacc_control_stop(dev);
+        throw;
+    }
+
+    return result;
+}
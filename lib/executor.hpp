@@ -0,0 +1,112 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "conv2d.hpp"
+#include "weightcache.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// a fully described convolution job
+// all buffers are owned by the caller and must stay valid until the job's future is ready
+struct Conv2DJob {
+    Conv2D op; // layer parameters, wait mode and psum throttle are taken from here
+    const void* iact_buf = nullptr;
+    size_t iact_bytes = 0;
+    const void* wght_buf = nullptr; // nullptr skips the weight upload (weights already resident)
+    size_t wght_bytes = 0;
+    std::vector<psum_t> bias;
+    std::vector<float> factors;
+    std::vector<float> zeropoints;
+    void* psum_buf = nullptr;
+    size_t psum_bytes = 0;
+};
+
+struct Conv2DResult {
+    bool success = false; // false if the hardware timed out
+    unsigned cycles = 0;
+    uint64_t wait_latency_ns = 0;
+};
+
+// owns a device and runs submitted jobs on a dedicated thread, one after another
+// layers that do not fit the scratchpad are run in spatial tiles (see TiledConv2D)
+// with double buffering, queued jobs are pipelined through two halves of the scratchpad
+// with weight caching, weights already resident in the scratchpad are not copied in again (see WeightCache)
+// errors while planning or copying (e.g. spad too small) are delivered as exceptions through the future
+class Conv2DExecutor {
+public:
+    Conv2DExecutor(recacc_device* dev);
+    ~Conv2DExecutor();
+
+    Conv2DExecutor(const Conv2DExecutor&) = delete;
+    Conv2DExecutor& operator=(const Conv2DExecutor&) = delete;
+
+    std::future<Conv2DResult> submit(Conv2DJob job);
+
+    // split the scratchpad into two regions: the next queued job is copied in while the accelerator works on
+    // the current one, and the psums of the current job are read back while the next one runs
+    // jobs not fitting half the scratchpad are run normally, results are identical to the sequential mode
+    void set_double_buffering(bool enabled);
+    bool get_double_buffering() const;
+
+    // keep weights resident across jobs, identified by content; used by sequential untiled jobs only,
+    // tiled or double-buffered jobs overwrite the scratchpad and clear the cache
+    void set_weight_caching(bool enabled);
+    bool get_weight_caching() const;
+    WeightCache::Stats get_weight_cache_stats() const;
+
+    // copy jobs in and out through engine, which must belong to this executor's device and outlive the executor
+    // set before submitting jobs. jobs carrying an engine of another device (e.g. a job moved here by DevicePool)
+    // use this one instead, jobs without an engine for this device are copied by the cpu if unset
+    void set_transfer_engine(TransferEngine* engine);
+
+    // number of jobs queued or running
+    size_t pending() const;
+
+    // block until all submitted jobs are finished
+    void wait_idle();
+
+    const recacc_hwinfo& get_hwinfo() const;
+    recacc_device* get_device() const;
+
+private:
+    using QueuedJob = std::pair<Conv2DJob, std::promise<Conv2DResult>>;
+
+    void worker();
+    Conv2DResult execute(Conv2DJob& job);
+    void stream(QueuedJob current);
+    bool stage(Conv2DJob& job, unsigned region);
+    bool start(QueuedJob& job, unsigned region);
+    bool pop(QueuedJob& job);
+    void finish();
+    void forget_weights();
+    void attach(Conv2D& op);
+
+    recacc_device* dev;
+    recacc_hwinfo hwinfo;
+    TransferEngine* transfer = nullptr;
+
+    mutable std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::condition_variable idle_cv;
+    std::deque<QueuedJob> queue;
+    size_t running = 0;
+    bool stop = false;
+    std::atomic<bool> double_buffering = false;
+    std::atomic<bool> weight_caching = false;
+    mutable std::mutex cache_mutex;
+    WeightCache weight_cache;
+    std::thread thread;
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// an int8 tensor in host memory described by its extents and element strides, so Conv2D::copy_data_in can read
+// other layouts than dense CHW (HWC camera frames, a region of a larger frame, HWIO weights) without a transposed copy.
+// element (n, c, y, x) is at data[n * stride_n + c * stride_c + y * stride_y + x * stride_x],
+// for weights n is the output and c the input channel
+struct HostTensor {
+    const input_t* data = nullptr;
+    unsigned n = 1, c = 0, h = 0, w = 0;
+    ptrdiff_t stride_n = 0, stride_c = 0, stride_y = 0, stride_x = 0;
+
+    static HostTensor nchw(const void* data, unsigned n, unsigned c, unsigned h, unsigned w) {
+        const ptrdiff_t plane = static_cast<ptrdiff_t>(h) * w;
+        return {static_cast<const input_t*>(data), n, c, h, w, c * plane, plane, w, 1};
+    }
+
+    static HostTensor nhwc(const void* data, unsigned n, unsigned c, unsigned h, unsigned w) {
+        const ptrdiff_t row = static_cast<ptrdiff_t>(w) * c;
+        return {static_cast<const input_t*>(data), n, c, h, w, h * row, 1, row, c};
+    }
+
+    // weights of o output and i input channels, kernels of h x w
+    static HostTensor oihw(const void* data, unsigned o, unsigned i, unsigned h, unsigned w) {
+        return nchw(data, o, i, h, w);
+    }
+
+    static HostTensor hwio(const void* data, unsigned o, unsigned i, unsigned h, unsigned w) {
+        const ptrdiff_t column = static_cast<ptrdiff_t>(i) * o;
+        return {static_cast<const input_t*>(data), o, i, h, w, 1, o, w * column, column};
+    }
+
+    const input_t* at(unsigned n, unsigned c, unsigned y, unsigned x) const {
+        return data + n * stride_n + c * stride_c + y * stride_y + x * stride_x;
+    }
+
+    // the single image (or output channel) index
+    HostTensor slice(unsigned index) const {
+        HostTensor t = *this;
+        t.data = at(index, 0, 0, 0);
+        t.n = 1;
+        return t;
+    }
+
+    // window of h x w elements starting at (y, x), e.g. a region of interest of a larger frame
+    HostTensor roi(unsigned y, unsigned x, unsigned h, unsigned w) const {
+        HostTensor t = *this;
+        t.data = at(0, 0, y, x);
+        t.h = h;
+        t.w = w;
+        return t;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(n) * c * h * w;
+    }
+
+    // true if the elements are laid out like a plain NCHW (OIHW) buffer of these extents
+    bool is_dense_nchw() const {
+        const ptrdiff_t plane = static_cast<ptrdiff_t>(h) * w;
+        return stride_x == 1 && (h <= 1 || stride_y == w) && (c <= 1 || stride_c == plane) && (n <= 1 || stride_n == c * plane);
+    }
+
+    // write all elements as a dense NCHW buffer of size() bytes
+    void copy_to_nchw(input_t* dst) const {
+        for (unsigned i = 0; i < n; i++)
+            for (unsigned ch = 0; ch < c; ch++)
+                for (unsigned y = 0; y < h; y++) {
+                    const input_t* row = at(i, ch, y, 0);
+                    if (stride_x == 1) {
+                        memcpy(dst, row, w);
+                        dst += w;
+                    } else {
+                        for (unsigned x = 0; x < w; x++)
+                            *dst++ = row[x * stride_x];
+                    }
+                }
+    }
+};
+
+// a tensor in host memory that results are written to, e.g. a channel range of a larger concat buffer or an NHWC
+// frame for the next consumer. element (c, y, x) of element_bytes is at
+// data + (c * stride_c + y * stride_y + x * stride_x) * element_bytes
+struct HostOutputTensor {
+    void* data = nullptr;
+    unsigned element_bytes = 1;
+    unsigned c = 0, h = 0, w = 0;
+    ptrdiff_t stride_c = 0, stride_y = 0, stride_x = 0;
+
+    // row_pitch is the distance of two rows in elements, 0 for tightly packed rows
+    static HostOutputTensor nchw(void* data, unsigned element_bytes, unsigned c, unsigned h, unsigned w, unsigned row_pitch = 0) {
+        const ptrdiff_t row = row_pitch ? row_pitch : w;
+        return {data, element_bytes, c, h, w, h * row, row, 1};
+    }
+
+    static HostOutputTensor nhwc(void* data, unsigned element_bytes, unsigned c, unsigned h, unsigned w, unsigned row_pitch = 0) {
+        const ptrdiff_t row = row_pitch ? row_pitch : static_cast<ptrdiff_t>(w) * c;
+        return {data, element_bytes, c, h, w, 1, row, c};
+    }
+
+    // count channels from first on, e.g. the part of a concat buffer one layer produces
+    HostOutputTensor channels(unsigned first, unsigned count) const {
+        HostOutputTensor t = *this;
+        t.data = at(first, 0, 0);
+        t.c = count;
+        return t;
+    }
+
+    void* at(unsigned ch, unsigned y, unsigned x) const {
+        return static_cast<uint8_t*>(data) + (ch * stride_c + y * stride_y + x * stride_x) * static_cast<ptrdiff_t>(element_bytes);
+    }
+
+    // true if the channels are plain CHW planes one after another
+    bool is_dense_chw() const {
+        return stride_x == 1 && (h <= 1 || stride_y == w) && (c <= 1 || stride_c == static_cast<ptrdiff_t>(h) * w);
+    }
+
+    // write a dense CHW buffer of c * h * w elements into the tensor
+    void copy_from_chw(const void* src) const {
+        if (element_bytes == 4)
+            copy_from_chw_typed<uint32_t>(static_cast<const uint32_t*>(src));
+        else if (element_bytes == 2)
+            copy_from_chw_typed<uint16_t>(static_cast<const uint16_t*>(src));
+        else
+            copy_from_chw_typed<uint8_t>(static_cast<const uint8_t*>(src));
+    }
+
+private:
+    template<typename T> void copy_from_chw_typed(const T* src) const {
+        for (unsigned ch = 0; ch < c; ch++)
+            for (unsigned y = 0; y < h; y++, src += w) {
+                T* row = static_cast<T*>(at(ch, y, 0));
+                if (stride_x == 1) {
+                    memcpy(row, src, w * sizeof(T));
+                } else {
+                    for (unsigned x = 0; x < w; x++)
+                        row[x * stride_x] = src[x];
+                }
+            }
+    }
+};
@@ -0,0 +1,90 @@
+#include "plan.hpp"
+
+#include <stdexcept>
+#include <tuple>
+
+#include "tiling.hpp"
+
+using namespace std;
+
+PlanCache& PlanCache::global() {
+    static PlanCache cache;
+    return cache;
+}
+
+PlanCache::Key PlanCache::make_key(const Conv2D& op, const recacc_hwinfo& hwinfo, unsigned region, unsigned region_count) {
+    auto [iact_w, iact_h] = op.get_image_size();
+    auto [wght_w, wght_h] = op.get_kernel_size();
+    auto [input_channels, output_channels] = op.get_channel_count();
+    return {
+        iact_w, iact_h, wght_w, wght_h, input_channels, output_channels,
+        op.get_padding_mode(), op.get_requantize(), static_cast<uint32_t>(op.get_activation_mode()),
+        static_cast<uint32_t>(op.get_psum_throttle()), region, region_count,
+        hwinfo.array_size_x, hwinfo.array_size_y, hwinfo.line_length_iact, hwinfo.line_length_wght,
+        hwinfo.line_length_psum, hwinfo.fifo_size_psum, hwinfo.spad_size, hwinfo.spad_word_size,
+        static_cast<uint32_t>(hwinfo.data_width_bits_iact << 16 | hwinfo.data_width_bits_wght << 8 | hwinfo.data_width_bits_psum),
+        hwinfo.max_output_channels, hwinfo.trs_dataflow, hwinfo.bias_requant_available,
+    };
+}
+
+shared_ptr<const Conv2DPlan> PlanCache::get(const Conv2D& op, const recacc_hwinfo& hwinfo, unsigned region, unsigned region_count) {
+    const Key key = make_key(op, hwinfo, region, region_count);
+    {
+        lock_guard<std::mutex> lock(mutex);
+        auto it = plans.find(key);
+        if (it != plans.end()) {
+            hits++;
+            return it->second;
+        }
+    }
+
+    // planning runs without the lock, a concurrent miss for the same key computes an identical plan
+    shared_ptr<const Conv2DPlan> plan;
+    TiledConv2D tiler(nullptr, hwinfo);
+    tiler.plan(op);
+    if (!tiler.is_tiled()) {
+        Conv2D planned = op;
+        planned.set_hwinfo(hwinfo);
+        bool fits = true;
+        try {
+            planned.allocate_spad_auto(region, region_count);
+        } catch (const runtime_error&) {
+            fits = false; // only possible for region_count > 1, cached as nullptr as well
+        }
+        if (fits) {
+            planned.compute_accelerator_parameters(true);
+            plan = make_shared<const Conv2DPlan>(planned.compile_plan());
+        }
+    }
+
+    lock_guard<std::mutex> lock(mutex);
+    misses++;
+    plans.emplace(key, plan);
+    return plan;
+}
+
+void PlanCache::put(const Conv2D& op, const recacc_hwinfo& hwinfo, shared_ptr<const Conv2DPlan> plan, unsigned region, unsigned region_count) {
+    const Key key = make_key(op, hwinfo, region, region_count);
+    lock_guard<std::mutex> lock(mutex);
+    plans.insert_or_assign(key, std::move(plan));
+}
+
+size_t PlanCache::size() const {
+    lock_guard<std::mutex> lock(mutex);
+    return plans.size();
+}
+
+uint64_t PlanCache::get_hits() const {
+    lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+uint64_t PlanCache::get_misses() const {
+    lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+void PlanCache::clear() {
+    lock_guard<std::mutex> lock(mutex);
+    plans.clear();
+}
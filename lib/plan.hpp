@@ -0,0 +1,44 @@
+#pragma once
+
+#include "types.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "conv2d.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// process-wide cache of compiled Conv2D plans, keyed by layer shape, padding, requantization, activation,
+// psum throttle setting, scratchpad region and hwinfo. steady-state jobs of a known shape skip all planning.
+class PlanCache {
+public:
+    static PlanCache& global();
+
+    // the plan for op placed in one of region_count scratchpad regions (see Conv2D::allocate_spad_auto),
+    // planned on the first request. nullptr if op does not run untiled in that region (see TiledConv2D),
+    // errors while planning are thrown and not cached
+    std::shared_ptr<const Conv2DPlan> get(const Conv2D& op, const recacc_hwinfo& hwinfo, unsigned region = 0, unsigned region_count = 1);
+
+    // store a plan computed elsewhere (e.g. a StaticConv2DPlan) for op, replacing a cached one
+    void put(const Conv2D& op, const recacc_hwinfo& hwinfo, std::shared_ptr<const Conv2DPlan> plan, unsigned region = 0, unsigned region_count = 1);
+
+    size_t size() const;
+    uint64_t get_hits() const;
+    uint64_t get_misses() const;
+    void clear();
+
+private:
+    using Key = std::array<uint32_t, 24>;
+    static Key make_key(const Conv2D& op, const recacc_hwinfo& hwinfo, unsigned region, unsigned region_count);
+
+    mutable std::mutex mutex;
+    std::map<Key, std::shared_ptr<const Conv2DPlan>> plans;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
@@ -0,0 +1,153 @@
+#include "pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+DevicePool::~DevicePool() {
+    close();
+}
+
+void DevicePool::open(const vector<string>& device_names, bool print_info) {
+    try {
+        for (auto& name : device_names) {
+            auto dev = make_unique<recacc_device>();
+            int ret = recacc_open(dev.get(), name.c_str());
+            if (ret)
+                throw runtime_error("failed to open device " + name);
+
+            if (!recacc_verify(dev.get(), print_info)) {
+                recacc_close(dev.get());
+                throw runtime_error("failed to verify device " + name);
+            }
+
+            recacc_reset(dev.get());
+            if (!recacc_get_status(dev.get()).ready) {
+                recacc_close(dev.get());
+                throw runtime_error("device " + name + " is not ready after reset");
+            }
+
+            devices.push_back(std::move(dev));
+            executors.push_back(make_unique<Conv2DExecutor>(devices.back().get()));
+        }
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+void DevicePool::close() {
+    // executors finish their queues before the devices go away
+    executors.clear();
+    for (auto& dev : devices)
+        recacc_close(dev.get());
+    devices.clear();
+}
+
+size_t DevicePool::size() const {
+    return executors.size();
+}
+
+Conv2DExecutor& DevicePool::get_executor(size_t index) {
+    return *executors.at(index);
+}
+
+size_t DevicePool::least_loaded() const {
+    if (executors.empty())
+        throw runtime_error("device pool is empty");
+
+    const size_t count = executors.size();
+    const size_t start = next_device++ % count;
+    size_t best = start;
+    size_t best_pending = executors[start]->pending();
+    for (size_t n = 1; n < count && best_pending > 0; n++) {
+        size_t idx = (start + n) % count;
+        size_t pending = executors[idx]->pending();
+        if (pending < best_pending) {
+            best = idx;
+            best_pending = pending;
+        }
+    }
+    return best;
+}
+
+future<Conv2DResult> DevicePool::submit(Conv2DJob job) {
+    return executors[least_loaded()]->submit(std::move(job));
+}
+
+template<typename T> static vector<T> slice(const vector<T>& values, size_t first, size_t count) {
+    if (first >= values.size())
+        return {};
+    return vector<T>(values.begin() + first, values.begin() + min(values.size(), first + count));
+}
+
+future<Conv2DResult> DevicePool::submit_split(Conv2DJob job) {
+    if (executors.empty())
+        throw runtime_error("device pool is empty");
+
+    Conv2D& op = job.op;
+    op.set_hwinfo(executors.front()->get_hwinfo());
+    auto [input_channels, output_channels] = op.get_channel_count();
+    auto [kernel_w, kernel_h] = op.get_kernel_size();
+    const size_t wght_bytes_per_och = static_cast<size_t>(input_channels) * kernel_w * kernel_h;
+    const size_t psum_bytes_per_och = op.get_output_channel_bytes();
+    const size_t parts = min(executors.size(), static_cast<size_t>(output_channels));
+
+    // hand the parts to the least loaded devices, one part per device
+    vector<size_t> order(executors.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return executors[a]->pending() < executors[b]->pending();
+    });
+
+    vector<future<Conv2DResult>> futures;
+    size_t first = 0;
+    for (size_t n = 0; n < parts; n++) {
+        const size_t count = output_channels / parts + (n < output_channels % parts ? 1 : 0);
+        const size_t wght_offset = first * wght_bytes_per_och;
+        const size_t psum_offset = first * psum_bytes_per_och;
+
+        Conv2DJob part;
+        part.op = job.op;
+        part.op.set_channel_count(input_channels, count);
+        part.iact_buf = job.iact_buf;
+        part.iact_bytes = job.iact_bytes;
+        if (job.wght_buf != nullptr) {
+            part.wght_buf = static_cast<const int8_t*>(job.wght_buf) + wght_offset;
+            part.wght_bytes = job.wght_bytes > wght_offset ? min(job.wght_bytes - wght_offset, count * wght_bytes_per_och) : 0;
+        }
+        part.bias = slice(job.bias, first, count);
+        part.factors = slice(job.factors, first, count);
+        part.zeropoints = slice(job.zeropoints, first, count);
+        part.psum_buf = static_cast<int8_t*>(job.psum_buf) + psum_offset;
+        part.psum_bytes = job.psum_bytes > psum_offset ? min(job.psum_bytes - psum_offset, count * psum_bytes_per_och) : 0;
+
+        futures.push_back(executors[order[n]]->submit(std::move(part)));
+        first += count;
+    }
+
+    return async(launch::deferred, [futures = std::move(futures)]() mutable {
+        // wait for every part before reporting errors, the caller may release the buffers afterwards
+        Conv2DResult merged;
+        merged.success = true;
+        exception_ptr error;
+        for (auto& fut : futures) {
+            try {
+                Conv2DResult result = fut.get();
+                merged.success &= result.success;
+                merged.cycles = max(merged.cycles, result.cycles);
+                merged.wait_latency_ns = max(merged.wait_latency_ns, result.wait_latency_ns);
+            } catch (...) {
+                if (!error)
+                    error = current_exception();
+            }
+        }
+        if (error)
+            rethrow_exception(error);
+        return merged;
+    });
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "executor.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// a set of accelerator devices (tiles or boards), each driven by its own Conv2DExecutor
+class DevicePool {
+public:
+    DevicePool() = default;
+    ~DevicePool();
+
+    DevicePool(const DevicePool&) = delete;
+    DevicePool& operator=(const DevicePool&) = delete;
+
+    // open, verify and reset all devices (uio names or RECACC_SIM_DEVICE)
+    // throws if any device fails, devices opened so far are closed again
+    void open(const std::vector<std::string>& device_names, bool print_info = false);
+    void close();
+
+    size_t size() const;
+    Conv2DExecutor& get_executor(size_t index);
+
+    // run the job on the device with the fewest queued jobs
+    // a transfer engine set on job.op is only used on its own device, give every executor its own engine instead
+    // (see Conv2DExecutor::set_transfer_engine)
+    std::future<Conv2DResult> submit(Conv2DJob job);
+
+    // split the job by output channel across all devices, results land in the job's output buffer
+    // weights must be dense OIHW and the output dense CHW, as used by Conv2D::copy_data_in/copy_data_out
+    // the returned future reports success only if all parts succeeded, cycles is the slowest part
+    std::future<Conv2DResult> submit_split(Conv2DJob job);
+
+private:
+    size_t least_loaded() const;
+
+    std::vector<std::unique_ptr<recacc_device>> devices;
+    std::vector<std::unique_ptr<Conv2DExecutor>> executors;
+    mutable std::atomic<size_t> next_device = 0; // rotates the starting point among equally loaded devices
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+enum pool_mode {
+    pool_max, pool_avg
+};
+
+// max or average pooling of every output channel with size x size windows, e.g. fused into Conv2D::copy_data_out
+// windows stay within the plane (no padding), a plane of n rows gives output_size(n) rows
+struct Pool2D {
+    enum pool_mode mode = pool_max;
+    unsigned size = 2;
+    unsigned stride = 2;
+
+    unsigned output_size(unsigned input_size) const {
+        return input_size < size ? 0 : (input_size - size) / stride + 1;
+    }
+
+    // one output row from the size input rows of its windows, averages are rounded half away from zero
+    template<typename T> void pool_row(const T* const* rows, unsigned width, T* out, ptrdiff_t out_stride) const {
+        // the sizes used by most networks with the window loops unrolled
+        if (size == 2)
+            pool_row_fixed<T, 2>(rows, width, out, out_stride);
+        else if (size == 3)
+            pool_row_fixed<T, 3>(rows, width, out, out_stride);
+        else
+            pool_row_fixed<T, 0>(rows, width, out, out_stride);
+    }
+
+private:
+    template<typename T, unsigned Size> void pool_row_fixed(const T* const* rows, unsigned width, T* out, ptrdiff_t out_stride) const {
+        const unsigned n = Size ? Size : size;
+        const unsigned out_width = output_size(width);
+        const int64_t count = n * n;
+        if (mode == pool_max) {
+            for (unsigned px = 0; px < out_width; px++, out += out_stride) {
+                const unsigned x0 = px * stride;
+                T result = rows[0][x0];
+                for (unsigned i = 0; i < n; i++)
+                    for (unsigned j = 0; j < n; j++)
+                        result = std::max(result, rows[i][x0 + j]);
+                *out = result;
+            }
+        } else {
+            for (unsigned px = 0; px < out_width; px++, out += out_stride) {
+                const unsigned x0 = px * stride;
+                int64_t sum = 0;
+                for (unsigned i = 0; i < n; i++)
+                    for (unsigned j = 0; j < n; j++)
+                        sum += rows[i][x0 + j];
+                *out = static_cast<T>(sum >= 0 ? (sum + count / 2) / count : -((count / 2 - sum) / count));
+            }
+        }
+    }
+};
@@ -0,0 +1,63 @@
+#include "psum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static inline psum_t add_saturating(psum_t a, psum_t b) {
+    psum_t sum;
+    if (__builtin_add_overflow(a, b, &sum))
+        return a < 0 ? numeric_limits<psum_t>::min() : numeric_limits<psum_t>::max();
+    return sum;
+}
+
+void psum_accumulate(psum_t* acc, const psum_t* src, size_t count) {
+    size_t n = 0;
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    for (; n + 4 <= count; n += 4)
+        vst1q_s32(acc + n, vqaddq_s32(vld1q_s32(acc + n), vld1q_s32(src + n)));
+#elif defined(__SSE2__)
+    // sse has no saturating 32-bit add: overflow happened if both operands have the same sign and the sum differs,
+    // the saturated value is then INT32_MAX for positive and INT32_MIN for negative operands
+    const __m128i max = _mm_set1_epi32(numeric_limits<psum_t>::max());
+    for (; n + 4 <= count; n += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + n));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n));
+        __m128i sum = _mm_add_epi32(a, b);
+        __m128i overflow = _mm_srai_epi32(_mm_andnot_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, sum)), 31);
+        __m128i saturated = _mm_xor_si128(_mm_srai_epi32(a, 31), max);
+        sum = _mm_or_si128(_mm_and_si128(overflow, saturated), _mm_andnot_si128(overflow, sum));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + n), sum);
+    }
+#endif
+    for (; n < count; n++)
+        acc[n] = add_saturating(acc[n], src[n]);
+}
+
+void psum_postprocess(const psum_t* psums, void* out, size_t count,
+        psum_t bias, bool relu, bool requantize, float scale, float zeropoint) {
+    psum_t* out_psums = static_cast<psum_t*>(out);
+    input_t* out_requant = static_cast<input_t*>(out);
+    for (size_t n = 0; n < count; n++) {
+        psum_t value = add_saturating(psums[n], bias);
+        if (relu)
+            value = max(value, 0);
+        if (requantize) {
+            // same rounding and clamping as requantize_cpu
+            float requantized = value * scale + zeropoint;
+            out_requant[n] = clamp(static_cast<psum_t>(round(requantized)),
+                static_cast<psum_t>(numeric_limits<input_t>::min()),
+                static_cast<psum_t>(numeric_limits<input_t>::max()));
+        } else
+            out_psums[n] = value;
+    }
+}
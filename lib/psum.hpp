@@ -0,0 +1,15 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+
+// host-side postprocessing of raw psums, for results that are accumulated over several accelerator runs
+
+// acc[n] += src[n] for count values, saturating at the limits of psum_t like the accumulation of conv2d_cpu
+void psum_accumulate(psum_t* acc, const psum_t* src, size_t count);
+
+// the postprocessing of the hardware for one output channel: add bias (saturating), apply relu if enabled,
+// then requantize to input_t with scale and zeropoint if enabled, otherwise keep psum_t
+// out receives count values of input_t or psum_t, it may alias psums
+void psum_postprocess(const psum_t* psums, void* out, size_t count,
+    psum_t bias, bool relu, bool requantize, float scale, float zeropoint);
@@ -0,0 +1,151 @@
+#include "spadalloc.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils.hpp"
+
+using namespace std;
+
+SpadAllocator::SpadAllocator(const recacc_hwinfo& hwinfo) : SpadAllocator(hwinfo.spad_size / hwinfo.spad_word_size) {}
+
+SpadAllocator::SpadAllocator(unsigned column_bytes) : column_bytes(column_bytes / alignment * alignment) {
+    insert_free(0, this->column_bytes);
+}
+
+void SpadAllocator::insert_free(unsigned offset, unsigned bytes) {
+    if (!bytes)
+        return;
+
+    // merge with the neighbouring free blocks
+    auto next = free_by_offset.lower_bound(offset);
+    if (next != free_by_offset.end() && offset + bytes == next->first) {
+        bytes += next->second;
+        erase_free(next++);
+    }
+    if (next != free_by_offset.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            bytes += prev->second;
+            erase_free(prev);
+        }
+    }
+
+    free_by_offset.emplace(offset, bytes);
+    free_by_size.emplace(bytes, offset);
+}
+
+void SpadAllocator::erase_free(map<unsigned, unsigned>::iterator it) {
+    free_by_size.erase({it->second, it->first});
+    free_by_offset.erase(it);
+}
+
+unsigned SpadAllocator::allocate(const string& name, unsigned bytes, unsigned last_step) {
+    if (allocations.count(name))
+        throw runtime_error("spad allocation " + name + " exists already");
+
+    bytes = make_multiple_of(alignment, max(bytes, 1U));
+
+    // best fit: the smallest free block that is large enough, the lowest offset among equal sizes
+    auto fit = free_by_size.lower_bound({bytes, 0});
+    if (fit == free_by_size.end()) {
+        failures++;
+        throw runtime_error("spad too small for " + name + " (" + to_string(bytes) + " bytes per column, largest free block "
+            + to_string(free_by_size.empty() ? 0 : free_by_size.rbegin()->first) + ")");
+    }
+
+    auto [block_bytes, offset] = *fit;
+    erase_free(free_by_offset.find(offset));
+    insert_free(offset + bytes, block_bytes - bytes);
+
+    allocations.emplace(name, Allocation{offset, bytes, last_step});
+    used_bytes += bytes;
+    peak_used_bytes = max(peak_used_bytes, used_bytes);
+    return offset;
+}
+
+void SpadAllocator::release(const string& name) {
+    auto it = allocations.find(name);
+    if (it == allocations.end())
+        throw runtime_error("spad allocation " + name + " does not exist");
+
+    insert_free(it->second.offset, it->second.bytes);
+    used_bytes -= it->second.bytes;
+    allocations.erase(it);
+}
+
+void SpadAllocator::set_last_step(const string& name, unsigned last_step) {
+    auto it = allocations.find(name);
+    if (it == allocations.end())
+        throw runtime_error("spad allocation " + name + " does not exist");
+    it->second.last_step = last_step;
+}
+
+void SpadAllocator::rename(const string& name, const string& new_name) {
+    auto it = allocations.find(name);
+    if (it == allocations.end())
+        throw runtime_error("spad allocation " + name + " does not exist");
+    if (allocations.count(new_name))
+        throw runtime_error("spad allocation " + new_name + " exists already");
+    Allocation allocation = it->second;
+    allocations.erase(it);
+    allocations.emplace(new_name, allocation);
+}
+
+void SpadAllocator::advance(unsigned new_step) {
+    step = new_step;
+    for (auto it = allocations.begin(); it != allocations.end();) {
+        if (it->second.last_step < step) {
+            insert_free(it->second.offset, it->second.bytes);
+            used_bytes -= it->second.bytes;
+            it = allocations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+unsigned SpadAllocator::get_step() const {
+    return step;
+}
+
+bool SpadAllocator::contains(const string& name) const {
+    return allocations.count(name) != 0;
+}
+
+const SpadAllocator::Allocation& SpadAllocator::get(const string& name) const {
+    auto it = allocations.find(name);
+    if (it == allocations.end())
+        throw runtime_error("spad allocation " + name + " does not exist");
+    return it->second;
+}
+
+vector<pair<string, SpadAllocator::Allocation>> SpadAllocator::get_allocations() const {
+    vector<pair<string, Allocation>> list(allocations.begin(), allocations.end());
+    sort(list.begin(), list.end(), [](const auto& a, const auto& b) { return a.second.offset < b.second.offset; });
+    return list;
+}
+
+SpadAllocator::Stats SpadAllocator::get_stats() const {
+    Stats stats;
+    stats.column_bytes = column_bytes;
+    stats.used_bytes = used_bytes;
+    stats.free_bytes = column_bytes - used_bytes;
+    stats.largest_free = free_by_size.empty() ? 0 : free_by_size.rbegin()->first;
+    stats.peak_used_bytes = peak_used_bytes;
+    stats.allocations = allocations.size();
+    stats.free_blocks = free_by_offset.size();
+    stats.failures = failures;
+    if (stats.free_bytes)
+        stats.fragmentation = 1.0f - 1.0f * stats.largest_free / stats.free_bytes;
+    return stats;
+}
+
+void SpadAllocator::clear() {
+    allocations.clear();
+    free_by_offset.clear();
+    free_by_size.clear();
+    used_bytes = 0;
+    insert_free(0, column_bytes);
+}
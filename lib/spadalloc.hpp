@@ -0,0 +1,79 @@
+#pragma once
+
+#include "types.h"
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+    #include <driver.h>
+}
+
+// best-fit allocator for the scratchpad. the accelerator addresses all columns with the same offset, so every
+// allocation takes the same range of bytes in each column and sizes are given per column.
+// allocations are named and carry a lifetime: the last step (e.g. layer or job index) they are needed in.
+// advance() moves to a later step and releases everything that expired, so the weights of several layers,
+// intermediate activations and padding rows can stay in the scratchpad side by side as long as they are used.
+class SpadAllocator {
+public:
+    static constexpr unsigned alignment = 8;     // scratchpad word accesses, all offsets and sizes are multiples
+    static constexpr unsigned forever = UINT_MAX; // lifetime of allocations that are only released explicitly
+
+    struct Stats {
+        unsigned column_bytes = 0;    // managed bytes per column
+        unsigned used_bytes = 0;      // allocated bytes per column
+        unsigned free_bytes = 0;
+        unsigned largest_free = 0;    // largest allocation that would succeed
+        unsigned peak_used_bytes = 0;
+        size_t allocations = 0;       // live allocations
+        size_t free_blocks = 0;
+        uint64_t failures = 0;        // allocations that did not fit
+        float fragmentation = 0.0f;   // 1 - largest_free / free_bytes, 0 if all free bytes are contiguous
+    };
+
+    struct Allocation {
+        unsigned offset;
+        unsigned bytes;
+        unsigned last_step;
+    };
+
+    explicit SpadAllocator(const recacc_hwinfo& hwinfo);
+    explicit SpadAllocator(unsigned column_bytes);
+
+    // allocate bytes (rounded up to the alignment) in every column for the steps up to last_step and return
+    // the column offset, throws if the name is taken or no free block is large enough
+    unsigned allocate(const std::string& name, unsigned bytes, unsigned last_step = forever);
+    void release(const std::string& name);
+    void set_last_step(const std::string& name, unsigned last_step);
+    // hand an allocation over to a new owner, e.g. the psum of one layer becoming the iact of the next
+    void rename(const std::string& name, const std::string& new_name);
+
+    // move to step and release all allocations whose last step is before it
+    void advance(unsigned step);
+    unsigned get_step() const;
+
+    bool contains(const std::string& name) const;
+    const Allocation& get(const std::string& name) const;
+    std::vector<std::pair<std::string, Allocation>> get_allocations() const; // ordered by offset
+
+    Stats get_stats() const;
+    void clear(); // release everything, statistics and step are kept
+
+private:
+    void insert_free(unsigned offset, unsigned bytes);
+    void erase_free(std::map<unsigned, unsigned>::iterator it);
+
+    unsigned column_bytes;
+    unsigned step = 0;
+    unsigned used_bytes = 0;
+    unsigned peak_used_bytes = 0;
+    uint64_t failures = 0;
+    std::map<std::string, Allocation> allocations;
+    std::map<unsigned, unsigned> free_by_offset;          // offset -> size of every free block, coalesced
+    std::set<std::pair<unsigned, unsigned>> free_by_size; // (size, offset) of the same blocks, for best fit
+};
@@ -0,0 +1,201 @@
+#include "spadcopy.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SPAD_COPY_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SPAD_COPY_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SPAD_COPY_SSE2
+#endif
+
+using namespace std;
+
+namespace spadcopy_detail {
+#if defined(__x86_64__) || defined(__i386__)
+enum spad_copy_mode mode = spad_copy_plain;
+#else
+enum spad_copy_mode mode = spad_copy_aligned;
+#endif
+}
+
+void set_spad_copy_mode(enum spad_copy_mode mode) {
+    spadcopy_detail::mode = mode;
+}
+
+enum spad_copy_mode get_spad_copy_mode() {
+    return spadcopy_detail::mode;
+}
+
+namespace {
+
+// all scratchpad accesses go through volatile pointers, this stops the compiler from fusing the loops into memcpy/memset calls
+#if defined(SPAD_COPY_NEON)
+constexpr size_t vec_bytes = 16;
+using vec_t = uint8x16_t;
+inline vec_t vec_load(const uint8_t* src) { return vld1q_u8(src); }
+inline vec_t vec_zero() { return vdupq_n_u8(0); }
+inline void vec_store(uint8_t* dst, vec_t v) { *reinterpret_cast<volatile vec_t*>(dst) = v; }
+inline void vec_store_host(uint8_t* dst, vec_t v) { vst1q_u8(dst, v); }
+#elif defined(SPAD_COPY_AVX2)
+constexpr size_t vec_bytes = 32;
+using vec_t = __m256i;
+inline vec_t vec_load(const uint8_t* src) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)); }
+inline vec_t vec_zero() { return _mm256_setzero_si256(); }
+inline void vec_store(uint8_t* dst, vec_t v) { *reinterpret_cast<volatile vec_t*>(dst) = v; }
+inline void vec_store_host(uint8_t* dst, vec_t v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v); }
+#elif defined(SPAD_COPY_SSE2)
+constexpr size_t vec_bytes = 16;
+using vec_t = __m128i;
+inline vec_t vec_load(const uint8_t* src) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+inline vec_t vec_zero() { return _mm_setzero_si128(); }
+inline void vec_store(uint8_t* dst, vec_t v) { *reinterpret_cast<volatile vec_t*>(dst) = v; }
+inline void vec_store_host(uint8_t* dst, vec_t v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v); }
+#else
+constexpr size_t vec_bytes = 8;
+using vec_t = uint64_t;
+inline vec_t vec_load(const uint8_t* src) { vec_t v; memcpy(&v, src, sizeof(v)); return v; }
+inline vec_t vec_zero() { return 0; }
+inline void vec_store(uint8_t* dst, vec_t v) { *reinterpret_cast<volatile vec_t*>(dst) = v; }
+inline void vec_store_host(uint8_t* dst, vec_t v) { memcpy(dst, &v, sizeof(v)); }
+#endif
+
+// aligned load from the scratchpad, dst of vec_store_host is ordinary host memory with any alignment
+inline vec_t vec_load_device(const uint8_t* src) { return *reinterpret_cast<const volatile vec_t*>(src); }
+
+// loads a vector from src, lanes at and beyond bytes are zero
+inline vec_t vec_load_partial(const uint8_t* src, size_t bytes) {
+    if (bytes >= vec_bytes)
+        return vec_load(src);
+    alignas(vec_bytes) uint8_t lanes[vec_bytes] = {};
+    memcpy(lanes, src, bytes);
+    return vec_load(lanes);
+}
+
+// writes bytes to dst with the widest naturally aligned stores possible (8, 4, 2 or 1 bytes)
+// data is taken from src up to src_bytes, the rest is zero
+void store_narrow(uint8_t* dst, const uint8_t* src, size_t src_bytes, size_t bytes) {
+    size_t n = 0;
+    while (n < bytes) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(dst + n);
+        size_t width = 8;
+        while (width > 1 && (addr % width || bytes - n < width))
+            width /= 2;
+
+        uint64_t value = 0;
+        if (n < src_bytes)
+            memcpy(&value, src + n, min(width, src_bytes - n));
+
+        switch (width) {
+            case 8:
+                *reinterpret_cast<volatile uint64_t*>(dst + n) = value;
+                break;
+            case 4:
+                *reinterpret_cast<volatile uint32_t*>(dst + n) = static_cast<uint32_t>(value);
+                break;
+            case 2:
+                *reinterpret_cast<volatile uint16_t*>(dst + n) = static_cast<uint16_t>(value);
+                break;
+            default:
+                *reinterpret_cast<volatile uint8_t*>(dst + n) = static_cast<uint8_t>(value);
+        }
+        n += width;
+    }
+}
+
+}
+
+void spad_copy_in_aligned(void* dst, const void* src, size_t bytes, size_t bytes_total) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    bytes = min(bytes, bytes_total);
+
+    // narrow stores up to the first vector aligned address
+    size_t head = (vec_bytes - reinterpret_cast<uintptr_t>(d) % vec_bytes) % vec_bytes;
+    head = min(head, bytes_total);
+    store_narrow(d, s, min(bytes, head), head);
+    size_t n = head;
+
+    // aligned vector stores of source data, unrolled to keep several loads in flight
+    for (; n + 4 * vec_bytes <= bytes; n += 4 * vec_bytes) {
+        vec_t v0 = vec_load(s + n);
+        vec_t v1 = vec_load(s + n + vec_bytes);
+        vec_t v2 = vec_load(s + n + 2 * vec_bytes);
+        vec_t v3 = vec_load(s + n + 3 * vec_bytes);
+        vec_store(d + n, v0);
+        vec_store(d + n + vec_bytes, v1);
+        vec_store(d + n + 2 * vec_bytes, v2);
+        vec_store(d + n + 3 * vec_bytes, v3);
+    }
+    for (; n + vec_bytes <= bytes; n += vec_bytes)
+        vec_store(d + n, vec_load(s + n));
+
+    // the vector containing the end of the source data is merged with zeros
+    if (n < bytes && n + vec_bytes <= bytes_total) {
+        vec_store(d + n, vec_load_partial(s + n, bytes - n));
+        n += vec_bytes;
+    }
+
+    for (; n + vec_bytes <= bytes_total; n += vec_bytes)
+        vec_store(d + n, vec_zero());
+
+    if (n < bytes_total)
+        store_narrow(d + n, n < bytes ? s + n : nullptr, n < bytes ? bytes - n : 0, bytes_total - n);
+}
+
+void spad_copy_out_aligned(void* dst, const void* src, size_t bytes) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    alignas(vec_bytes) uint8_t lanes[vec_bytes];
+    size_t n = 0;
+
+    // the head is extracted from the aligned vector containing the first byte
+    size_t misalign = reinterpret_cast<uintptr_t>(s) % vec_bytes;
+    if (misalign && bytes) {
+        n = min(bytes, vec_bytes - misalign);
+        vec_store_host(lanes, vec_load_device(s - misalign));
+        memcpy(d, lanes + misalign, n);
+    }
+
+    // aligned vector loads, the output may be unaligned
+    for (; n + 4 * vec_bytes <= bytes; n += 4 * vec_bytes) {
+        vec_t v0 = vec_load_device(s + n);
+        vec_t v1 = vec_load_device(s + n + vec_bytes);
+        vec_t v2 = vec_load_device(s + n + 2 * vec_bytes);
+        vec_t v3 = vec_load_device(s + n + 3 * vec_bytes);
+        vec_store_host(d + n, v0);
+        vec_store_host(d + n + vec_bytes, v1);
+        vec_store_host(d + n + 2 * vec_bytes, v2);
+        vec_store_host(d + n + 3 * vec_bytes, v3);
+    }
+    for (; n + vec_bytes <= bytes; n += vec_bytes)
+        vec_store_host(d + n, vec_load_device(s + n));
+
+    // the tail is extracted from one more aligned vector, which never crosses the end of the mapping
+    if (n < bytes) {
+        vec_store_host(lanes, vec_load_device(s + n));
+        memcpy(d + n, lanes, bytes - n);
+    }
+}
+
+void spad_zero_aligned(void* dst, size_t bytes) {
+    spad_copy_in_aligned(dst, nullptr, 0, bytes);
+}
+
+const char* spad_copy_isa() {
+#if defined(SPAD_COPY_NEON)
+    return "neon";
+#elif defined(SPAD_COPY_AVX2)
+    return "avx2";
+#elif defined(SPAD_COPY_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "types.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "conv2d.hpp"
+#include "plan.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// layer parameters known at build time, as set on a Conv2D by the constructor and the setters
+struct Conv2DShape {
+    unsigned image_size = 0;
+    unsigned kernel_size = 0;
+    unsigned input_channels = 0;
+    unsigned output_channels = 0;
+    bool requantize = false;
+    bool padding = false;
+    enum activation_mode act_mode = act_none;
+    int throttle = -1; // negative estimates the throttle as Conv2D::guess_psum_throttle does
+};
+
+// everything allocate_spad_auto and compute_accelerator_parameters(true) compute for a whole scratchpad,
+// plus the feasibility checks they do at runtime
+struct StaticConv2DValues {
+    recacc_config cfg{};
+    unsigned base_iact = 0, base_wght = 0, base_psum = 0, base_padding = 0;
+    unsigned alloc_size_iact = 0, alloc_size_wght = 0, alloc_size_psum = 0;
+    unsigned spad_column_stride = 0;
+    unsigned channels_per_column = 0;
+    unsigned bytes_per_psum = 0, bytes_per_channel = 0, bytes_per_kernel = 0, bytes_per_output_channel = 0;
+    unsigned dummy_channels = 0;
+    int throttle = 0;
+
+    bool mappable = false;   // square shapes, a kernel row and a scratchpad word of channels fit the pe array
+    bool fits_iact = false;
+    bool fits_wght = false;
+    bool fits_psum = false;
+    bool single_pass = false; // no output channel groups required for the postprocessing registers (see TiledConv2D)
+    bool consistent = false;  // the channel split passes the checks of compute_accelerator_parameters
+};
+
+namespace static_plan {
+
+constexpr unsigned ceil_div(unsigned a, unsigned b) {
+    return (a + b - 1) / b;
+}
+
+constexpr unsigned multiple_of(unsigned n, unsigned value) {
+    return ceil_div(value, n) * n;
+}
+
+// pow(2, ceil(log2(bits)) - 3)
+constexpr unsigned bytes_for_bits(unsigned bits) {
+    unsigned pow2 = 1;
+    while (pow2 < bits)
+        pow2 *= 2;
+    return pow2 / 8;
+}
+
+constexpr double ceil(double value) {
+    double truncated = static_cast<double>(static_cast<long long>(value));
+    return truncated < value ? truncated + 1 : truncated;
+}
+
+constexpr bool same_hwinfo(const recacc_hwinfo& a, const recacc_hwinfo& b) {
+    return a.array_size_x == b.array_size_x && a.array_size_y == b.array_size_y
+        && a.line_length_iact == b.line_length_iact && a.line_length_wght == b.line_length_wght
+        && a.line_length_psum == b.line_length_psum && a.fifo_size_psum == b.fifo_size_psum
+        && a.spad_size == b.spad_size && a.spad_word_size == b.spad_word_size
+        && a.data_width_bits_iact == b.data_width_bits_iact && a.data_width_bits_wght == b.data_width_bits_wght
+        && a.data_width_bits_psum == b.data_width_bits_psum && a.max_output_channels == b.max_output_channels
+        && a.trs_dataflow == b.trs_dataflow && a.bias_requant_available == b.bias_requant_available;
+}
+
+// Conv2D::guess_psum_throttle with the same (mixed integer and floating point) arithmetic
+constexpr int guess_psum_throttle(const recacc_hwinfo& hw, const recacc_config& cfg, bool requantize, unsigned bytes_per_psum) {
+    unsigned pixel_size = requantize ? 1 : bytes_per_psum;
+    unsigned output_phase_size = hw.array_size_x * cfg.m0 * cfg.w1 * pixel_size;
+    unsigned psum_fifo_size = hw.array_size_x * hw.fifo_size_psum * hw.spad_word_size;
+    float store_rate = 1.0f * hw.spad_word_size * RECACC_ARRAY_CLK_MHZ / RECACC_SPAD_CLK_MHZ;
+    float output_rate = 1.0f * hw.array_size_x * pixel_size;
+    if (store_rate >= output_rate || output_phase_size <= psum_fifo_size)
+        return 0;
+    float rate_factor = store_rate / (output_rate * (1 - psum_fifo_size / output_phase_size));
+    double throttle = ceil(255.0 * (1 - 0.9 * rate_factor));
+    return throttle < 0.0 ? 0 : throttle > 255.0 ? 255 : static_cast<int>(throttle);
+}
+
+// allocate_spad_auto() and compute_accelerator_parameters(true) of Conv2D, evaluated at compile time
+// infeasible layers return early with the failed check cleared, later fields are left zero
+constexpr StaticConv2DValues plan(const recacc_hwinfo& hw, const Conv2DShape& layer) {
+    StaticConv2DValues v;
+    const unsigned iact = layer.image_size, wght = layer.kernel_size;
+    const unsigned ic = layer.input_channels, oc = layer.output_channels;
+    const unsigned word = hw.spad_word_size;
+
+    v.mappable = iact > 0 && wght > 0 && wght <= iact && ic > 0 && oc > 0 && word > 0
+        && hw.array_size_x > 0 && hw.array_size_y >= wght && hw.line_length_wght > wght * word;
+    if (!v.mappable)
+        return v;
+
+    // _compute_buffer_sizes
+    v.bytes_per_channel = iact * iact;
+    v.bytes_per_kernel = wght * wght;
+    v.bytes_per_output_channel = layer.padding ? iact * iact : (iact - wght + 1) * (iact - wght + 1);
+    v.bytes_per_psum = bytes_for_bits(layer.requantize ? hw.data_width_bits_iact : hw.data_width_bits_psum);
+    v.bytes_per_output_channel *= v.bytes_per_psum;
+    v.spad_column_stride = hw.spad_size / word;
+    v.channels_per_column = ceil_div(ic, word);
+
+    // allocate_spad_auto with a single region
+    const unsigned region_end = v.spad_column_stride / 8 * 8;
+    const unsigned output_channels_per_column = ceil_div(oc, word);
+    const unsigned size_iact = v.channels_per_column * v.bytes_per_channel;
+    const unsigned size_kernel_set = v.channels_per_column * v.bytes_per_kernel;
+    const unsigned alloc_size_kernel_set = multiple_of(8, size_kernel_set);
+    const unsigned size_wght = oc * alloc_size_kernel_set;
+
+    v.base_iact = 0;
+    v.base_wght = v.base_iact + multiple_of(8, size_iact);
+    if (layer.padding) {
+        if (v.base_iact + size_iact < v.base_wght)
+            v.base_padding = v.base_iact + size_iact;
+        else if (size_kernel_set < alloc_size_kernel_set)
+            v.base_padding = v.base_wght + size_kernel_set;
+    }
+    v.base_psum = multiple_of(8, v.base_wght + size_wght);
+    if (layer.padding && v.base_padding == 0) {
+        if (v.base_wght + size_wght < v.base_psum)
+            v.base_padding = v.base_wght + size_wght;
+        else {
+            v.base_padding = v.base_psum;
+            v.base_psum += 8;
+        }
+    }
+
+    v.alloc_size_iact = (v.base_wght - v.base_iact) * word;
+    v.alloc_size_wght = (v.base_psum - v.base_wght) * word;
+    v.alloc_size_psum = v.base_psum < region_end ? (region_end - v.base_psum) * word : 0;
+
+    v.fits_iact = v.base_iact < region_end && v.alloc_size_iact >= v.bytes_per_channel * ic;
+    v.fits_wght = v.base_wght < region_end && v.alloc_size_wght >= v.bytes_per_kernel * ic * oc;
+    v.fits_psum = v.base_psum < region_end && output_channels_per_column * v.bytes_per_output_channel < region_end - v.base_psum;
+    v.single_pass = !hw.bias_requant_available || hw.max_output_channels == 0 || oc <= hw.max_output_channels;
+    if (!v.fits_iact || !v.fits_wght || !v.fits_psum)
+        return v;
+
+    // compute_accelerator_parameters
+    recacc_config& cfg = v.cfg;
+    v.dummy_channels = multiple_of(word, ic) - ic;
+    cfg.iact_dimension = iact;
+    cfg.wght_dimension = wght;
+    cfg.input_channels = ic + v.dummy_channels;
+    cfg.output_channels = oc;
+    cfg.base_addr_iact = v.base_iact;
+    cfg.base_addr_wght = v.base_wght;
+    cfg.base_addr_psum = v.base_psum;
+    cfg.base_addr_pad = v.base_padding;
+    cfg.stride_iact_w = iact;
+    cfg.stride_iact_hw = iact * iact;
+    cfg.stride_wght_krnl = v.bytes_per_kernel;
+    cfg.stride_wght_och = multiple_of(word, ceil_div(v.bytes_per_kernel * cfg.input_channels, word));
+    cfg.stride_psum_och = ceil_div(v.bytes_per_output_channel, word);
+    cfg.stride = 1;
+
+    cfg.m0 = hw.array_size_y / wght;
+    cfg.m1 = ceil_div(oc, cfg.m0);
+    cfg.m0_last_m1 = oc - (cfg.m1 - 1) * cfg.m0;
+    if (layer.padding) {
+        cfg.w1 = iact;
+        cfg.pad_x = cfg.pad_y = (wght - 1) / 2;
+    } else {
+        cfg.w1 = iact - wght + 1;
+        cfg.pad_x = cfg.pad_y = 0;
+    }
+    cfg.rows_last_h2 = 1;
+    cfg.h2 = ceil_div(iact + cfg.pad_x, hw.array_size_x);
+
+    const unsigned c0_max = (hw.line_length_wght - 1) / wght / word * word;
+    cfg.c0 = cfg.input_channels < c0_max ? cfg.input_channels : c0_max;
+    cfg.c1 = ceil_div(cfg.input_channels, cfg.c0);
+    cfg.c0_last_c1 = cfg.input_channels - (cfg.c1 - 1) * cfg.c0;
+    cfg.c0w0 = cfg.c0 * wght;
+    cfg.c0w0_last_c1 = cfg.c0_last_c1 * wght;
+
+    v.throttle = layer.throttle < 0 ? guess_psum_throttle(hw, cfg, layer.requantize, v.bytes_per_psum) : layer.throttle;
+    cfg.psum_throttle = v.throttle;
+
+    if (cfg.c0w0_last_c1 < 6) {
+        cfg.c1 = cfg.c1 - 1;
+        cfg.c0_last_c1 = cfg.input_channels - (cfg.c1 - 1) * cfg.c0;
+        cfg.c0w0 = cfg.c0 * wght;
+        cfg.c0w0_last_c1 = cfg.c0_last_c1 * wght;
+    }
+
+    v.consistent = cfg.c1 > 0
+        && 1U * cfg.c0w0 * (cfg.c1 - 1) + cfg.c0w0_last_c1 == cfg.input_channels * wght
+        && cfg.c0w0_last_c1 >= 6
+        && cfg.c0w0_last_c1 < hw.line_length_wght;
+    return v;
+}
+
+// configuration register values from RECACC_REG_IDX_INPUTCHS to RECACC_REG_IDX_STRIDE_PSUM_OCH, as written by
+// recacc_config_write and recorded by recacc_cmdbuf_config
+constexpr std::array<uint32_t, RECACC_REG_IDX_STRIDE_PSUM_OCH - RECACC_REG_IDX_INPUTCHS + 1> config_registers(const recacc_config& cfg) {
+    return {
+        cfg.input_channels, cfg.output_channels, cfg.iact_dimension, cfg.iact_dimension, cfg.wght_dimension,
+        cfg.c1, cfg.w1, cfg.h2, cfg.m1, cfg.m0, cfg.m0_last_m1, cfg.rows_last_h2,
+        cfg.c0, cfg.c0_last_c1, cfg.c0w0, cfg.c0w0_last_c1, cfg.psum_throttle,
+        static_cast<uint32_t>(cfg.pad_y << 8 | cfg.pad_x),
+        cfg.base_addr_iact, cfg.base_addr_wght, cfg.base_addr_psum, cfg.base_addr_pad,
+        cfg.stride_iact_w, cfg.stride_iact_hw, cfg.stride_wght_krnl, cfg.stride_wght_och, cfg.stride_psum_och,
+    };
+}
+
+// host buffer offset of every iact column, as Conv2D::compile_plan computes them
+template<unsigned WordSize> constexpr std::array<size_t, WordSize + 1> iact_column_offsets(const Conv2DShape& layer, const StaticConv2DValues& v) {
+    std::array<size_t, WordSize + 1> offsets{};
+    const size_t iact_bytes = static_cast<size_t>(layer.input_channels) * v.bytes_per_channel;
+    for (unsigned col = 0; col < WordSize; col++) {
+        size_t col_bytes = static_cast<size_t>(v.channels_per_column) * v.bytes_per_channel;
+        if (col >= WordSize - v.dummy_channels)
+            col_bytes -= v.bytes_per_channel;
+        size_t avail = iact_bytes - offsets[col];
+        offsets[col + 1] = offsets[col] + (col_bytes < avail ? col_bytes : avail);
+    }
+    return offsets;
+}
+
+} // namespace static_plan
+
+// a layer planned entirely at compile time for hardware described by HW, e.g. for deployed models with fixed shapes
+// layers that do not fit the scratchpad in one piece or need output channel groups fail to compile
+//
+//   constexpr recacc_hwinfo board = {...};
+//   using Layer1 = StaticConv2DPlan<board, Conv2DShape{.image_size = 32, .kernel_size = 3, .input_channels = 8, .output_channels = 3}>;
+//   Conv2D op = Layer1::make_op(dev, hwinfo); // no planning at runtime, throws if hwinfo differs from board
+template<recacc_hwinfo HW, Conv2DShape Layer>
+class StaticConv2DPlan {
+public:
+    static constexpr StaticConv2DValues values = static_plan::plan(HW, Layer);
+    static_assert(values.mappable, "layer shape can not be mapped to the pe array");
+    static_assert(!values.mappable || values.fits_iact, "scratchpad too small for iact data, use TiledConv2D");
+    static_assert(!values.mappable || values.fits_wght, "scratchpad too small for wght data, use TiledConv2D");
+    static_assert(!values.mappable || values.fits_psum, "scratchpad too small for psum data, use TiledConv2D");
+    static_assert(!values.mappable || values.single_pass, "more output channels than postprocessing registers, use TiledConv2D");
+    static_assert(!(values.fits_iact && values.fits_wght && values.fits_psum) || values.consistent,
+        "mismatch of calculated accelerator parameters");
+
+    static constexpr recacc_config cfg = values.cfg;
+    static constexpr auto registers = static_plan::config_registers(cfg);
+    static constexpr auto iact_column_offsets = static_plan::iact_column_offsets<HW.spad_word_size>(Layer, values);
+
+    static bool matches(const recacc_hwinfo& hwinfo) {
+        return static_plan::same_hwinfo(HW, hwinfo);
+    }
+
+    // the constants as a Conv2DPlan, built on first use
+    static std::shared_ptr<const Conv2DPlan> plan() {
+        static const std::shared_ptr<const Conv2DPlan> p = [] {
+            Conv2DPlan p;
+            p.cfg = cfg;
+            p.base_iact = values.base_iact;
+            p.base_wght = values.base_wght;
+            p.base_psum = values.base_psum;
+            p.base_padding = values.base_padding;
+            p.alloc_size_iact = values.alloc_size_iact;
+            p.alloc_size_wght = values.alloc_size_wght;
+            p.alloc_size_psum = values.alloc_size_psum;
+            p.spad_column_stride = values.spad_column_stride;
+            p.channels_per_column = values.channels_per_column;
+            p.bytes_per_psum = values.bytes_per_psum;
+            p.bytes_per_channel = values.bytes_per_channel;
+            p.bytes_per_kernel = values.bytes_per_kernel;
+            p.bytes_per_output_channel = values.bytes_per_output_channel;
+            p.dummy_channels = values.dummy_channels;
+            p.throttle = values.throttle;
+            p.iact_bytes = static_cast<size_t>(Layer.input_channels) * values.bytes_per_channel;
+            p.iact_column_offsets.assign(iact_column_offsets.begin(), iact_column_offsets.end());
+            return std::make_shared<const Conv2DPlan>(std::move(p));
+        }();
+        return p;
+    }
+
+    // a Conv2D of this layer with the plan applied, ready for copy_data_in and configure_accelerator
+    static Conv2D make_op(recacc_device* dev, const recacc_hwinfo& hwinfo) {
+        if (!matches(hwinfo))
+            throw std::runtime_error("hardware does not match the hwinfo the layer was planned for");
+
+        Conv2D op(Layer.image_size, Layer.kernel_size, Layer.input_channels, Layer.output_channels, Layer.requantize);
+        op.set_padding_mode(Layer.padding);
+        op.set_activation_mode(Layer.act_mode);
+        op.set_psum_throttle(Layer.throttle);
+        op.set_recacc_device(dev);
+        op.set_hwinfo(hwinfo);
+        op.apply_plan(plan());
+        return op;
+    }
+
+    // hand the plan to PlanCache::global(), so that Conv2DExecutor jobs of this layer skip planning as well
+    static void preload(const recacc_hwinfo& hwinfo) {
+        Conv2D op = make_op(nullptr, hwinfo);
+        op.set_psum_throttle(Layer.throttle); // the cache key holds the throttle setting, not the estimate
+        PlanCache::global().put(op, hwinfo, plan());
+    }
+};
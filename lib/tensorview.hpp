@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "spadcopy.hpp"
+#include "utils.hpp"
+
+// placement of a tensor of channel planes (height x width elements each) in the scratchpad columns, as written by
+// Conv2D::copy_data_in and read by copy_data_out. see Conv2D::get_iact_layout, get_wght_layout and get_psum_layout
+struct SpadTensorLayout {
+    unsigned base = 0;                // offset of the first plane in column 0
+    unsigned column_stride = 0;       // bytes between two columns
+    unsigned columns = 0;             // spad_word_size
+    unsigned channels = 0;            // planes visible through the view, without dummy channels
+    unsigned height = 0, width = 0;
+    unsigned element_bytes = 1;
+    unsigned plane_bytes = 0;         // bytes between consecutive planes of one column
+
+    // iact and wght: channels_per_column consecutive planes per column, the columns from full_columns on hold one
+    // plane less (dummy channels). psum: channels_per_column is 0 and plane c is in column c % columns,
+    // round_stride bytes after the planes of the previous round of columns
+    unsigned channels_per_column = 0;
+    unsigned full_columns = 0;
+    unsigned round_stride = 0;
+
+    // byte offset of the first element of plane c from the scratchpad start
+    size_t plane_offset(unsigned c) const {
+        if (!channels_per_column)
+            return base + static_cast<size_t>(c / columns) * round_stride + static_cast<size_t>(c % columns) * column_stride;
+
+        unsigned col, slot;
+        const unsigned channels_full = full_columns * channels_per_column;
+        if (c < channels_full) {
+            col = c / channels_per_column;
+            slot = c % channels_per_column;
+        } else {
+            col = full_columns + (c - channels_full) / (channels_per_column - 1);
+            slot = (c - channels_full) % (channels_per_column - 1);
+        }
+        return base + static_cast<size_t>(col) * column_stride + static_cast<size_t>(slot) * plane_bytes;
+    }
+
+    size_t offset(unsigned c, unsigned y, unsigned x) const {
+        return plane_offset(c) + (static_cast<size_t>(y) * width + x) * element_bytes;
+    }
+};
+
+// typed access to a tensor in the scratchpad, e.g. to produce iact or weights directly in accelerator memory and to
+// consume the results in place instead of staging them in host buffers for copy_data_in and copy_data_out.
+// the scratchpad is device memory: elements are accessed with naturally aligned loads and stores of T and rows or
+// planes with the spadcopy kernels, never with memcpy. a view is only valid as long as the placement of the
+// operation it was taken from does not change, and views bypass a transfer engine set on that operation.
+template<typename T> class SpadTensorView {
+public:
+    SpadTensorView(void* spad, const SpadTensorLayout& layout) : spad(static_cast<uint8_t*>(spad)), layout(layout) {
+        if (layout.element_bytes != sizeof(T))
+            throw std::runtime_error("tensor view element type does not match the scratchpad layout");
+    }
+
+    unsigned get_channels() const { return layout.channels; }
+    unsigned get_height() const { return layout.height; }
+    unsigned get_width() const { return layout.width; }
+    const SpadTensorLayout& get_layout() const { return layout; }
+
+    // byte offset from the scratchpad start, e.g. for a transfer engine
+    size_t offset(unsigned c, unsigned y, unsigned x) const { return layout.offset(c, y, x); }
+
+    T get(unsigned c, unsigned y, unsigned x) const {
+        return *reinterpret_cast<const volatile T*>(spad + layout.offset(c, y, x));
+    }
+
+    void set(unsigned c, unsigned y, unsigned x, T value) {
+        *reinterpret_cast<volatile T*>(spad + layout.offset(c, y, x)) = value;
+    }
+
+    // width elements of row y
+    void write_row(unsigned c, unsigned y, const T* src) {
+        spad_copy_in(spad + layout.offset(c, y, 0), src, row_bytes(), row_bytes());
+    }
+
+    void read_row(unsigned c, unsigned y, T* dst) const {
+        spad_copy_out(dst, spad + layout.offset(c, y, 0), row_bytes());
+    }
+
+    // height x width elements of plane c
+    void write_channel(unsigned c, const T* src) {
+        spad_copy_in(spad + layout.plane_offset(c), src, channel_bytes(), channel_bytes());
+    }
+
+    void read_channel(unsigned c, T* dst) const {
+        spad_copy_out(dst, spad + layout.plane_offset(c), channel_bytes());
+    }
+
+    // zero the whole region including the slots of dummy channels, which copy_data_in fills with zeros
+    // required before writing weights of layers with dummy channels through the view
+    void zero() {
+        if (!layout.channels_per_column) {
+            for (unsigned c = 0; c < layout.channels; c++)
+                spad_zero(spad + layout.plane_offset(c), channel_bytes());
+            return;
+        }
+        const size_t column_bytes = make_multiple_of(layout.columns, layout.channels_per_column * layout.plane_bytes);
+        for (unsigned col = 0; col < layout.columns; col++)
+            spad_zero(spad + layout.base + static_cast<size_t>(col) * layout.column_stride, column_bytes);
+    }
+
+private:
+    size_t row_bytes() const { return static_cast<size_t>(layout.width) * sizeof(T); }
+    size_t channel_bytes() const { return row_bytes() * layout.height; }
+
+    uint8_t* spad;
+    SpadTensorLayout layout;
+};
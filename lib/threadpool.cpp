@@ -0,0 +1,85 @@
+#include "threadpool.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    for (unsigned n = 1; n < threads; n++)
+        workers.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    start_cv.notify_all();
+    for (auto& t : workers)
+        t.join();
+}
+
+unsigned ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+void ThreadPool::run_items() {
+    size_t item;
+    while ((item = next_item++) < task_count) {
+        try {
+            (*task)(item);
+        } catch (...) {
+            lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = current_exception();
+        }
+    }
+}
+
+void ThreadPool::worker() {
+    unsigned seen = 0;
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        start_cv.wait(lock, [&] { return stop || generation != seen; });
+        if (stop)
+            break;
+        seen = generation;
+
+        lock.unlock();
+        run_items();
+        lock.lock();
+
+        if (--active == 0)
+            done_cv.notify_one();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const function<void(size_t)>& fn) {
+    if (count == 0)
+        return;
+
+    // not worth waking anybody up
+    if (workers.empty() || count == 1) {
+        for (size_t n = 0; n < count; n++)
+            fn(n);
+        return;
+    }
+
+    lock_guard<std::mutex> run_lock(run_mutex);
+    {
+        lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        task_count = count;
+        next_item = 0;
+        error = nullptr;
+        active = workers.size();
+        generation++;
+    }
+    start_cv.notify_all();
+
+    run_items();
+
+    unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return active == 0; });
+    task = nullptr;
+    if (error)
+        rethrow_exception(error);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent workers for splitting host-side loops (e.g. scratchpad copies) across cores
+// the calling thread takes part in the work, so a pool of size n starts n-1 threads
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const;
+
+    // call fn(0) ... fn(count - 1) distributed over all threads, returns when all calls finished
+    // the first exception thrown by fn is rethrown, concurrent callers are serialized
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    void worker();
+    void run_items();
+
+    std::vector<std::thread> workers;
+    std::mutex run_mutex; // held for a whole parallel_for
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const std::function<void(size_t)>* task = nullptr;
+    size_t task_count = 0;
+    std::atomic<size_t> next_item = 0;
+    unsigned generation = 0; // incremented for every parallel_for, wakes the workers
+    unsigned active = 0;     // workers still busy with the current generation
+    std::exception_ptr error;
+    bool stop = false;
+};
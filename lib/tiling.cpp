@@ -0,0 +1,375 @@
+#include "tiling.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "psum.hpp"
+#include "utils.hpp"
+
+using namespace std;
+
+TiledConv2D::TiledConv2D(recacc_device* dev, const recacc_hwinfo& hwinfo) : dev(dev), hwinfo(hwinfo) {}
+
+void TiledConv2D::set_tile_size(unsigned size) {
+    fixed_tile_size = size;
+    planned = false;
+}
+
+bool TiledConv2D::fits(Conv2D op) const {
+    try {
+        op.allocate_spad_auto();
+        return true;
+    } catch (const runtime_error&) {
+        return false;
+    }
+}
+
+// choose the largest (or the fixed) tile size for op, returns false if no tile fits
+bool TiledConv2D::plan_tiles(Conv2D& op) {
+    // padding is applied while gathering the tiles, the host buffers cannot be used by a dma engine
+    op.set_padding_mode(false);
+    op.set_transfer_engine(nullptr);
+
+    // a tile never needs to be larger than the padded image
+    const unsigned kernel_size = get<0>(op.get_kernel_size());
+    const unsigned max_size = output_size + kernel_size - 1;
+    auto fits_size = [&](unsigned size) {
+        op.set_image_size(size, size);
+        return fits(op);
+    };
+
+    if (fixed_tile_size) {
+        tile_size = min(fixed_tile_size, max_size);
+        if (tile_size < kernel_size || !fits_size(tile_size))
+            return false;
+    } else {
+        // the scratchpad usage grows with the tile size, so the largest fitting one can be bisected
+        unsigned lo = kernel_size, hi = max_size;
+        if (!fits_size(lo))
+            return false;
+        while (lo < hi) {
+            unsigned mid = (lo + hi + 1) / 2;
+            if (fits_size(mid))
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        tile_size = lo;
+    }
+    op.set_image_size(tile_size, tile_size);
+    tile_output_size = tile_size - kernel_size + 1;
+
+    // the last tile is moved back to end at the image border, it skips the outputs already produced by its predecessor
+    tile_starts.clear();
+    tile_skips.clear();
+    for (unsigned nominal = 0; nominal < output_size; nominal += tile_output_size) {
+        unsigned start = min(nominal, output_size - tile_output_size);
+        tile_starts.push_back(start);
+        tile_skips.push_back(nominal - start);
+    }
+    return true;
+}
+
+void TiledConv2D::plan(const Conv2D& op) {
+    auto [input_channels, output_channels] = op.get_channel_count();
+    auto [kernel_w, kernel_h] = op.get_kernel_size();
+    image_size = get<0>(op.get_image_size());
+    output_size = get<0>(op.get_output_size());
+    pad = op.get_padding_mode() ? (kernel_w - 1) / 2 : 0;
+
+    // tiles smaller than one pass of the pe array (array_size_x output rows) waste most of the array,
+    // rather split the output channels (cheap, iact stays resident) and then the input channels
+    const unsigned min_tile_output = min(output_size, hwinfo.array_size_x);
+    const unsigned word_size = hwinfo.spad_word_size;
+    const unsigned m0 = max(1U, hwinfo.array_size_y / kernel_h);
+    unsigned group_channels = 0;
+    for (unsigned groups = 1; ; groups++) {
+        unsigned channels = min(input_channels, make_multiple_of(word_size, (input_channels + groups - 1) / groups));
+        if (channels == group_channels)
+            continue;
+        group_channels = channels;
+        const bool split = group_channels < input_channels;
+        const bool last_try = group_channels <= word_size;
+
+        // the postprocessing registers cover max_output_channels, split input channels are postprocessed on the host
+        unsigned och_limit = output_channels;
+        if (!split && hwinfo.bias_requant_available && hwinfo.max_output_channels > 0)
+            och_limit = min<unsigned>(och_limit, hwinfo.max_output_channels);
+
+        // candidate output channel group sizes, as whole m0 kernel sets if possible to keep all pe rows busy in every pass
+        vector<unsigned> och_candidates;
+        for (unsigned count = och_limit; count > 0; count /= 2) {
+            unsigned aligned = count < output_channels && count >= m0 ? count / m0 * m0 : count;
+            if (och_candidates.empty() || och_candidates.back() != aligned)
+                och_candidates.push_back(aligned);
+        }
+
+        for (unsigned group_och : och_candidates) {
+            Conv2D group_op = op;
+            group_op.set_recacc_device(dev);
+            group_op.set_hwinfo(hwinfo);
+            group_op.set_channel_count(group_channels, group_och);
+            if (split) {
+                // postprocessing is done on the host after accumulating all groups
+                group_op.set_requantize(false);
+                group_op.set_activation_mode(act_none);
+            }
+
+            const bool smallest = last_try && group_och == och_candidates.back();
+            if (!fixed_tile_size && fits(group_op)) {
+                tiled = false;
+                tile_size = image_size;
+                tile_output_size = output_size;
+                tile_starts = {0};
+                tile_skips = {0};
+            } else if (plan_tiles(group_op) && (tile_output_size >= min_tile_output || fixed_tile_size || smallest)) {
+                tiled = true;
+            } else if (smallest) {
+                throw runtime_error("spad too small even for the smallest tile of " + op.get_parameter_string());
+            } else {
+                continue;
+            }
+
+            tile_op = group_op;
+            channel_groups.clear();
+            for (unsigned first = 0; first < input_channels; first += group_channels)
+                channel_groups.emplace_back(first, min(group_channels, input_channels - first));
+            output_channel_groups.clear();
+            for (unsigned first = 0; first < output_channels; first += group_och)
+                output_channel_groups.emplace_back(first, min(group_och, output_channels - first));
+            planned = true;
+            return;
+        }
+    }
+}
+
+bool TiledConv2D::is_tiled() const {
+    return tiled || channel_groups.size() > 1 || output_channel_groups.size() > 1;
+}
+
+unsigned TiledConv2D::get_tile_size() const {
+    return tile_size;
+}
+
+size_t TiledConv2D::get_tile_count() const {
+    return tile_starts.size() * tile_starts.size();
+}
+
+size_t TiledConv2D::get_channel_group_count() const {
+    return channel_groups.size();
+}
+
+size_t TiledConv2D::get_output_channel_group_count() const {
+    return output_channel_groups.size();
+}
+
+// copy the input channels of one tile including its halo to dst, everything outside the image is zero padding
+void TiledConv2D::gather_tile(const input_t* iact, unsigned first_channel, unsigned channels, unsigned start_x, unsigned start_y, input_t* dst) const {
+    const int x0 = static_cast<int>(start_x) - static_cast<int>(pad);
+    const int y0 = static_cast<int>(start_y) - static_cast<int>(pad);
+    const int x_begin = max(x0, 0);
+    const int x_end = min(x0 + static_cast<int>(tile_size), static_cast<int>(image_size));
+    const size_t tile_pixels = static_cast<size_t>(tile_size) * tile_size;
+
+    fill(dst, dst + channels * tile_pixels, 0);
+    if (x_begin >= x_end)
+        return;
+    for (unsigned ch = 0; ch < channels; ch++) {
+        for (unsigned ty = 0; ty < tile_size; ty++) {
+            const int y = y0 + static_cast<int>(ty);
+            if (y < 0 || y >= static_cast<int>(image_size))
+                continue;
+            const input_t* src = iact + (static_cast<size_t>(first_channel + ch) * image_size + y) * image_size + x_begin;
+            memcpy(dst + ch * tile_pixels + ty * tile_size + (x_begin - x0), src, x_end - x_begin);
+        }
+    }
+}
+
+// one accelerator run of an already configured op, returns false if the hardware timed out
+bool TiledConv2D::run_pass(Conv2D& op, const void* iact_buf, size_t iact_bytes, const void* wght_buf, size_t wght_bytes,
+        void* psum_buf, size_t psum_bytes, Conv2DResult& result) {
+    op.copy_data_in(iact_buf, iact_bytes, wght_buf, wght_bytes);
+    op.run_accelerator();
+
+    try {
+        bool success = op.wait_until_accelerator_done();
+        result.wait_latency_ns += op.get_wait_latency_ns();
+        if (!success) {
+            recacc_control_stop(dev);
+            result.success = false;
+            return false;
+        }
+        result.cycles += op.get_cycle_count();
+        op.copy_data_out(psum_buf, psum_bytes);
+    } catch (...) {
+        // leave the device ready for the next job
+        recacc_control_stop(dev);
+        throw;
+    }
+    return true;
+}
+
+template<typename T> static vector<T> slice(const vector<T>& values, size_t first, size_t count) {
+    if (first >= values.size())
+        return {};
+    return vector<T>(values.begin() + first, values.begin() + min(values.size(), first + count));
+}
+
+Conv2DResult TiledConv2D::run(const Conv2DJob& job) {
+    if (!planned)
+        plan(job.op);
+
+    auto [input_channels, output_channels] = job.op.get_channel_count();
+    auto [kernel_w, kernel_h] = job.op.get_kernel_size();
+    const bool split = channel_groups.size() > 1;
+    const bool split_och = output_channel_groups.size() > 1;
+    const bool staged = tiled || split; // results pass through tile_output instead of going to job.psum_buf directly
+    const size_t kernel_pixels = static_cast<size_t>(kernel_w) * kernel_h;
+    const size_t image_pixels = static_cast<size_t>(image_size) * image_size;
+    const size_t output_pixels = static_cast<size_t>(output_size) * output_size;
+    const size_t tile_pixels = static_cast<size_t>(tile_size) * tile_size;
+
+    Conv2D final_op = job.op;
+    final_op.set_hwinfo(hwinfo);
+    const size_t output_channel_bytes = final_op.get_output_channel_bytes();
+    const size_t output_pixel_bytes = output_channel_bytes / output_pixels;
+    const size_t copy_och_count = min<size_t>(output_channels, job.psum_bytes / output_channel_bytes);
+
+    if (staged && job.iact_bytes < input_channels * image_pixels)
+        throw runtime_error("iact buffer too small for a tiled convolution");
+    if ((split || split_och) && (job.wght_buf == nullptr || job.wght_bytes < output_channels * input_channels * kernel_pixels))
+        throw runtime_error("splitting channels requires the complete weights");
+
+    const input_t* iact = static_cast<const input_t*>(job.iact_buf);
+    const input_t* wght = static_cast<const input_t*>(job.wght_buf);
+    int8_t* output = static_cast<int8_t*>(job.psum_buf);
+
+    vector<psum_t> accumulated(split ? output_channels * output_pixels : 0, 0);
+    vector<input_t> tile_iact;
+    vector<int8_t> tile_output;
+
+    Conv2DResult result;
+    result.success = true;
+    for (auto [first_channel, channels] : channel_groups) {
+        // plan every output channel group of this input channel group, the iact region is the same for all of them
+        vector<Conv2D> ops;
+        vector<vector<input_t>> group_wght;
+        for (auto [first_och, och_count] : output_channel_groups) {
+            Conv2D& op = ops.emplace_back(tile_op);
+            op.set_channel_count(channels, och_count);
+            op.allocate_spad_auto();
+            op.compute_accelerator_parameters(true);
+
+            // the kernels of this group's input channels for the group's output channels
+            if (split) {
+                const size_t och_bytes = channels * kernel_pixels;
+                auto& buf = group_wght.emplace_back(make_multiple_of(8, och_count * och_bytes));
+                for (size_t och = 0; och < och_count; och++)
+                    memcpy(buf.data() + och * och_bytes, wght + ((first_och + och) * input_channels + first_channel) * kernel_pixels, och_bytes);
+            }
+        }
+
+        if (tiled)
+            tile_iact.resize(make_multiple_of(8, channels * tile_pixels));
+
+        bool first = true;
+        for (size_t iy = 0; iy < tile_starts.size(); iy++) {
+            for (size_t ix = 0; ix < tile_starts.size(); ix++) {
+                const unsigned start_x = tile_starts[ix], start_y = tile_starts[iy];
+                const void* iact_buf = job.iact_buf;
+                size_t iact_bytes = job.iact_bytes;
+
+                if (tiled) {
+                    gather_tile(iact, first_channel, channels, start_x, start_y, tile_iact.data());
+                    iact_buf = tile_iact.data();
+                    iact_bytes = tile_iact.size();
+                } else if (split) {
+                    iact_buf = iact + first_channel * image_pixels;
+                    iact_bytes = channels * image_pixels;
+                }
+
+                for (size_t g = 0; g < output_channel_groups.size(); g++) {
+                    auto [first_och, och_count] = output_channel_groups[g];
+                    Conv2D& op = ops[g];
+
+                    const void* wght_buf = nullptr;
+                    size_t wght_bytes = 0;
+                    if (split) {
+                        wght_buf = group_wght[g].data();
+                        wght_bytes = group_wght[g].size();
+                    } else if (job.wght_buf) {
+                        const size_t offset = first_och * input_channels * kernel_pixels;
+                        wght_buf = wght + offset;
+                        wght_bytes = job.wght_bytes > offset ? min(job.wght_bytes - offset, och_count * input_channels * kernel_pixels) : 0;
+                    }
+
+                    const size_t tile_channel_bytes = op.get_output_channel_bytes();
+                    const size_t tile_pixel_bytes = tile_channel_bytes / (static_cast<size_t>(tile_output_size) * tile_output_size);
+                    void* psum_buf;
+                    size_t psum_bytes;
+                    if (staged) {
+                        tile_output.resize(och_count * tile_channel_bytes);
+                        psum_buf = tile_output.data();
+                        psum_bytes = tile_output.size();
+                    } else {
+                        // output channels are contiguous in the output tensor
+                        psum_buf = output + first_och * output_channel_bytes;
+                        psum_bytes = first_och < copy_och_count ? (min<size_t>(copy_och_count, first_och + och_count) - first_och) * output_channel_bytes : 0;
+                    }
+
+                    op.configure_accelerator();
+                    if (first || split_och) {
+                        if (split)
+                            op.set_postproc_data({}, {}, {});
+                        else
+                            op.set_postproc_data(slice(job.bias, first_och, och_count), slice(job.factors, first_och, och_count),
+                                slice(job.zeropoints, first_och, och_count));
+                    }
+
+                    // the tile's iact stays resident for all output channel groups,
+                    // the weights only need to be written again if they were replaced by another group
+                    if (!run_pass(op, g == 0 ? iact_buf : nullptr, g == 0 ? iact_bytes : 0,
+                            first || split_och ? wght_buf : nullptr, first || split_och ? wght_bytes : 0,
+                            psum_buf, psum_bytes, result))
+                        return result;
+
+                    if (!staged)
+                        continue;
+
+                    // stitch the tile output into the full output tensor or add it to the accumulated psums
+                    const unsigned skip_x = tile_skips[ix], skip_y = tile_skips[iy];
+                    const size_t row_pixels = tile_output_size - skip_x;
+                    for (size_t och = 0; och < och_count; och++) {
+                        if (!split && first_och + och >= copy_och_count)
+                            break;
+                        for (unsigned ty = skip_y; ty < tile_output_size; ty++) {
+                            const int8_t* src = tile_output.data() + och * tile_channel_bytes + (ty * tile_output_size + skip_x) * tile_pixel_bytes;
+                            const size_t dst_pixel = ((first_och + och) * output_size + start_y + ty) * output_size + start_x + skip_x;
+                            if (split)
+                                psum_accumulate(accumulated.data() + dst_pixel, reinterpret_cast<const psum_t*>(src), row_pixels);
+                            else
+                                memcpy(output + dst_pixel * output_pixel_bytes, src, row_pixels * output_pixel_bytes);
+                        }
+                    }
+                }
+                first = false;
+            }
+        }
+    }
+
+    if (split) {
+        const bool relu = job.op.get_activation_mode() == act_relu;
+        const bool requantize = job.op.get_requantize();
+        for (size_t och = 0; och < copy_och_count; och++) {
+            psum_postprocess(accumulated.data() + och * output_pixels, output + och * output_channel_bytes, output_pixels,
+                och < job.bias.size() ? job.bias[och] : 0, relu, requantize,
+                och < job.factors.size() ? job.factors[och] : 0.0f,
+                och < job.zeropoints.size() ? job.zeropoints[och] : 0.0f);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "conv2d.hpp"
+#include "executor.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// runs a convolution of any size on one device by splitting it into parts that fit the scratchpad
+//
+// spatial tiles: the hardware only supports square images, so tiles are square as well and overlap by
+// kernel size - 1 (the halo). tiles are gathered on the host with the same-size padding already applied and
+// run without hardware padding, so tiles at the image border see exactly the zeros the hardware would have inserted.
+//
+// input channel groups: if iact and weights of all input channels only fit with tiles smaller than one pass of
+// the pe array, the input channels are split into groups. groups run without bias, activation and requantization,
+// their raw psums are accumulated on the host and postprocessed afterwards (see psum.hpp).
+//
+// output channel groups: the postprocessing registers only cover hwinfo.max_output_channels, and the psum region
+// shrinks the tiles for many output channels. output channels are then split into groups of whole m0 kernel sets,
+// the input activations of a tile stay resident while the weights and postprocessing registers of each group are
+// streamed in.
+//
+// with a single output channel group all tiles share one configuration and the weights are written only once.
+class TiledConv2D {
+public:
+    TiledConv2D(recacc_device* dev, const recacc_hwinfo& hwinfo);
+
+    // use this input tile size instead of the largest one that fits, 0 restores automatic selection
+    void set_tile_size(unsigned size);
+
+    // choose tiles and channel groups for op, throws if nothing fits the scratchpad
+    void plan(const Conv2D& op);
+    bool is_tiled() const; // true if split spatially or by input or output channel
+    unsigned get_tile_size() const;
+    size_t get_tile_count() const;
+    size_t get_channel_group_count() const;
+    size_t get_output_channel_group_count() const;
+
+    // run the planned parts for job (job.op is planned first if plan was not called),
+    // the output lands in job.psum_buf in the same dense CHW layout as with Conv2D::copy_data_out
+    // iact and wght must be dense CHW / OIHW, the transfer engine of job.op is not used for tiles
+    Conv2DResult run(const Conv2DJob& job);
+
+private:
+    bool fits(Conv2D op) const;
+    bool plan_tiles(Conv2D& op);
+    void gather_tile(const input_t* iact, unsigned first_channel, unsigned channels, unsigned start_x, unsigned start_y, input_t* dst) const;
+    bool run_pass(Conv2D& op, const void* iact_buf, size_t iact_bytes, const void* wght_buf, size_t wght_bytes,
+        void* psum_buf, size_t psum_bytes, Conv2DResult& result);
+
+    recacc_device* dev;
+    recacc_hwinfo hwinfo;
+    unsigned fixed_tile_size = 0;
+
+    bool planned = false;
+    bool tiled = false;               // spatially tiled
+    Conv2D tile_op;                   // operation of a single tile (the whole layer if not tiled)
+    unsigned image_size = 0;
+    unsigned output_size = 0;
+    unsigned tile_size = 0;           // input edge length of a tile including the halo
+    unsigned tile_output_size = 0;
+    unsigned pad = 0;                 // zero padding on the top/left edge of the image
+    std::vector<unsigned> tile_starts; // output row/column of each tile along one axis
+    std::vector<unsigned> tile_skips;  // leading outputs of each tile already covered by the previous one
+    std::vector<std::pair<unsigned, unsigned>> channel_groups; // first input channel and channel count
+    std::vector<std::pair<unsigned, unsigned>> output_channel_groups; // first output channel and channel count
+};
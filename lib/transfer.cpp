@@ -0,0 +1,126 @@
+#include "transfer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "spadcopy.hpp"
+
+using namespace std;
+
+CpuTransferEngine::CpuTransferEngine(recacc_device* dev) : dev(dev) {}
+
+recacc_device* CpuTransferEngine::get_device() const {
+    return dev;
+}
+
+void CpuTransferEngine::copy_in(size_t spad_offset, const void* src, size_t bytes) {
+    queue.push_back({src, static_cast<uint8_t*>(recacc_get_buffer(dev)) + spad_offset, bytes, false});
+}
+
+void CpuTransferEngine::copy_out(void* dst, size_t spad_offset, size_t bytes) {
+    queue.push_back({static_cast<uint8_t*>(recacc_get_buffer(dev)) + spad_offset, dst, bytes, true});
+}
+
+void CpuTransferEngine::zero(size_t spad_offset, size_t bytes) {
+    queue.push_back({nullptr, static_cast<uint8_t*>(recacc_get_buffer(dev)) + spad_offset, bytes, false});
+}
+
+void CpuTransferEngine::start() {
+    for (const Transfer& t : queue) {
+        if (t.from_spad)
+            spad_copy_out(t.dst, t.src, t.bytes);
+        else if (t.src)
+            spad_copy_in(t.dst, t.src, t.bytes, t.bytes);
+        else
+            spad_zero(t.dst, t.bytes);
+    }
+    queue.clear();
+}
+
+bool CpuTransferEngine::busy() {
+    return false;
+}
+
+bool CpuTransferEngine::wait() {
+    // transfers queued but never started are executed now
+    start();
+    return true;
+}
+
+CdmaTransferEngine::CdmaTransferEngine(recacc_device* dev, recacc_cdma* cdma, const recacc_dma_buffer* host_mem)
+    : dev(dev), cdma(cdma), host_mem(host_mem) {}
+
+recacc_device* CdmaTransferEngine::get_device() const {
+    return dev;
+}
+
+uint64_t CdmaTransferEngine::host_addr(const void* ptr, size_t bytes) const {
+    uint64_t addr = recacc_dma_buffer_phys(host_mem, ptr, bytes);
+    if (addr == 0)
+        throw runtime_error("host buffer for dma transfer is not within the dma buffer");
+    return addr;
+}
+
+void CdmaTransferEngine::add(uint64_t src, uint64_t dst, size_t bytes) {
+    int ret = recacc_cdma_chain_add(cdma, src, dst, bytes);
+    if (ret == ENOSPC) {
+        // descriptor memory exhausted: run what was queued so far and continue with a fresh chain
+        if (recacc_cdma_chain_length(cdma) == 0)
+            throw runtime_error("no cdma descriptor memory available");
+        failed |= !wait();
+        ret = recacc_cdma_chain_add(cdma, src, dst, bytes);
+    }
+    if (ret)
+        throw runtime_error("failed to queue cdma transfer: " + string(strerror(ret)));
+}
+
+void CdmaTransferEngine::copy_in(size_t spad_offset, const void* src, size_t bytes) {
+    add(host_addr(src, bytes), recacc_cdma_spad_addr(cdma, spad_offset), bytes);
+}
+
+void CdmaTransferEngine::copy_out(void* dst, size_t spad_offset, size_t bytes) {
+    add(recacc_cdma_spad_addr(cdma, spad_offset), host_addr(dst, bytes), bytes);
+}
+
+void CdmaTransferEngine::zero(size_t spad_offset, size_t bytes) {
+    zero_fills.emplace_back(spad_offset, bytes);
+}
+
+void CdmaTransferEngine::start() {
+    uint8_t* spad = static_cast<uint8_t*>(recacc_get_buffer(dev));
+    for (auto [offset, bytes] : zero_fills)
+        spad_zero(spad + offset, bytes);
+    zero_fills.clear();
+
+    if (recacc_cdma_chain_length(cdma))
+        chain_length = recacc_cdma_chain_length(cdma);
+    int ret = recacc_cdma_start(cdma);
+    if (ret)
+        throw runtime_error("failed to start cdma transfer: " + string(strerror(ret)));
+}
+
+bool CdmaTransferEngine::busy() {
+    return recacc_cdma_busy(cdma);
+}
+
+bool CdmaTransferEngine::wait() {
+    // transfers queued but never started are executed now
+    if (!cdma->busy)
+        start();
+
+    int ret = recacc_cdma_wait(cdma, POLL_TIMEOUT_US);
+    recacc_cdma_chain_clear(cdma);
+
+    // zero fills queued while the chain was running
+    if (!zero_fills.empty())
+        start();
+
+    bool ok = ret == 0 && !failed;
+    failed = false;
+    return ok;
+}
+
+size_t CdmaTransferEngine::get_chain_length() const {
+    return chain_length;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+extern "C" {
+    #include <driver.h>
+}
+
+// moves data between host memory and the scratchpad of one device
+// transfers are queued by copy_in, copy_out and zero, start() executes them (asynchronously if the
+// engine supports it) and wait() blocks until all of them completed. queued regions must not overlap.
+class TransferEngine {
+public:
+    virtual ~TransferEngine() = default;
+
+    // the device whose scratchpad the transfers address
+    virtual recacc_device* get_device() const = 0;
+
+    virtual void copy_in(size_t spad_offset, const void* src, size_t bytes) = 0;
+    virtual void copy_out(void* dst, size_t spad_offset, size_t bytes) = 0;
+    virtual void zero(size_t spad_offset, size_t bytes) = 0;
+
+    virtual void start() = 0;
+    virtual bool busy() = 0;
+    // returns false if a transfer failed, the queue is empty afterwards in any case
+    virtual bool wait() = 0;
+};
+
+// fallback using cpu copies, works with any host buffer
+// everything is copied synchronously by start()
+class CpuTransferEngine : public TransferEngine {
+public:
+    explicit CpuTransferEngine(recacc_device* dev);
+
+    recacc_device* get_device() const override;
+    void copy_in(size_t spad_offset, const void* src, size_t bytes) override;
+    void copy_out(void* dst, size_t spad_offset, size_t bytes) override;
+    void zero(size_t spad_offset, size_t bytes) override;
+
+    void start() override;
+    bool busy() override;
+    bool wait() override;
+
+private:
+    struct Transfer {
+        const void* src;
+        void* dst;
+        size_t bytes;
+        bool from_spad;
+    };
+
+    recacc_device* dev;
+    std::vector<Transfer> queue;
+};
+
+// scatter-gather transfers by the AXI CDMA (or its register model), host buffers must lie within host_mem
+// zero fills are done by the cpu when starting, as there is no zero source in the scratchpad
+class CdmaTransferEngine : public TransferEngine {
+public:
+    CdmaTransferEngine(recacc_device* dev, recacc_cdma* cdma, const recacc_dma_buffer* host_mem);
+
+    recacc_device* get_device() const override;
+    void copy_in(size_t spad_offset, const void* src, size_t bytes) override;
+    void copy_out(void* dst, size_t spad_offset, size_t bytes) override;
+    void zero(size_t spad_offset, size_t bytes) override;
+
+    void start() override;
+    bool busy() override;
+    bool wait() override;
+
+    // descriptors used by the last started chain
+    size_t get_chain_length() const;
+
+private:
+    void add(uint64_t src, uint64_t dst, size_t bytes);
+    uint64_t host_addr(const void* ptr, size_t bytes) const;
+
+    recacc_device* dev;
+    recacc_cdma* cdma;
+    const recacc_dma_buffer* host_mem;
+    std::vector<std::pair<size_t, size_t>> zero_fills;
+    size_t chain_length = 0;
+    bool failed = false;
+};
@@ -0,0 +1,111 @@
+#include "weightcache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+using namespace std;
+
+WeightCache::WeightCache(const recacc_hwinfo& hwinfo) : column_size(hwinfo.spad_size / hwinfo.spad_word_size / 8 * 8) {}
+
+// 64 bit multiply-xorshift hash over 8 byte words, fast enough to be negligible against the scratchpad writes it saves
+uint64_t WeightCache::hash(const void* buf, size_t bytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(buf);
+    uint64_t h = 0x243f6a8885a308d3ULL ^ bytes;
+    size_t n = 0;
+    for (; n + 8 <= bytes; n += 8) {
+        uint64_t w;
+        memcpy(&w, p + n, sizeof(w));
+        h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + n, bytes - n);
+    h = (h ^ tail) * 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 32);
+}
+
+// highest free range of size bytes between low and the column end, entries are not overlapping
+bool WeightCache::find_gap(unsigned low, unsigned size, unsigned& offset) const {
+    vector<pair<unsigned, unsigned>> used;
+    for (const Entry& e : entries)
+        used.emplace_back(e.offset, e.offset + e.size);
+    sort(used.begin(), used.end(), greater<>());
+
+    unsigned end = column_size;
+    for (auto [begin, entry_end] : used) {
+        if (entry_end <= end && end - entry_end >= size && end - size >= low) {
+            offset = end - size;
+            return true;
+        }
+        end = min(end, begin);
+    }
+    if (end >= low && end - low >= size) {
+        offset = end - size;
+        return true;
+    }
+    return false;
+}
+
+bool WeightCache::place(Conv2D& op, const void* wght_buf, size_t wght_bytes) {
+    auto [input_channels, output_channels] = op.get_channel_count();
+    const unsigned kernel_size = get<0>(op.get_kernel_size());
+    const unsigned size = op.get_wght_column_bytes();
+    const unsigned low = op.get_data_column_bytes();
+
+    if (wght_buf == nullptr || low + size > column_size) {
+        // the greedy layout may still fit by sharing padding space, but it overwrites everything resident
+        invalidate();
+        op.allocate_spad_auto();
+        return false;
+    }
+
+    // iact and psum of this operation overwrite everything below low
+    auto evicted = remove_if(entries.begin(), entries.end(), [&](const Entry& e) { return e.offset < low; });
+    stats.evictions += entries.end() - evicted;
+    entries.erase(evicted, entries.end());
+
+    const uint64_t key = hash(wght_buf, wght_bytes);
+    tick++;
+    for (Entry& e : entries) {
+        if (e.hash == key && e.wght_bytes == wght_bytes && e.input_channels == input_channels &&
+                e.output_channels == output_channels && e.kernel_size == kernel_size) {
+            if (memcmp(e.wght.data(), wght_buf, wght_bytes) != 0) {
+                stats.collisions++;
+                continue;
+            }
+            e.last_use = tick;
+            op.allocate_spad_wght_at(e.offset);
+            stats.hits++;
+            stats.bytes_skipped += wght_bytes;
+            return true;
+        }
+    }
+
+    unsigned offset;
+    while (!find_gap(low, size, offset)) {
+        // fits into an empty column, so there is always something left to evict
+        auto lru = min_element(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.last_use < b.last_use; });
+        entries.erase(lru);
+        stats.evictions++;
+    }
+
+    const uint8_t* wght = static_cast<const uint8_t*>(wght_buf);
+    entries.push_back({key, wght_bytes, input_channels, output_channels, kernel_size, offset, size, tick,
+        vector<uint8_t>(wght, wght + wght_bytes)});
+    op.allocate_spad_wght_at(offset);
+    stats.misses++;
+    return false;
+}
+
+void WeightCache::invalidate() {
+    entries.clear();
+}
+
+size_t WeightCache::get_resident_count() const {
+    return entries.size();
+}
+
+WeightCache::Stats WeightCache::get_stats() const {
+    return stats;
+}
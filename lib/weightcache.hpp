@@ -0,0 +1,64 @@
+#pragma once
+
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "conv2d.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+// tracks which weight tensors are resident in the scratchpad of one device
+//
+// resident weights are stacked from the end of every scratchpad column downwards, iact, padding and psum of each
+// operation are placed from the column start. weight sets overlapping the space needed by an operation's
+// iact and psum, or needed for new weights, are evicted least recently used first.
+// weight sets are looked up by a 64 bit hash of their content and the layer shape that defines their layout,
+// a host copy of every resident set is compared on a hit so a hash collision can never skip the upload.
+class WeightCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t collisions = 0;    // hash and shape matched but the content differed
+        uint64_t bytes_skipped = 0; // weight bytes not copied in because of hits
+    };
+
+    WeightCache(const recacc_hwinfo& hwinfo);
+
+    // allocate the scratchpad for op with its weights placed by the cache
+    // returns true if identical weights are already resident and the weight upload can be skipped
+    // op must fit the scratchpad untiled, falls back to allocate_spad_auto (and forgets all entries) if
+    // iact and psum leave no room for the weights at the column end
+    bool place(Conv2D& op, const void* wght_buf, size_t wght_bytes);
+
+    // the scratchpad was used by something else, nothing is resident anymore
+    void invalidate();
+
+    size_t get_resident_count() const;
+    Stats get_stats() const;
+
+    static uint64_t hash(const void* buf, size_t bytes);
+
+private:
+    struct Entry {
+        uint64_t hash;
+        size_t wght_bytes;
+        unsigned input_channels, output_channels, kernel_size;
+        unsigned offset; // column offset of the kernel sets
+        unsigned size;   // bytes per column
+        uint64_t last_use;
+        std::vector<uint8_t> wght; // host copy of the weights as copied in
+    };
+
+    bool find_gap(unsigned low, unsigned size, unsigned& offset) const;
+
+    unsigned column_size;
+    std::vector<Entry> entries;
+    uint64_t tick = 0;
+    Stats stats;
+};
@@ -0,0 +1,193 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/conv2dtest.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    unsigned image_size = 32, kernel_size = 3, input_channels = 8, output_channels = 3;
+    unsigned batch_size = 8;
+    enum activation_mode act_mode = act_none;
+    bool requantize = false;
+    bool padding = false;
+    bool verbose = false;
+    string device_name(DEFAULT_DEVICE);
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:s:c:k:u:rpa:b:v")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-s 32: width & height of the input image" << endl;
+                cout << "-k 3: width & height of the kernels" << endl;
+                cout << "-c 8: number of input channels" << endl;
+                cout << "-u 3: number of output channels" << endl;
+                cout << "-r: enable requantization" << endl;
+                cout << "-p: enable same size padding" << endl;
+                cout << "-a relu: enable activation (available: relu)" << endl;
+                cout << "-b 8: number of images in the batch" << endl;
+                cout << "-v: print the timings of every image" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 's':
+                image_size = atoi(optarg);
+                break;
+            case 'k':
+                kernel_size = atoi(optarg);
+                break;
+            case 'c':
+                input_channels = atoi(optarg);
+                break;
+            case 'u':
+                output_channels = atoi(optarg);
+                break;
+            case 'r':
+                requantize = true;
+                break;
+            case 'p':
+                padding = true;
+                break;
+            case 'a':
+                if (strcmp(optarg, "relu") == 0)
+                    act_mode = act_relu;
+                else {
+                    cerr << "Unknown activation mode " << string(optarg) << endl;
+                    return 1;
+                }
+                break;
+            case 'b':
+                batch_size = atoi(optarg);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    int ret = open_test_device(&dev, device_name);
+    if (ret)
+        return ret;
+
+    Conv2D op(image_size, kernel_size, input_channels, output_channels, requantize);
+    op.set_padding_mode(padding);
+    op.set_activation_mode(act_mode);
+    op.set_recacc_device(&dev);
+    op.set_wait_mode(wait_adaptive);
+
+    const size_t result_bytes = op.get_output_channel_bytes() * output_channels;
+    Conv2DTestData data(op, batch_size);
+
+    vector<const void*> iact_bufs;
+    vector<void*> psum_bufs;
+    vector<vector<int8_t>> results(batch_size, vector<int8_t>(result_bytes));
+    for (unsigned n = 0; n < batch_size; n++) {
+        iact_bufs.push_back(data.iact[n].data());
+        psum_bufs.push_back(results[n].data());
+    }
+
+    Conv2DBatchResult batch;
+    chrono::duration<float, std::micro> duration_single;
+    try {
+        op.allocate_spad_auto();
+        op.compute_accelerator_parameters(true);
+
+        // one image after another with the complete sequence, as without run_batch
+        auto t1 = timer::now();
+        for (unsigned n = 0; n < batch_size; n++) {
+            op.compute_accelerator_parameters(true);
+            op.configure_accelerator();
+            op.set_postproc_data(data.bias, data.factors, data.zeropoints);
+            op.copy_data_in(iact_bufs[n], data.iact[n].size(), data.wght.data(), data.wght.size());
+            op.run_accelerator();
+            if (!op.wait_until_accelerator_done()) {
+                recacc_control_stop(&dev);
+                throw runtime_error("accelerator timed out");
+            }
+            op.copy_data_out(psum_bufs[n], result_bytes);
+        }
+        duration_single = timer::now() - t1;
+
+        for (auto& result : results)
+            fill(result.begin(), result.end(), 0);
+        batch = op.run_batch(iact_bufs, data.iact[0].size(), data.wght.data(), data.wght.size(), psum_bufs, result_bytes,
+            data.bias, data.factors, data.zeropoints);
+    } catch (const exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        recacc_close(&dev);
+        return 1;
+    }
+    recacc_close(&dev);
+
+    if (!batch.success) {
+        cerr << "ERROR: accelerator timed out" << endl;
+        return 1;
+    }
+
+    size_t failed = 0;
+    for (unsigned n = 0; n < batch_size; n++) {
+        const size_t incorrect = data.count_incorrect(op, results[n].data(), n);
+        if (incorrect) {
+            cerr << "image " << n << ": " << incorrect << " values INCORRECT" << endl;
+            failed++;
+        }
+    }
+
+    if (verbose) {
+        VariadicTable<int, float, float, float, unsigned> vt({"image", "copy-in us", "run us", "copy-out us", "cycles"}, 10);
+        for (size_t n = 0; n < batch.images.size(); n++) {
+            const Conv2DImageTiming& t = batch.images[n];
+            vt.addRow(n, t.copy_in.count(), t.run.count(), t.copy_out.count(), t.cycles);
+        }
+        vt.print(cout);
+    }
+
+    chrono::duration<float, std::micro> copy_in{0}, run{0}, copy_out{0};
+    for (const Conv2DImageTiming& t : batch.images) {
+        copy_in += t.copy_in;
+        run += t.run;
+        copy_out += t.copy_out;
+    }
+    const float hw_rate = batch_size / (1.0f * batch.cycles / RECACC_ARRAY_CLK_MHZ) * 1e6;
+    auto share = [&](chrono::duration<float, std::micro> t) { return 100.0f * t.count() / batch.total.count(); };
+
+    // batching saves the configuration and the weight copy per image. double buffered, the copy-in of the next and
+    // the copy-out of the previous image overlap the run, so the shares add up to more than 100%. in simulation the
+    // run is the software model, so neither rate comes close to the one the cycle counts allow on hardware
+    cout << op.get_parameter_string() << ", batch of " << batch_size << (batch.double_buffered ? ", double buffered" : ", one region") << endl;
+    cout << "setup " << batch.setup.count() << "us, per image copy-in " << copy_in.count() / batch_size << "us, run "
+         << run.count() / batch_size << "us, copy-out " << copy_out.count() / batch_size << "us" << endl;
+    cout << "batch time: " << share(batch.setup) << "% setup, " << share(copy_in) << "% copy-in, " << share(run) << "% run, "
+         << share(copy_out) << "% copy-out" << endl;
+    cout << "batched " << batch_size / batch.total.count() * 1e6 << " images/s, one by one " << batch_size / duration_single.count() * 1e6
+         << " images/s, cycle count bound " << hw_rate << " images/s @" << RECACC_ARRAY_CLK_MHZ << "MHz" << endl;
+    cout << batch_size - failed << "/" << batch_size << " images CORRECT" << endl;
+
+    return failed ? 1 : 0;
+}
@@ -13,6 +13,7 @@
 
 #include "driver/defs.h"
 #include "lib/conv2d.hpp"
+#include "lib/spadcopy.hpp"
 
 extern "C" {
     #include "driver/driver.h"
@@ -79,6 +80,51 @@ public:
         verify("iact", spad_addr, buf, hwinfo.spad_size);
     }
 
+    // round trip through spad_copy_in and spad_copy_out at random offsets and lengths, with the given copy mode
+    void test_copy_kernels(enum spad_copy_mode mode) {
+        const enum spad_copy_mode previous = get_spad_copy_mode();
+        set_spad_copy_mode(mode);
+        const string name = mode == spad_copy_aligned ? string("aligned (") + spad_copy_isa() + ")" : "plain";
+
+        uint8_t* spad_addr = static_cast<uint8_t*>(recacc_get_buffer(dev));
+        const size_t max_bytes = min<size_t>(hwinfo.spad_size / 2, 4096);
+        vector<int8_t> readback(max_bytes + 64);
+        unsigned mismatches = 0;
+        for (unsigned n = 0; n < 1000; n++) {
+            size_t bytes_total = mtrnd() % max_bytes + 1;
+            size_t bytes = mtrnd() % (bytes_total + 1);
+            size_t dst_offset = mtrnd() % 64;
+            size_t src_offset = mtrnd() % 64;
+            size_t out_offset = mtrnd() % 64;
+
+            // a guard byte behind bytes_total must not be touched
+            memset(spad_addr, 0x5a, dst_offset + bytes_total + 1);
+            spad_copy_in(spad_addr + dst_offset, buf + src_offset, bytes, bytes_total);
+            spad_copy_out(readback.data() + out_offset, spad_addr + dst_offset, bytes_total + 1);
+
+            const int8_t* out = readback.data() + out_offset;
+            bool ok = memcmp(out, buf + src_offset, bytes) == 0;
+            for (size_t i = bytes; i < bytes_total; i++)
+                ok = ok && out[i] == 0;
+            ok = ok && static_cast<uint8_t>(out[bytes_total]) == 0x5a;
+            if (!ok && !mismatches++)
+                cout << "ERROR: " << name << " copy of " << bytes << " of " << bytes_total << " bytes, src offset " << src_offset
+                     << " dst offset " << dst_offset << " out offset " << out_offset << " differs" << endl;
+        }
+
+        if (mismatches) {
+            cout << "ERROR: " << name << " copy kernels failed " << mismatches << " of 1000 round trips" << endl;
+            failed = true;
+        } else {
+            cout << "SUCCESS: " << name << " copy kernel test ok" << endl;
+        }
+        set_spad_copy_mode(previous);
+    }
+
+    bool has_failed() const {
+        return failed;
+    }
+
     void verify(const string& name, void* src, int8_t* reference, size_t size) {
         int8_t* buf_test = new int8_t[size];
 
@@ -95,6 +141,7 @@ public:
             print_buffer(reference, size);
             cout << "Got:" << endl;
             print_buffer(buf_test, size);
+            failed = true;
         } else {
             cout << "SUCCESS: " << name << " buffer test ok" << endl;
         }
@@ -107,12 +154,13 @@ private:
     recacc_device* dev;
 
     int8_t* buf;
+    bool failed = false;
 };
 
 int main(int argc, char** argv) {
     string device_name(DEFAULT_DEVICE);
     if (argc > 1)
-        device_name = string(*argv);
+        device_name = string(argv[1]);
 
     recacc_device dev;
     int ret = recacc_open(&dev, device_name.c_str());
@@ -139,7 +187,9 @@ int main(int argc, char** argv) {
     Conv2DTest c2d(&dev);
     c2d.prepare_data();
     c2d.test_buffers();
+    c2d.test_copy_kernels(spad_copy_plain);
+    c2d.test_copy_kernels(spad_copy_aligned);
 
     ret = recacc_close(&dev);
-    return ret;
+    return ret ? ret : c2d.has_failed();
 }
@@ -0,0 +1,285 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/conv2d_cpu.hpp"
+#include "lib/hosttensor.hpp"
+#include "lib/transfer.hpp"
+#include "lib/utils.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+#define DEFAULT_CDMA   "/dev/uio5"
+#define DEFAULT_BUFFER "/dev/udmabuf0"
+#define SIM_BUFFER_SIZE (4 << 20)
+#define DESC_MEM_SIZE   (64 << 10)
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+// queue column-strided copies like Conv2D does and check the scratchpad and a copy back to host memory
+static bool test_descriptor_chain(recacc_device* dev, recacc_cdma* cdma, const recacc_dma_buffer* data) {
+    const size_t columns = 8, column_bytes = 1000, column_stride = 64 << 10, spad_offset = 24;
+    uint8_t* src = static_cast<uint8_t*>(data->virt);
+    uint8_t* back = src + columns * column_bytes;
+    generate_random_data<int8_t>(reinterpret_cast<int8_t*>(src), columns * column_bytes);
+    fill_n(back, columns * column_bytes, 0);
+
+    recacc_cdma_chain_clear(cdma);
+    for (size_t col = 0; col < columns; col++) {
+        // split every column in three parts, which must be merged into a single descriptor again
+        const size_t parts[] = {1, 499, column_bytes - 500};
+        size_t done = 0;
+        for (size_t part : parts) {
+            recacc_cdma_chain_add(cdma, recacc_dma_buffer_phys(data, src + col * column_bytes + done, part),
+                recacc_cdma_spad_addr(cdma, spad_offset + col * column_stride + done), part);
+            done += part;
+        }
+    }
+
+    bool ok = true;
+    if (recacc_cdma_chain_length(cdma) != columns) {
+        cerr << "chain has " << recacc_cdma_chain_length(cdma) << " descriptors, expected " << columns << endl;
+        ok = false;
+    }
+
+    recacc_cdma_start(cdma);
+    if (recacc_cdma_wait(cdma, POLL_TIMEOUT_US)) {
+        cerr << "copy-in chain did not complete" << endl;
+        return false;
+    }
+
+    const uint8_t* spad = static_cast<const uint8_t*>(recacc_get_buffer(dev));
+    for (size_t col = 0; col < columns; col++)
+        if (memcmp(spad + spad_offset + col * column_stride, src + col * column_bytes, column_bytes)) {
+            cerr << "scratchpad column " << col << " differs" << endl;
+            ok = false;
+        }
+
+    recacc_cdma_chain_clear(cdma);
+    for (size_t col = 0; col < columns; col++)
+        recacc_cdma_chain_add(cdma, recacc_cdma_spad_addr(cdma, spad_offset + col * column_stride),
+            recacc_dma_buffer_phys(data, back + col * column_bytes, column_bytes), column_bytes);
+    recacc_cdma_start(cdma);
+    if (recacc_cdma_wait(cdma, POLL_TIMEOUT_US) || memcmp(src, back, columns * column_bytes)) {
+        cerr << "copy-out chain returned wrong data" << endl;
+        ok = false;
+    }
+    recacc_cdma_chain_clear(cdma);
+
+    // the register model rejects addresses outside the scratchpad window, the engine must stay usable afterwards
+    if (cdma->model) {
+        recacc_cdma_chain_add(cdma, recacc_cdma_spad_addr(cdma, RECACC_MEM_OFFSET_REGS), recacc_dma_buffer_phys(data, back, 8), 8);
+        recacc_cdma_start(cdma);
+        if (recacc_cdma_wait(cdma, POLL_TIMEOUT_US) != EIO) {
+            cerr << "transfer from the register window did not fail" << endl;
+            ok = false;
+        }
+        recacc_cdma_chain_clear(cdma);
+    }
+
+    return ok;
+}
+
+// run op once with direct cpu copies and once through engine, compare both with the cpu reference
+static bool test_conv2d(recacc_device* dev, TransferEngine& engine, const recacc_dma_buffer* data,
+        unsigned image_size, unsigned kernel_size, unsigned input_channels, unsigned output_channels, unsigned repetitions) {
+    Conv2D op(image_size, kernel_size, input_channels, output_channels);
+    op.set_recacc_device(dev);
+    op.set_wait_mode(wait_adaptive);
+    op.allocate_spad_auto();
+    op.compute_accelerator_parameters(true);
+
+    auto [output_w, output_h] = op.get_output_size();
+    const size_t num_iact = image_size * image_size * input_channels;
+    const size_t num_wght = kernel_size * kernel_size * input_channels * output_channels;
+    const size_t num_result = output_w * output_h * output_channels;
+    const size_t result_bytes = op.get_output_channel_bytes() * output_channels;
+
+    // all host buffers of the dma run live in the pinned buffer
+    input_t* iact = static_cast<input_t*>(data->virt);
+    input_t* wght = iact + make_multiple_of(64, num_iact);
+    int8_t* result_dma = reinterpret_cast<int8_t*>(wght + make_multiple_of(64, num_wght));
+    // the result again with rows padded by 4 elements, written row by row by the engine
+    const unsigned pitch = output_w + 4;
+    psum_t* pitched = reinterpret_cast<psum_t*>(result_dma + make_multiple_of(64, result_bytes));
+    if (reinterpret_cast<uint8_t*>(pitched + output_channels * output_h * pitch) > static_cast<uint8_t*>(data->virt) + data->size)
+        throw runtime_error("dma buffer too small for this layer");
+    generate_random_data<input_t>(iact, num_iact);
+    generate_random_data<input_t>(wght, num_wght);
+    vector<int8_t> result_cpu(result_bytes);
+
+    vector<psum_t> bias(output_channels, 0), reference(num_result);
+    vector<float> scale(output_channels, 1.0), zeropoint(output_channels, 0.0);
+    conv2d_cpu<input_t, psum_t>(iact, wght, bias.data(), reference.data(),
+        input_channels, image_size, image_size, output_channels, kernel_size, kernel_size, 1, 1, 0, 0);
+
+    chrono::duration<float, std::micro> copy_in[2] = {}, copy_out[2] = {};
+    bool ok = true;
+    for (int use_engine = 0; use_engine < 2; use_engine++) {
+        op.set_transfer_engine(use_engine ? &engine : nullptr);
+        int8_t* result = use_engine ? result_dma : result_cpu.data();
+        for (unsigned rep = 0; rep < repetitions; rep++) {
+            recacc_reset(dev);
+            op.configure_accelerator();
+            op.set_postproc_data(bias, scale, zeropoint);
+
+            auto t1 = timer::now();
+            op.copy_data_in(iact, num_iact, wght, num_wght);
+            if (use_engine)
+                ok &= engine.wait(); // include the transfer time, run_accelerator would wait anyway
+            copy_in[use_engine] += timer::now() - t1;
+
+            op.run_accelerator();
+            if (!op.wait_until_accelerator_done())
+                return false;
+
+            t1 = timer::now();
+            op.copy_data_out(result, result_bytes);
+            copy_out[use_engine] += timer::now() - t1;
+        }
+
+        size_t incorrect, deviations;
+        compare_buffers<psum_t>(reinterpret_cast<psum_t*>(result), reference.data(), num_result, 0, incorrect, deviations, nullptr);
+        cout << (use_engine ? "engine" : "direct") << ": " << (incorrect ? "INCORRECT" : "CORRECT")
+             << ", copy in " << copy_in[use_engine].count() / repetitions << "us"
+             << ", copy out " << copy_out[use_engine].count() / repetitions << "us" << endl;
+        ok &= incorrect == 0;
+    }
+
+    // the engine is still set and writes straight into the row pitch of the tensor
+    HostOutputTensor tensor = HostOutputTensor::nchw(pitched, sizeof(psum_t), output_channels, output_h, output_w, pitch);
+    op.copy_data_out(tensor);
+    size_t pitch_incorrect = 0;
+    for (unsigned och = 0; och < output_channels; och++)
+        for (unsigned y = 0; y < output_h; y++)
+            for (unsigned x = 0; x < output_w; x++)
+                pitch_incorrect += *static_cast<psum_t*>(tensor.at(och, y, x)) != reference[(och * output_h + y) * output_w + x];
+    cout << "engine, row pitch: " << (pitch_incorrect ? "INCORRECT" : "CORRECT") << endl;
+    ok &= pitch_incorrect == 0;
+
+    if (auto* cdma_engine = dynamic_cast<CdmaTransferEngine*>(&engine))
+        cout << "last chain used " << cdma_engine->get_chain_length() << " descriptors" << endl;
+
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    unsigned image_size = 32, kernel_size = 3, input_channels = 8, output_channels = 6;
+    unsigned repetitions = 10;
+    bool cpu_fallback = false;
+    string device_name(DEFAULT_DEVICE), cdma_name, buffer_name;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:m:b:s:k:c:u:n:F")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d " << DEFAULT_DEVICE << ": accelerator device (\"" << RECACC_SIM_DEVICE << "\" selects the simulation and the CDMA register model)" << endl;
+                cout << "-m " << DEFAULT_CDMA << ": CDMA uio device" << endl;
+                cout << "-b " << DEFAULT_BUFFER << ": u-dma-buf device for host buffers and descriptors" << endl;
+                cout << "-s 32: width & height of the input image" << endl;
+                cout << "-k 3: width & height of the kernels" << endl;
+                cout << "-c 8: number of input channels" << endl;
+                cout << "-u 6: number of output channels" << endl;
+                cout << "-n 10: repetitions for timing" << endl;
+                cout << "-F: compare against the CpuTransferEngine fallback instead of the CDMA" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'm':
+                cdma_name = optarg;
+                break;
+            case 'b':
+                buffer_name = optarg;
+                break;
+            case 's':
+                image_size = atoi(optarg);
+                break;
+            case 'k':
+                kernel_size = atoi(optarg);
+                break;
+            case 'c':
+                input_channels = atoi(optarg);
+                break;
+            case 'u':
+                output_channels = atoi(optarg);
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case 'F':
+                cpu_fallback = true;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    const bool sim = device_name == RECACC_SIM_DEVICE;
+    if (cdma_name.empty())
+        cdma_name = sim ? RECACC_SIM_DEVICE : DEFAULT_CDMA;
+    if (buffer_name.empty())
+        buffer_name = sim ? RECACC_SIM_DEVICE : DEFAULT_BUFFER;
+
+    recacc_device dev;
+    int ret = recacc_open(&dev, device_name.c_str());
+    if (ret)
+        return ret;
+
+    if (!recacc_verify(&dev, true)) {
+        recacc_close(&dev);
+        return 1;
+    }
+    recacc_reset(&dev);
+
+    recacc_dma_buffer buffer, desc_mem, data;
+    ret = recacc_dma_buffer_open(&buffer, buffer_name.c_str(), SIM_BUFFER_SIZE);
+    if (ret) {
+        recacc_close(&dev);
+        return ret;
+    }
+    recacc_dma_buffer_slice(&desc_mem, &buffer, 0, DESC_MEM_SIZE);
+    recacc_dma_buffer_slice(&data, &buffer, DESC_MEM_SIZE, buffer.size - DESC_MEM_SIZE);
+
+    recacc_cdma cdma;
+    ret = recacc_cdma_open(&cdma, cdma_name.c_str(), &dev, &desc_mem);
+    if (ret) {
+        recacc_dma_buffer_close(&buffer);
+        recacc_close(&dev);
+        return ret;
+    }
+
+    bool ok = test_descriptor_chain(&dev, &cdma, &data);
+    cout << "descriptor chain test " << (ok ? "SUCCESS" : "FAILED") << endl;
+
+    CpuTransferEngine cpu_engine(&dev);
+    CdmaTransferEngine cdma_engine(&dev, &cdma, &data);
+    try {
+        ok &= test_conv2d(&dev, cpu_fallback ? static_cast<TransferEngine&>(cpu_engine) : cdma_engine, &data,
+            image_size, kernel_size, input_channels, output_channels, repetitions);
+    } catch (const exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        ok = false;
+    }
+
+    recacc_cdma_close(&cdma);
+    recacc_dma_buffer_close(&buffer);
+    recacc_close(&dev);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/chain.hpp"
+#include "lib/conv2d.hpp"
+#include "lib/conv2dtest.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+
+static TestErrors errors;
+
+// the iact of data is unused, layers after the first read the output of the previous one
+struct Layer {
+    Conv2D op;
+    Conv2DTestData data;
+};
+
+// reference: every layer on its own, the output goes through the host as input of the next layer
+static bool run_on_host(recacc_device* dev, vector<Layer>& layers, const vector<input_t>& iact, vector<uint8_t>& result) {
+    vector<input_t> input = iact;
+    for (Layer& layer : layers) {
+        Conv2D op = layer.op;
+        op.allocate_spad_auto();
+        op.compute_accelerator_parameters(true);
+        op.copy_data_in(input.data(), input.size(), layer.data.wght.data(), layer.data.wght.size());
+        if (!run_conv2d(dev, op, layer.data))
+            return false;
+        result.resize(op.get_output_channel_bytes() * get<1>(op.get_channel_count()));
+        op.copy_data_out(result.data(), result.size());
+        input.assign(result.begin(), result.end());
+    }
+    return true;
+}
+
+static void test_chain(recacc_device* dev, const recacc_hwinfo& hwinfo, unsigned runs) {
+    // layer 1 reads the output of layer 0 in place with one channel per column. layer 2 reads 10 channels of
+    // 32x32 bytes in place, layer 1 computes them in the order of its columns. the 30x30 channels of layer 3 do not
+    // fill whole scratchpad words, they are rearranged
+    vector<Layer> layers(4);
+    layers[0].op = Conv2D(32, 3, 8, 8, true);
+    layers[0].op.set_padding_mode(true);
+    layers[0].op.set_activation_mode(act_relu);
+    layers[1].op = Conv2D(32, 3, 8, 10, true);
+    layers[1].op.set_padding_mode(true);
+    layers[2].op = Conv2D(32, 3, 10, 9, true);
+    layers[3].op = Conv2D(30, 5, 9, 4, true);
+    layers[3].op.set_activation_mode(act_relu);
+
+    Conv2DChain chain(dev, hwinfo);
+    for (Layer& layer : layers) {
+        Conv2D& op = layer.op;
+        op.set_recacc_device(dev);
+        op.set_hwinfo(hwinfo);
+        op.set_wait_mode(wait_adaptive);
+        layer.data = Conv2DTestData(op);
+        const Conv2DTestData& data = layer.data;
+        chain.add_layer(op, data.wght.data(), data.wght.size(), data.bias, data.factors, data.zeropoints);
+    }
+
+    bool mismatch_rejected = false;
+    try {
+        chain.add_layer(Conv2D(32, 3, 4, 4, true), nullptr, 0, {}, {}, {});
+    } catch (const runtime_error&) {
+        mismatch_rejected = true;
+    }
+    errors.expect(mismatch_rejected && chain.get_layer_count() == layers.size(), "layer not matching the previous output rejected");
+
+    // the references use the whole scratchpad and would overwrite the resident weights, run them all first
+    const vector<vector<input_t>> iacts = Conv2DTestData(layers[0].op, runs).iact;
+    const size_t iact_bytes = iacts[0].size();
+    vector<vector<uint8_t>> expected(runs);
+    vector<double> host_ms(runs);
+    double host_total = 0, chain_total = 0;
+    for (unsigned run = 0; run < runs; run++) {
+        auto start = chrono::steady_clock::now();
+        errors.expect(run_on_host(dev, layers, iacts[run], expected[run]), "reference run " + to_string(run));
+        host_ms[run] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        host_total += host_ms[run];
+    }
+
+    VariadicTable<unsigned, string, unsigned, double, double> vt({"run", "result", "cycles", "host [ms]", "chain [ms]"}, 10);
+    for (unsigned run = 0; run < runs; run++) {
+        vector<uint8_t> result(expected[run].size());
+        auto start = chrono::steady_clock::now();
+        Conv2DResult chain_result = chain.run(iacts[run].data(), iact_bytes, result.data(), result.size());
+        double chain_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        chain_total += chain_ms;
+        errors.expect(chain_result.success, "chain run " + to_string(run));
+
+        bool correct = chain_result.success && !result.empty() && result == expected[run];
+        errors.expect(correct, "output of chain run " + to_string(run));
+        vt.addRow(run, correct ? "correct" : "wrong", chain_result.cycles, host_ms[run], chain_ms);
+    }
+    vt.print(cout);
+
+    errors.expect(chain.get_in_place_count() == 2, "layers 1 and 2 read the output of the previous layer in place");
+    SpadAllocator::Stats stats = chain.get_allocator().get_stats();
+    cout << chain.get_layer_count() << " layers, " << chain.get_in_place_count() << " in place, "
+         << chain.get_avoided_bytes() << " bytes of host traffic avoided per run, peak "
+         << stats.peak_used_bytes << " of " << stats.column_bytes << " bytes per column" << endl;
+    if (runs)
+        cout << "mean per run: host " << host_total / runs << " ms, chain " << chain_total / runs << " ms" << endl;
+}
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+    unsigned runs = 3;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:n:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-n <runs>: run the chain this many times with resident weights (default: 3)" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'n':
+                runs = stoul(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    test_chain(&dev, hwinfo, runs);
+
+    recacc_close(&dev);
+    return errors.report();
+}
@@ -24,6 +24,11 @@ int main(int argc, char** argv) {
     bool padding = false;
     bool debug_mode = false;
     bool interrupts = false;
+    bool adaptive_wait = false;
+    bool completion_thread = false;
+    unsigned copy_threads = 1;
+    recacc_wait_params wait_params;
+    recacc_wait_params_init(&wait_params);
 
     #ifdef __linux__
     opterr = 0;
@@ -32,13 +37,13 @@ int main(int argc, char** argv) {
     string files_path;
     string output_path;
 
-    while ((c = getopt(argc, argv, "hnd:i:o:s:c:k:u:Brpa:DIPt:")) != -1)
+    while ((c = getopt(argc, argv, "hnd:i:o:s:c:k:u:Brpa:DIPTW:t:j:")) != -1)
         switch (c) {
             case 'h':
                 cout << "Usage:" << endl;
                 cout << "-h: show this help" << endl;
                 cout << "-n: no-op, do not access the accelerator" << endl;
-                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ")" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
                 cout << "-i <path>: load data from path instead of random" << endl;
                 cout << "           path must contain _image.txt, _kernel.txt, _convolution.txt" << endl;
                 cout << "-o <path>: save output data to path (_output_acc.txt, _output_cpu.txt)" << endl;
@@ -52,7 +57,10 @@ int main(int argc, char** argv) {
                 cout << "-a relu: enable activation (available: relu)" << endl;
                 cout << "-D enable buffer debug mode (fill unused with 0 / 0xaa pattern)" << endl;
                 cout << "-I/-P use interrupts or polling (default: polling)" << endl;
+                cout << "-T: use interrupts through a completion thread (eventfd notification)" << endl;
+                cout << "-W <us>: adaptive wait, spin for <us> then sleep with backoff, then use interrupts" << endl;
                 cout << "-t specify psum throttle value (default: guess)" << endl;
+                cout << "-j 1: number of threads for copying data into the scratchpad" << endl;
                 return 0;
                 break;
             case 'n':
@@ -94,9 +102,20 @@ int main(int argc, char** argv) {
             case 'P':
                 interrupts = false;
                 break;
+            case 'T':
+                interrupts = true;
+                completion_thread = true;
+                break;
+            case 'W':
+                adaptive_wait = true;
+                wait_params.spin_us = atoi(optarg);
+                break;
             case 't':
                 throttle = atoi(optarg);
                 break;
+            case 'j':
+                copy_threads = atoi(optarg);
+                break;
             case 'a':
                 if (strcmp(optarg, "relu") == 0)
                     act_mode = act_relu;
@@ -107,7 +126,7 @@ int main(int argc, char** argv) {
                 break;
             case '?':
                 if (optopt == 'd' || optopt == 'p' || optopt == 'o' || optopt == 's' ||
-                    optopt == 'c' || optopt == 'k' || optopt == 'u' || optopt == 'a')
+                    optopt == 'c' || optopt == 'k' || optopt == 'u' || optopt == 'a' || optopt == 'W' || optopt == 'j')
                     cerr << "Option -" << char(optopt) << " requires an argument." << endl;
                 else if (isprint(optopt))
                     cerr << "Unknown option -" << char(optopt) << endl;
@@ -144,6 +163,16 @@ int main(int argc, char** argv) {
                 << endl;
             return recacc_close(&dev);
         }
+
+        #ifdef __linux__
+        if (completion_thread) {
+            ret = recacc_irq_thread_start(&dev);
+            if (ret) {
+                recacc_close(&dev);
+                return ret;
+            }
+        }
+        #endif
     }
 
     Conv2DTest c2d(&dev);
@@ -158,7 +187,12 @@ int main(int argc, char** argv) {
     c2d.set_bias(!zero_bias);
     c2d.set_debug_clean_buffers(debug_mode);
     c2d.use_interrupts(interrupts);
+    if (adaptive_wait) {
+        c2d.set_wait_mode(wait_adaptive);
+        c2d.set_wait_params(wait_params);
+    }
     c2d.set_psum_throttle(throttle);
+    c2d.set_copy_threads(copy_threads);
 
     cout << "preparing parameters and test data" << endl;
     #ifdef __linux__
@@ -190,6 +224,7 @@ int main(int argc, char** argv) {
         auto cycles = c2d.get_cycle_count();
         float microseconds = 1.0 * cycles / 100000000 * 100000; // 100 MHz
         cout << "conv2d took " << c2d.get_cycle_count() << " cycles on accelerator (" << microseconds << "us @100MHz)" << endl;
+        cout << "waited " << c2d.get_wait_latency_ns() / 1000.0 << "us for completion" << endl;
     }
 
     cout << "comparing cpu and accelerator results" << endl;
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/conv2d_cpu.hpp"
+#include "lib/conv2dtest.hpp"
+#include "lib/hosttensor.hpp"
+#include "lib/pooling.hpp"
+#include "lib/transfer.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+static TestErrors errors;
+
+// element (c, y, x) of t must equal the dense CHW reference
+template<typename T> static bool compare(const HostOutputTensor& t, const vector<T>& reference) {
+    for (unsigned c = 0; c < t.c; c++)
+        for (unsigned y = 0; y < t.h; y++)
+            for (unsigned x = 0; x < t.w; x++)
+                if (memcmp(t.at(c, y, x), &reference[(c * t.h + y) * t.w + x], sizeof(T)))
+                    return false;
+    return true;
+}
+
+template<typename T> static void test_layer(recacc_device* dev, const recacc_hwinfo& hwinfo, Conv2D op, unsigned repetitions,
+        VariadicTable<string, string, float, float, string>& vt) {
+    op.set_recacc_device(dev);
+    op.set_hwinfo(hwinfo);
+    op.set_wait_mode(wait_adaptive);
+    op.allocate_spad_auto();
+    op.compute_accelerator_parameters(true);
+
+    // the psums stay in the scratchpad for the copies
+    const Conv2DTestData data(op);
+    op.copy_data_in(data.iact[0].data(), data.iact[0].size(), data.wght.data(), data.wght.size());
+    if (!run_conv2d(dev, op, data)) {
+        errors.expect(false, "run of " + op.get_parameter_string() + " timed out");
+        return;
+    }
+
+    const unsigned output_channels = get<1>(op.get_channel_count());
+    auto [w, h] = op.get_output_size();
+    const unsigned plane = w * h;
+    vector<T> reference(plane * output_channels);
+    op.copy_data_out(reference.data(), reference.size() * sizeof(T), false);
+    errors.expect(!data.count_incorrect(op, reference.data()), "CPU reference differs for " + op.get_parameter_string());
+
+    // the layer writes channels 5.. of a concat buffer with 5 more channels before and 3 after it, rows padded by 4
+    const unsigned concat_channels = output_channels + 8;
+    vector<T> nchw_concat(concat_channels * h * (w + 4)), nhwc(plane * output_channels), nhwc_concat(concat_channels * plane);
+    const vector<pair<string, HostOutputTensor>> layouts = {
+        {"NCHW concat, row pitch", HostOutputTensor::nchw(nchw_concat.data(), sizeof(T), concat_channels, h, w, w + 4).channels(5, output_channels)},
+        {"NHWC", HostOutputTensor::nhwc(nhwc.data(), sizeof(T), output_channels, h, w)},
+        {"NHWC concat", HostOutputTensor::nhwc(nhwc_concat.data(), sizeof(T), concat_channels, h, w).channels(5, output_channels)},
+    };
+
+    vector<T> dense(reference.size());
+    for (const auto& [name, tensor] : layouts) {
+        auto t1 = timer::now();
+        for (unsigned n = 0; n < repetitions; n++) {
+            op.copy_data_out(dense.data(), dense.size() * sizeof(T), false);
+            tensor.copy_from_chw(dense.data());
+        }
+        auto t2 = timer::now();
+        for (unsigned n = 0; n < repetitions; n++)
+            op.copy_data_out(tensor, false);
+        auto t3 = timer::now();
+
+        bool correct = compare(tensor, reference);
+        errors.expect(correct, name + " output differs for " + op.get_parameter_string());
+        chrono::duration<float, std::micro> staged = t2 - t1, direct = t3 - t2;
+        vt.addRow(to_string(w) + "x" + to_string(h) + "x" + to_string(output_channels) + (sizeof(T) == 1 ? " int8" : " int32"),
+            name, staged.count() / repetitions, direct.count() / repetitions, correct ? "correct" : "WRONG");
+    }
+
+    // with a transfer engine, packed rows are queued straight into the pitch and interleaved layouts read by the CPU
+    CpuTransferEngine engine(dev);
+    op.set_transfer_engine(&engine);
+    for (vector<T>* buffer : {&nchw_concat, &nhwc, &nhwc_concat})
+        fill(buffer->begin(), buffer->end(), 0);
+    for (const auto& [name, tensor] : layouts) {
+        auto t1 = timer::now();
+        for (unsigned n = 0; n < repetitions; n++) {
+            op.copy_data_out(dense.data(), dense.size() * sizeof(T), false);
+            tensor.copy_from_chw(dense.data());
+        }
+        auto t2 = timer::now();
+        for (unsigned n = 0; n < repetitions; n++)
+            op.copy_data_out(tensor, false);
+        auto t3 = timer::now();
+
+        bool correct = compare(tensor, reference);
+        errors.expect(correct, name + " output through the transfer engine differs for " + op.get_parameter_string());
+        chrono::duration<float, std::micro> staged = t2 - t1, direct = t3 - t2;
+        vt.addRow(to_string(w) + "x" + to_string(h) + "x" + to_string(output_channels) + (sizeof(T) == 1 ? " int8" : " int32"),
+            name + ", engine", staged.count() / repetitions, direct.count() / repetitions, correct ? "correct" : "WRONG");
+    }
+    op.set_transfer_engine(nullptr);
+
+    // pooling fused into the readback against reading everything and pooling in a second pass
+    const vector<tuple<string, Pool2D, bool>> pools = {
+        {"max 2x2", {pool_max, 2, 2}, false},
+        {"avg 2x2", {pool_avg, 2, 2}, false},
+        {"max 3x3", {pool_max, 3, 2}, false},
+        {"avg 3x3", {pool_avg, 3, 2}, false},
+        {"max 2x2 NHWC", {pool_max, 2, 2}, true},
+    };
+    for (const auto& [name, pool, to_nhwc] : pools) {
+        const unsigned pw = pool.output_size(w), ph = pool.output_size(h);
+        vector<T> expected(pw * ph * output_channels), pooled(expected.size());
+        pool2d_cpu<T>(reference.data(), expected.data(), output_channels, h, w, pool.size, pool.stride, pool.mode == pool_max ? 0 : 1);
+        HostOutputTensor tensor = to_nhwc ? HostOutputTensor::nhwc(pooled.data(), sizeof(T), output_channels, ph, pw)
+            : HostOutputTensor::nchw(pooled.data(), sizeof(T), output_channels, ph, pw);
+
+        vector<const T*> rows(pool.size);
+        auto t1 = timer::now();
+        for (unsigned n = 0; n < repetitions; n++) {
+            op.copy_data_out(dense.data(), dense.size() * sizeof(T), false);
+            for (unsigned c = 0; c < output_channels; c++)
+                for (unsigned py = 0; py < ph; py++) {
+                    for (unsigned i = 0; i < pool.size; i++)
+                        rows[i] = &dense[(c * h + py * pool.stride + i) * w];
+                    pool.pool_row(rows.data(), w, static_cast<T*>(tensor.at(c, py, 0)), tensor.stride_x);
+                }
+        }
+        auto t2 = timer::now();
+        for (unsigned n = 0; n < repetitions; n++)
+            op.copy_data_out(tensor, pool, false);
+        auto t3 = timer::now();
+
+        bool correct = compare(tensor, expected);
+        errors.expect(correct, name + " pooling differs for " + op.get_parameter_string());
+        chrono::duration<float, std::micro> staged = t2 - t1, fused = t3 - t2;
+        vt.addRow(to_string(w) + "x" + to_string(h) + "x" + to_string(output_channels) + (sizeof(T) == 1 ? " int8" : " int32"),
+            name, staged.count() / repetitions, fused.count() / repetitions, correct ? "correct" : "WRONG");
+    }
+    recacc_control_stop(dev);
+}
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+    unsigned repetitions = 20;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:n:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-n 20: repetitions per measurement" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    VariadicTable<string, string, float, float, string> vt({"output", "layout", "dense+separate pass [us]", "direct [us]", "result"}, 10);
+    Conv2D requantized(32, 3, 8, 10, true);
+    requantized.set_padding_mode(true);
+    requantized.set_activation_mode(act_relu);
+    test_layer<int8_t>(&dev, hwinfo, requantized, repetitions, vt);
+    test_layer<psum_t>(&dev, hwinfo, Conv2D(30, 3, 8, 6), repetitions, vt);
+    vt.print(cout);
+
+    recacc_close(&dev);
+    return errors.report();
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2dtest.hpp"
+#include "lib/executor.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+
+static TestErrors errors;
+
+// two layers submitted alternately, one with raw psums and one requantized with relu and padding
+static vector<Conv2D> make_layers(const recacc_hwinfo& hwinfo) {
+    vector<Conv2D> layers = {Conv2D(32, 3, 8, 6), Conv2D(16, 3, 4, 3, true)};
+    layers[1].set_padding_mode(true);
+    layers[1].set_activation_mode(act_relu);
+    for (Conv2D& op : layers) {
+        op.set_wait_mode(wait_adaptive);
+        op.set_hwinfo(hwinfo);
+    }
+    return layers;
+}
+
+// submit all jobs at once and check every result against the CPU reference. with shutdown, the executor is
+// destroyed right after submitting: the destructor must still run all queued jobs and fulfil their futures
+static void test_jobs(recacc_device* dev, vector<Conv2D> layers, unsigned jobs, bool double_buffering, bool shutdown) {
+    vector<Conv2DTestData> data;
+    for (const Conv2D& op : layers)
+        data.emplace_back(op);
+
+    vector<vector<uint8_t>> results(jobs);
+    vector<future<Conv2DResult>> futures;
+    {
+        Conv2DExecutor executor(dev);
+        executor.set_double_buffering(double_buffering);
+        for (unsigned n = 0; n < jobs; n++) {
+            Conv2D& op = layers[n % layers.size()];
+            results[n].resize(op.get_output_channel_bytes() * get<1>(op.get_channel_count()));
+            futures.push_back(executor.submit(data[n % layers.size()].make_job(op, results[n].data(), results[n].size())));
+        }
+        errors.expect(executor.pending() <= jobs, "pending jobs counted");
+
+        if (!shutdown) {
+            executor.wait_idle();
+            errors.expect(executor.pending() == 0, "no jobs pending after wait_idle");
+        } else {
+            cout << "destroying the executor with " << executor.pending() << " of " << jobs << " jobs pending" << endl;
+        }
+    }
+
+    unsigned correct = 0;
+    for (unsigned n = 0; n < jobs; n++) {
+        const string job = "job " + to_string(n);
+        if (futures[n].wait_for(chrono::seconds(0)) != future_status::ready) {
+            errors.expect(false, job + " finished before the executor was destroyed");
+            continue;
+        }
+        try {
+            Conv2DResult result = futures[n].get();
+            errors.expect(result.success, job + " timed out");
+            const size_t incorrect = data[n % layers.size()].count_incorrect(layers[n % layers.size()], results[n].data());
+            errors.expect(!incorrect, job + ": " + to_string(incorrect) + " values INCORRECT");
+            correct += result.success && !incorrect;
+        } catch (const exception& e) {
+            errors.expect(false, job + " failed: " + e.what());
+        }
+    }
+    cout << correct << "/" << jobs << " jobs CORRECT" << (double_buffering ? ", double buffered" : "")
+         << (shutdown ? " after shutdown" : " after wait_idle") << endl;
+}
+
+int main(int argc, char** argv) {
+    unsigned jobs = 8;
+    string device_name(DEFAULT_DEVICE);
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:j:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-j 8: number of jobs to submit" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 'j':
+                jobs = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    vector<Conv2D> layers = make_layers(hwinfo);
+    test_jobs(&dev, layers, jobs, false, false);
+    test_jobs(&dev, layers, jobs, false, true);
+
+    // more output channels than postprocessing registers, double-buffered jobs must run in output channel groups
+    Conv2D wide(16, 3, 4, hwinfo.max_output_channels + 6, true);
+    wide.set_wait_mode(wait_adaptive);
+    wide.set_hwinfo(hwinfo);
+    layers.push_back(wide);
+    test_jobs(&dev, layers, jobs, true, false);
+
+    recacc_close(&dev);
+    return errors.report();
+}
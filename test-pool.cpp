@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2dtest.hpp"
+#include "lib/pool.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    unsigned image_size = 32, kernel_size = 3, input_channels = 8, output_channels = 6;
+    unsigned jobs = 16;
+    bool requantize = false;
+    bool padding = false;
+    bool split = false;
+    bool double_buffering = false;
+    bool weight_caching = false;
+    bool transfer_engines = false;
+    vector<string> device_names;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:j:s:c:k:u:rpSBWT")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <dev1,dev2,...>: devices of the pool (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-j 16: number of jobs to run" << endl;
+                cout << "-s 32: width & height of the input image" << endl;
+                cout << "-k 3: width & height of the kernels" << endl;
+                cout << "-c 8: number of input channels" << endl;
+                cout << "-u 6: number of output channels" << endl;
+                cout << "-r: enable requantization" << endl;
+                cout << "-p: enable same size padding" << endl;
+                cout << "-S: split each job by output channel across all devices" << endl;
+                cout << "-B: double buffer the scratchpad, overlapping copies with the accelerator" << endl;
+                cout << "-W: keep weights resident in the scratchpad across jobs" << endl;
+                cout << "-T: copy through a transfer engine per device, the jobs carry the engine of the first device" << endl;
+                return 0;
+            case 'd': {
+                istringstream iss(optarg);
+                string name;
+                while (getline(iss, name, ','))
+                    device_names.push_back(name);
+                break;
+            }
+            case 'j':
+                jobs = atoi(optarg);
+                break;
+            case 's':
+                image_size = atoi(optarg);
+                break;
+            case 'k':
+                kernel_size = atoi(optarg);
+                break;
+            case 'c':
+                input_channels = atoi(optarg);
+                break;
+            case 'u':
+                output_channels = atoi(optarg);
+                break;
+            case 'r':
+                requantize = true;
+                break;
+            case 'p':
+                padding = true;
+                break;
+            case 'S':
+                split = true;
+                break;
+            case 'B':
+                double_buffering = true;
+                break;
+            case 'W':
+                weight_caching = true;
+                break;
+            case 'T':
+                transfer_engines = true;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    if (device_names.empty())
+        device_names.push_back(DEFAULT_DEVICE);
+
+    DevicePool pool;
+    try {
+        pool.open(device_names, true);
+    } catch (const exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return 1;
+    }
+    for (size_t n = 0; n < pool.size(); n++) {
+        pool.get_executor(n).set_double_buffering(double_buffering);
+        pool.get_executor(n).set_weight_caching(weight_caching);
+    }
+
+    // jobs moved to another device must not copy through the engine they carry, but through the one of their executor
+    vector<unique_ptr<CpuTransferEngine>> engines;
+    if (transfer_engines) {
+        for (size_t n = 0; n < pool.size(); n++) {
+            engines.push_back(make_unique<CpuTransferEngine>(pool.get_executor(n).get_device()));
+            pool.get_executor(n).set_transfer_engine(engines.back().get());
+        }
+
+        bool rejected = pool.size() == 1;
+        try {
+            if (!rejected)
+                pool.get_executor(1).set_transfer_engine(engines[0].get());
+        } catch (const runtime_error&) {
+            rejected = true;
+        }
+        if (!rejected) {
+            cerr << "ERROR: transfer engine of another device accepted" << endl;
+            return 1;
+        }
+    }
+
+    Conv2D op(image_size, kernel_size, input_channels, output_channels, requantize);
+    op.set_padding_mode(padding);
+    if (transfer_engines)
+        op.set_transfer_engine(engines[0].get());
+    op.set_wait_mode(wait_adaptive);
+    op.set_hwinfo(pool.get_executor(0).get_hwinfo());
+
+    const size_t result_bytes = op.get_output_channel_bytes() * output_channels;
+    // every job has its own image, results of a job copied through the scratchpad of another device differ
+    Conv2DTestData data(op, jobs);
+
+    vector<vector<int8_t>> results(jobs, vector<int8_t>(result_bytes));
+    vector<future<Conv2DResult>> futures;
+
+    cout << "running " << jobs << " jobs (" << op.get_parameter_string() << ") on "
+         << pool.size() << " devices" << (split ? ", split by output channel" : "")
+         << (double_buffering ? ", double buffered" : "") << (transfer_engines ? ", through transfer engines" : "") << endl;
+
+    auto t1 = timer::now();
+    for (unsigned n = 0; n < jobs; n++) {
+        Conv2DJob job = data.make_job(op, results[n].data(), result_bytes, n);
+        futures.push_back(split ? pool.submit_split(std::move(job)) : pool.submit(std::move(job)));
+    }
+
+    vector<bool> done(jobs, false);
+    for (unsigned n = 0; n < jobs; n++) {
+        try {
+            done[n] = futures[n].get().success;
+        } catch (const exception& e) {
+            cerr << "job " << n << " failed: " << e.what() << endl;
+        }
+    }
+    chrono::duration<float, std::micro> duration = timer::now() - t1;
+
+    unsigned failed = 0;
+    for (unsigned n = 0; n < jobs; n++) {
+        if (!done[n]) {
+            failed++;
+            continue;
+        }
+
+        const size_t incorrect = data.count_incorrect(op, results[n].data(), n);
+        if (incorrect) {
+            cerr << "job " << n << ": " << incorrect << " values INCORRECT" << endl;
+            failed++;
+        }
+    }
+
+    cout << jobs - failed << "/" << jobs << " jobs CORRECT, " << duration.count() << "us total, "
+         << jobs / duration.count() * 1e6 << " jobs/s" << endl;
+
+    if (weight_caching) {
+        WeightCache::Stats stats;
+        for (size_t n = 0; n < pool.size(); n++) {
+            WeightCache::Stats s = pool.get_executor(n).get_weight_cache_stats();
+            stats.hits += s.hits;
+            stats.misses += s.misses;
+            stats.evictions += s.evictions;
+            stats.bytes_skipped += s.bytes_skipped;
+        }
+        cout << "weight cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, "
+             << stats.bytes_skipped << " weight bytes not copied" << endl;
+    }
+
+    pool.close();
+    return failed ? 1 : 0;
+}
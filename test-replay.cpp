@@ -0,0 +1,137 @@
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/cmdqueue.hpp"
+#include "lib/conv2dtest.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+using namespace std;
+
+static TestErrors errors;
+
+// how the register programming of a job reaches the device
+enum class Submission {Direct, Replay, Queue};
+
+static const char* submission_name(Submission submission) {
+    switch (submission) {
+        case Submission::Direct:
+            return "individual writes";
+        case Submission::Replay:
+            return "run_recorded";
+        default:
+            return "CommandQueue";
+    }
+}
+
+// zero the configuration and postprocessing registers, so a replay that misses a register cannot pass on what
+// the previous job left behind
+static void clear_registers(recacc_device* dev, const recacc_hwinfo& hwinfo) {
+    recacc_config cfg = {};
+    recacc_config_invalidate(dev);
+    recacc_config_write(dev, &cfg);
+    for (unsigned n = 0; n < 3 * hwinfo.max_output_channels; n++)
+        recacc_reg_write(dev, RECACC_REG_IDX_BIAS_REQUANT_BASE + n, 0);
+}
+
+// run every image of data through op with the given submission, the register programming is recorded once and
+// replayed for all images. every result is compared against the CPU reference
+static void run_layer(recacc_device* dev, const recacc_hwinfo& hwinfo, Conv2D op, const Conv2DTestData& data, Submission submission, CommandQueue& queue) {
+    const string name = op.get_parameter_string() + " with " + submission_name(submission);
+    op.set_recacc_device(dev);
+    op.set_wait_mode(wait_adaptive);
+    op.allocate_spad_auto();
+    op.compute_accelerator_parameters(true);
+
+    recacc_cmdbuf cb;
+    if (submission != Submission::Direct)
+        op.record_accelerator_job(cb, data.bias, data.factors, data.zeropoints);
+
+    const size_t psum_bytes = op.get_output_channel_bytes() * get<1>(op.get_channel_count());
+    unsigned correct = 0;
+    for (unsigned image = 0; image < data.iact.size(); image++) {
+        op.copy_data_in(data.iact[image].data(), data.iact[image].size(), data.wght.data(), data.wght.size());
+        if (submission != Submission::Direct)
+            clear_registers(dev, hwinfo);
+        switch (submission) {
+            case Submission::Direct:
+                op.configure_accelerator();
+                op.set_postproc_data(data.bias, data.factors, data.zeropoints);
+                op.run_accelerator();
+                break;
+            case Submission::Replay:
+                op.run_recorded(cb);
+                break;
+            case Submission::Queue:
+                queue.submit(&cb).get();
+                break;
+        }
+
+        if (!op.wait_until_accelerator_done()) {
+            recacc_control_stop(dev);
+            errors.expect(false, name + ": accelerator timed out for image " + to_string(image));
+            return;
+        }
+
+        vector<uint8_t> psum(psum_bytes);
+        op.copy_data_out(psum.data(), psum.size());
+        const size_t incorrect = data.count_incorrect(op, psum.data(), image);
+        errors.expect(!incorrect, name + ", image " + to_string(image) + ": " + to_string(incorrect) + " values INCORRECT");
+        correct += !incorrect;
+    }
+    cout << name << ": " << correct << "/" << data.iact.size() << " images CORRECT" << endl;
+}
+
+int main(int argc, char** argv) {
+    string device_name = RECACC_SIM_DEVICE;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: \"" << RECACC_SIM_DEVICE << "\")" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    // raw psums, requantized with relu and padding, and more than one output channel group of the psum layout
+    vector<Conv2D> layers = {Conv2D(32, 3, 8, 3), Conv2D(16, 3, 4, 3, true), Conv2D(30, 5, 16, 10, true)};
+    layers[1].set_padding_mode(true);
+    layers[1].set_activation_mode(act_relu);
+
+    {
+        CommandQueue queue(&dev);
+        for (Conv2D& op : layers) {
+            op.set_hwinfo(hwinfo);
+            Conv2DTestData data(op, 3);
+            for (Submission submission : {Submission::Direct, Submission::Replay, Submission::Queue})
+                run_layer(&dev, hwinfo, op, data, submission, queue);
+        }
+    }
+
+    recacc_close(&dev);
+    return errors.report();
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/conv2dtest.hpp"
+#include "lib/spadalloc.hpp"
+#include "lib/VariadicTable.h"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+
+static TestErrors errors;
+
+// placement, coalescing, lifetimes and statistics on a small column
+static void test_allocator() {
+    SpadAllocator spad(1024);
+    errors.expect(spad.allocate("a", 100) == 0, "first allocation at the column start");
+    errors.expect(spad.get("a").bytes == 104, "sizes aligned to 8 bytes");
+    spad.allocate("b", 200, 1);
+    spad.allocate("c", 64);
+    spad.allocate("d", 300, 2);
+    spad.allocate("e", 8);
+
+    // holes of 200 (b) and 304 (d) bytes, best fit puts 150 bytes into the smaller one
+    spad.release("b");
+    spad.release("d");
+    errors.expect(spad.allocate("f", 150) == 104, "best fit chooses the smallest hole");
+    errors.expect(spad.get_stats().free_blocks == 3, "three free blocks after best fit");
+    errors.expect(spad.get_stats().fragmentation > 0.0f, "fragmentation reported for split free space");
+
+    bool failed = false;
+    try {
+        spad.allocate("g", 400);
+    } catch (const runtime_error&) {
+        failed = true;
+    }
+    errors.expect(failed && spad.get_stats().failures == 1, "allocation larger than every hole fails");
+
+    // expired allocations are released and merged with their neighbours
+    spad.set_last_step("f", 3);
+    spad.set_last_step("c", 3);
+    spad.advance(3);
+    errors.expect(spad.contains("f") && spad.contains("c"), "allocations live until their last step");
+    spad.advance(4);
+    errors.expect(!spad.contains("f") && !spad.contains("c"), "allocations released after their last step");
+    errors.expect(spad.allocate("g", 400) == 104, "freed neighbours coalesced");
+
+    spad.clear();
+    SpadAllocator::Stats stats = spad.get_stats();
+    errors.expect(stats.free_blocks == 1 && stats.largest_free == 1024 && stats.fragmentation == 0.0f, "clear frees everything");
+    errors.expect(stats.peak_used_bytes >= 104 + 152 + 64 + 304 + 8, "peak usage tracked");
+}
+
+struct Layer {
+    Conv2D op;
+    Conv2DTestData data;
+    vector<uint8_t> expected;
+    bool weights_loaded = false;
+};
+
+static bool run(recacc_device* dev, Conv2D& op, Layer& layer, bool copy_wght, vector<uint8_t>& result) {
+    auto output_channels = get<1>(op.get_channel_count());
+    op.compute_accelerator_parameters(true);
+    const Conv2DTestData& data = layer.data;
+    op.copy_data_in(data.iact[0].data(), data.iact[0].size(), copy_wght ? data.wght.data() : nullptr, data.wght.size());
+    if (!run_conv2d(dev, op, data))
+        return false;
+    result.resize(op.get_output_channel_bytes() * output_channels);
+    op.copy_data_out(result.data(), result.size());
+    return true;
+}
+
+// several layers keep their weights in the scratchpad while iact and psum only live for their step
+static void test_resident_layers(recacc_device* dev, const recacc_hwinfo& hwinfo) {
+    vector<Layer> layers(3);
+    layers[0].op = Conv2D(32, 3, 8, 3);
+    layers[1].op = Conv2D(16, 3, 16, 6, true);
+    layers[1].op.set_padding_mode(true);
+    layers[1].op.set_activation_mode(act_relu);
+    layers[2].op = Conv2D(30, 5, 8, 4, true);
+
+    for (Layer& layer : layers) {
+        Conv2D& op = layer.op;
+        op.set_recacc_device(dev);
+        op.set_hwinfo(hwinfo);
+        op.set_wait_mode(wait_adaptive);
+        layer.data = Conv2DTestData(op);
+
+        // reference with the greedy allocator, weights copied for every run
+        Conv2D reference = op;
+        reference.allocate_spad_auto();
+        errors.expect(run(dev, reference, layer, true, layer.expected), "reference run");
+        errors.expect(!layer.data.count_incorrect(op, layer.expected.data()), "reference run against the CPU reference");
+    }
+
+    SpadAllocator spad(hwinfo);
+    VariadicTable<unsigned, string, unsigned, unsigned, unsigned, float> vt(
+        {"step", "layer", "used bytes", "largest free", "free blocks", "fragmentation"}, 10);
+    const unsigned steps = 3 * layers.size();
+    for (unsigned step = 0; step < steps; step++) {
+        spad.advance(step);
+        Layer& layer = layers[step % layers.size()];
+        const string name = "layer" + to_string(step % layers.size());
+
+        // iact and psum are only needed in this step, the weights stay for the next runs of the layer
+        Conv2D op = layer.op;
+        op.allocate_spad(spad, name, step);
+        spad.set_last_step(name + ".wght", SpadAllocator::forever);
+
+        vector<uint8_t> result;
+        errors.expect(run(dev, op, layer, !layer.weights_loaded, result), "run of " + name);
+        errors.expect(result == layer.expected, "output of " + name + " in step " + to_string(step));
+        layer.weights_loaded = true;
+
+        SpadAllocator::Stats stats = spad.get_stats();
+        vt.addRow(step, name, stats.used_bytes, stats.largest_free, stats.free_blocks, stats.fragmentation);
+    }
+    vt.print(cout);
+
+    SpadAllocator::Stats stats = spad.get_stats();
+    cout << "peak " << stats.peak_used_bytes << " of " << stats.column_bytes << " bytes per column, "
+         << stats.allocations << " allocations resident" << endl;
+}
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    test_allocator();
+    cout << "allocator checks " << (errors.count() ? "FAILED" : "passed") << endl;
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    test_resident_layers(&dev, hwinfo);
+
+    recacc_close(&dev);
+    return errors.report();
+}
@@ -0,0 +1,190 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2dtest.hpp"
+#include "lib/executor.hpp"
+#include "lib/plan.hpp"
+#include "lib/staticplan.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+using namespace std;
+
+// the hardware as reported by the simulator (see driver/sim.c)
+constexpr recacc_hwinfo sim_hwinfo = {
+    .array_size_x = 7,
+    .array_size_y = 10,
+    .line_length_iact = 64,
+    .line_length_wght = 64,
+    .line_length_psum = 128,
+    .fifo_size_psum = 128,
+    .spad_size = 512 * 1024,
+    .spad_word_size = 8,
+    .data_width_bits_iact = 8,
+    .data_width_bits_wght = 8,
+    .data_width_bits_psum = 32,
+    .max_output_channels = 10,
+    .trs_dataflow = false,
+    .bias_requant_available = true,
+};
+
+// a few testsuite shapes, all planned by the compiler
+using Layer1 = StaticConv2DPlan<sim_hwinfo, Conv2DShape{.image_size = 32, .kernel_size = 3, .input_channels = 8, .output_channels = 3}>;
+using Layer2 = StaticConv2DPlan<sim_hwinfo, Conv2DShape{16, 3, 4, 3, true, true, act_relu}>;
+using Layer3 = StaticConv2DPlan<sim_hwinfo, Conv2DShape{62, 5, 16, 10, true}>;
+using Layer4 = StaticConv2DPlan<sim_hwinfo, Conv2DShape{30, 7, 24, 6, true, true, act_relu}>;
+using Layer5 = StaticConv2DPlan<sim_hwinfo, Conv2DShape{30, 1, 64, 10}>;
+using Layer6 = StaticConv2DPlan<sim_hwinfo, Conv2DShape{62, 3, 8, 8, false, true}>;
+
+// the register image is a constant, e.g. for placing it in read-only memory
+static_assert(Layer1::registers[RECACC_REG_IDX_IMAGE_X - RECACC_REG_IDX_INPUTCHS] == 32);
+static_assert(Layer1::cfg.m0 == 3 && Layer1::cfg.m1 == 1);
+
+// uncomment to see the build fail for a layer not fitting the scratchpad
+// using TooLarge = StaticConv2DPlan<sim_hwinfo, Conv2DShape{224, 3, 64, 3}>;
+// static_assert(TooLarge::cfg.m0 > 0);
+
+static TestErrors errors;
+
+static void expect(bool ok, const string& what, const string& layer) {
+    errors.expect(ok, what + " differs for " + layer);
+}
+
+// the compile-time plan must equal what Conv2D plans at runtime
+template<typename Layer> static Conv2D compare_plan(const recacc_hwinfo& hwinfo) {
+    Conv2D op = Layer::make_op(nullptr, hwinfo);
+    Conv2D runtime_op = op;
+    runtime_op.set_psum_throttle(-1);
+    runtime_op.allocate_spad_auto();
+    runtime_op.compute_accelerator_parameters(true);
+    Conv2DPlan rt = runtime_op.compile_plan();
+    const Conv2DPlan& st = *Layer::plan();
+
+    const string name = op.get_parameter_string();
+    expect(static_plan::config_registers(rt.cfg) == Layer::registers, "register image", name);
+    expect(rt.cfg.stride == st.cfg.stride, "stride", name);
+    expect(rt.base_iact == st.base_iact && rt.base_wght == st.base_wght && rt.base_psum == st.base_psum
+        && rt.base_padding == st.base_padding, "buffer offsets", name);
+    expect(rt.alloc_size_iact == st.alloc_size_iact && rt.alloc_size_wght == st.alloc_size_wght
+        && rt.alloc_size_psum == st.alloc_size_psum, "allocation sizes", name);
+    expect(rt.spad_column_stride == st.spad_column_stride && rt.channels_per_column == st.channels_per_column
+        && rt.bytes_per_psum == st.bytes_per_psum && rt.bytes_per_channel == st.bytes_per_channel
+        && rt.bytes_per_kernel == st.bytes_per_kernel && rt.bytes_per_output_channel == st.bytes_per_output_channel,
+        "buffer sizes", name);
+    expect(rt.dummy_channels == st.dummy_channels, "dummy channels", name);
+    expect(rt.throttle == st.throttle, "psum throttle", name);
+    expect(rt.iact_bytes == st.iact_bytes && rt.iact_column_offsets == st.iact_column_offsets, "iact column offsets", name);
+    return op;
+}
+
+// run the layer with the static and the runtime plan on the device, the outputs must be identical
+static void compare_run(recacc_device* dev, Conv2D static_op) {
+    const unsigned output_channels = get<1>(static_op.get_channel_count());
+    Conv2DTestData data(static_op);
+
+    Conv2D runtime_op = static_op;
+    runtime_op.set_psum_throttle(-1);
+    runtime_op.allocate_spad_auto();
+    runtime_op.compute_accelerator_parameters(true);
+
+    const size_t psum_bytes = static_op.get_output_channel_bytes() * output_channels;
+    vector<uint8_t> results[2];
+    Conv2D* ops[2] = {&static_op, &runtime_op};
+    for (unsigned n = 0; n < 2; n++) {
+        Conv2D& op = *ops[n];
+        op.set_recacc_device(dev);
+        op.set_wait_mode(wait_adaptive);
+        results[n].resize(psum_bytes);
+        op.copy_data_in(data.iact[0].data(), data.iact[0].size(), data.wght.data(), data.wght.size());
+        if (!run_conv2d(dev, op, data)) {
+            errors.expect(false, "accelerator timed out for " + static_op.get_parameter_string());
+            return;
+        }
+        op.copy_data_out(results[n].data(), psum_bytes);
+    }
+    expect(results[0] == results[1], "output", static_op.get_parameter_string());
+    errors.expect(!data.count_incorrect(static_op, results[0].data()), "CPU reference differs for " + static_op.get_parameter_string());
+}
+
+// jobs of a preloaded layer are run by the executor without planning
+static void run_preloaded(recacc_device* dev, const recacc_hwinfo& hwinfo) {
+    Layer1::preload(hwinfo);
+    uint64_t misses = PlanCache::global().get_misses();
+
+    Conv2D op(32, 3, 8, 3);
+    op.set_wait_mode(wait_adaptive);
+    op.set_hwinfo(hwinfo);
+    Conv2DTestData data(op);
+    vector<uint8_t> psum(op.get_output_channel_bytes() * 3);
+    Conv2DJob job = data.make_job(op, psum.data(), psum.size());
+
+    Conv2DExecutor executor(dev);
+    Conv2DResult result = executor.submit(std::move(job)).get();
+    expect(result.success, "executor result", "preloaded layer");
+    expect(PlanCache::global().get_misses() == misses, "plan cache misses", "preloaded layer");
+    errors.expect(!data.count_incorrect(op, psum.data()), "CPU reference differs for the preloaded layer");
+}
+
+int main(int argc, char** argv) {
+    string device_name = RECACC_SIM_DEVICE;
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: \"" << RECACC_SIM_DEVICE << "\")" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    const bool matching = Layer1::matches(hwinfo);
+    if (!matching) {
+        // the plans are still compared against runtime planning for the simulated hardware
+        cout << "device differs from the hwinfo the layers were planned for, not running them" << endl;
+        hwinfo = sim_hwinfo;
+    }
+
+    vector<Conv2D> ops = {
+        compare_plan<Layer1>(hwinfo),
+        compare_plan<Layer2>(hwinfo),
+        compare_plan<Layer3>(hwinfo),
+        compare_plan<Layer4>(hwinfo),
+        compare_plan<Layer5>(hwinfo),
+        compare_plan<Layer6>(hwinfo),
+    };
+    cout << ops.size() << " static plans compared to runtime planning" << endl;
+
+    if (matching) {
+        for (Conv2D& op : ops)
+            compare_run(&dev, op);
+        cout << ops.size() << " layers run with static and runtime plans" << endl;
+        run_preloaded(&dev, hwinfo);
+    }
+
+    recacc_close(&dev);
+    return errors.report();
+}
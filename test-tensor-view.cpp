@@ -0,0 +1,150 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2d.hpp"
+#include "lib/conv2dtest.hpp"
+#include "lib/tensorview.hpp"
+#include "lib/utils.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+
+static TestErrors errors;
+
+static void expect(bool ok, const string& what, const Conv2D& op) {
+    errors.expect(ok, what + " for " + op.get_parameter_string());
+}
+
+// the views must address exactly what copy_data_in writes and copy_data_out reads, and a layer produced and
+// consumed through them must give the same result as with host buffers
+template<typename T> static void test_layer(recacc_device* dev, const recacc_hwinfo& hwinfo, Conv2D op) {
+    auto [input_channels, output_channels] = op.get_channel_count();
+    auto [image_size, unused] = op.get_image_size();
+    auto [kernel_size, unused2] = op.get_kernel_size();
+    op.set_recacc_device(dev);
+    op.set_hwinfo(hwinfo);
+    op.set_wait_mode(wait_adaptive);
+    op.allocate_spad_auto();
+    op.compute_accelerator_parameters(true);
+
+    const unsigned plane = image_size * image_size;
+    const unsigned kernel = kernel_size * kernel_size;
+    const Conv2DTestData data(op);
+    const vector<input_t>& iact = data.iact[0];
+    const vector<input_t>& wght = data.wght;
+
+    // reference with host buffers
+    op.copy_data_in(iact.data(), iact.size(), wght.data(), wght.size());
+
+    SpadTensorView<input_t> iact_view = op.iact_view();
+    vector<input_t> plane_buf(plane);
+    bool iact_ok = true;
+    for (unsigned c = 0; c < input_channels; c++) {
+        iact_view.read_channel(c, plane_buf.data());
+        iact_ok &= memcmp(plane_buf.data(), &iact[c * plane], plane) == 0;
+        iact_ok &= iact_view.get(c, image_size - 1, 1) == iact[c * plane + (image_size - 1) * image_size + 1];
+    }
+    expect(iact_ok, "iact view", op);
+
+    bool wght_ok = true;
+    for (unsigned och = 0; och < output_channels; och++) {
+        SpadTensorView<input_t> wght_view = op.wght_view(och);
+        for (unsigned c = 0; c < input_channels; c++)
+            for (unsigned y = 0; y < kernel_size; y++)
+                for (unsigned x = 0; x < kernel_size; x++)
+                    wght_ok &= wght_view.get(c, y, x) == wght[(och * input_channels + c) * kernel + y * kernel_size + x];
+    }
+    expect(wght_ok, "wght view", op);
+
+    expect(run_conv2d(dev, op, data), "reference run", op);
+    const size_t psum_bytes = op.get_output_channel_bytes() * output_channels;
+    vector<T> expected(psum_bytes / sizeof(T));
+    op.copy_data_out(expected.data(), psum_bytes);
+    expect(!data.count_incorrect(op, expected.data()), "CPU reference", op);
+
+    SpadTensorView<T> psum_view = op.psum_view<T>();
+    const unsigned out_plane = psum_view.get_height() * psum_view.get_width();
+    vector<T> result(expected.size());
+    for (unsigned och = 0; och < output_channels; och++)
+        psum_view.read_channel(och, &result[och * out_plane]);
+    expect(result == expected, "psum view after copy_data_out", op);
+
+    // produce the inputs in place: clear the old data, iact row by row, weights element by element
+    spad_zero(static_cast<uint8_t*>(recacc_get_buffer(dev)), hwinfo.spad_size);
+    for (unsigned c = 0; c < input_channels; c++)
+        for (unsigned y = 0; y < image_size; y++)
+            iact_view.write_row(c, y, &iact[c * plane + y * image_size]);
+    for (unsigned och = 0; och < output_channels; och++) {
+        SpadTensorView<input_t> wght_view = op.wght_view(och);
+        wght_view.zero();
+        for (unsigned c = 0; c < input_channels; c++)
+            for (unsigned y = 0; y < kernel_size; y++)
+                for (unsigned x = 0; x < kernel_size; x++)
+                    wght_view.set(c, y, x, wght[(och * input_channels + c) * kernel + y * kernel_size + x]);
+    }
+    op.copy_data_in(nullptr, 0, nullptr, 0);
+
+    expect(run_conv2d(dev, op, data), "run through views", op);
+    bool psum_ok = true;
+    for (unsigned och = 0; och < output_channels; och++)
+        for (unsigned y = 0; y < psum_view.get_height(); y++)
+            for (unsigned x = 0; x < psum_view.get_width(); x++)
+                psum_ok &= psum_view.get(och, y, x) == expected[och * out_plane + y * psum_view.get_width() + x];
+    recacc_control_stop(dev);
+    expect(psum_ok, "output read through the psum view", op);
+    cout << op.get_parameter_string() << (psum_ok ? " correct" : " wrong") << endl;
+}
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    // one and several channels per column, dummy channels, padding, int8 and int32 outputs
+    test_layer<psum_t>(&dev, hwinfo, Conv2D(32, 3, 8, 3));
+    Conv2D padded(16, 3, 4, 3, true);
+    padded.set_padding_mode(true);
+    padded.set_activation_mode(act_relu);
+    test_layer<int8_t>(&dev, hwinfo, padded);
+    test_layer<int8_t>(&dev, hwinfo, Conv2D(30, 5, 10, 9, true));
+    Conv2D wide(30, 3, 24, 6);
+    wide.set_padding_mode(true);
+    test_layer<psum_t>(&dev, hwinfo, wide);
+
+    recacc_close(&dev);
+    return errors.report();
+}
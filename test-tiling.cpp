@@ -0,0 +1,156 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2dtest.hpp"
+#include "lib/tiling.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+using timer = chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    unsigned image_size = 224, kernel_size = 3, input_channels = 8, output_channels = 3;
+    unsigned tile_size = 0;
+    enum activation_mode act_mode = act_none;
+    bool requantize = false;
+    bool padding = false;
+    string device_name(DEFAULT_DEVICE);
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:s:c:k:u:rpa:t:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                cout << "-s 224: width & height of the input image" << endl;
+                cout << "-k 3: width & height of the kernels" << endl;
+                cout << "-c 8: number of input channels" << endl;
+                cout << "-u 3: number of output channels" << endl;
+                cout << "-r: enable requantization" << endl;
+                cout << "-p: enable same size padding" << endl;
+                cout << "-a relu: enable activation (available: relu)" << endl;
+                cout << "-t <size>: input tile size (default: largest that fits)" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case 's':
+                image_size = atoi(optarg);
+                break;
+            case 'k':
+                kernel_size = atoi(optarg);
+                break;
+            case 'c':
+                input_channels = atoi(optarg);
+                break;
+            case 'u':
+                output_channels = atoi(optarg);
+                break;
+            case 'r':
+                requantize = true;
+                break;
+            case 'p':
+                padding = true;
+                break;
+            case 'a':
+                if (strcmp(optarg, "relu") == 0)
+                    act_mode = act_relu;
+                else {
+                    cerr << "Unknown activation mode " << string(optarg) << endl;
+                    return 1;
+                }
+                break;
+            case 't':
+                tile_size = atoi(optarg);
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    Conv2D op(image_size, kernel_size, input_channels, output_channels, requantize);
+    op.set_padding_mode(padding);
+    op.set_activation_mode(act_mode);
+    op.set_hwinfo(hwinfo);
+
+    TiledConv2D tiler(&dev, hwinfo);
+    tiler.set_tile_size(tile_size);
+    try {
+        tiler.plan(op);
+    } catch (const exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        recacc_close(&dev);
+        return 1;
+    }
+
+    cout << op.get_parameter_string() << endl;
+    if (tiler.is_tiled())
+        cout << "running " << tiler.get_tile_count() << " tiles of " << tiler.get_tile_size() << "x" << tiler.get_tile_size()
+             << " in " << tiler.get_channel_group_count() << " input channel groups and "
+             << tiler.get_output_channel_group_count() << " output channel groups" << endl;
+    else
+        cout << "layer fits the scratchpad, no tiling required" << endl;
+
+    auto [output_w, output_h] = op.get_output_size();
+    const size_t num_result = output_w * output_h * output_channels;
+    const size_t result_bytes = op.get_output_channel_bytes() * output_channels;
+    Conv2DTestData data(op);
+
+    vector<int8_t> result(result_bytes);
+    Conv2DJob job = data.make_job(op, result.data(), result_bytes);
+
+    Conv2DResult res;
+    auto t1 = timer::now();
+    try {
+        res = tiler.run(job);
+    } catch (const exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        recacc_close(&dev);
+        return 1;
+    }
+    chrono::duration<float, std::micro> duration_acc = timer::now() - t1;
+    recacc_close(&dev);
+
+    if (!res.success) {
+        cerr << "ERROR: accelerator timed out" << endl;
+        return 1;
+    }
+
+    // cpu reference
+    t1 = timer::now();
+    size_t offset;
+    const size_t incorrect = data.count_incorrect(op, result.data(), 0, &offset);
+    chrono::duration<float, std::micro> duration_cpu = timer::now() - t1;
+
+    cout << "cpu " << duration_cpu.count() << "us, accelerator incl. tiling " << duration_acc.count() << "us ("
+         << res.cycles << " cycles)" << endl;
+    cout << "comparing " << num_result << " ACC values to CPU reference... ";
+    if (incorrect)
+        cout << incorrect << " values INCORRECT, first at " << offset << endl;
+    else
+        cout << "CORRECT" << endl;
+
+    return incorrect ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#include <future>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/conv2dtest.hpp"
+#include "lib/executor.hpp"
+
+extern "C" {
+    #include <driver.h>
+}
+
+#define DEFAULT_DEVICE "/dev/uio4"
+
+using namespace std;
+
+static TestErrors errors;
+
+// runs jobs of one layer with different weight sets through an executor with weight caching
+class WeightCacheTest {
+public:
+    WeightCacheTest(recacc_device* dev, const Conv2D& layer, unsigned sets) : executor(dev), op(layer), data(sets) {
+        executor.set_weight_caching(true);
+        for (Conv2DTestData& d : data)
+            d = Conv2DTestData(op);
+    }
+
+    // run the given weight sets one after another and check every result against the CPU reference
+    void run(const vector<unsigned>& sets, const string& phase) {
+        const size_t psum_bytes = op.get_output_channel_bytes() * get<1>(op.get_channel_count());
+        vector<vector<uint8_t>> results(sets.size(), vector<uint8_t>(psum_bytes));
+        vector<future<Conv2DResult>> futures;
+        for (size_t n = 0; n < sets.size(); n++)
+            futures.push_back(executor.submit(data[sets[n]].make_job(op, results[n].data(), psum_bytes)));
+
+        unsigned correct = 0;
+        for (size_t n = 0; n < sets.size(); n++) {
+            const string job = phase + ", weight set " + to_string(sets[n]);
+            try {
+                Conv2DResult result = futures[n].get();
+                errors.expect(result.success, job + " timed out");
+                const size_t incorrect = data[sets[n]].count_incorrect(op, results[n].data());
+                errors.expect(!incorrect, job + ": " + to_string(incorrect) + " values INCORRECT");
+                correct += result.success && !incorrect;
+            } catch (const exception& e) {
+                errors.expect(false, job + " failed: " + e.what());
+            }
+        }
+        cout << phase << ": " << correct << "/" << sets.size() << " jobs CORRECT" << endl;
+    }
+
+    // the counters must match the expected hits, misses and evictions exactly
+    void expect_stats(uint64_t hits, uint64_t misses, uint64_t evictions, const string& phase) {
+        WeightCache::Stats stats = executor.get_weight_cache_stats();
+        cout << "weight cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, "
+             << stats.collisions << " collisions" << endl;
+        errors.expect(stats.hits == hits, phase + ": " + to_string(stats.hits) + " hits instead of " + to_string(hits));
+        errors.expect(stats.misses == misses, phase + ": " + to_string(stats.misses) + " misses instead of " + to_string(misses));
+        errors.expect(stats.evictions == evictions, phase + ": " + to_string(stats.evictions) + " evictions instead of " + to_string(evictions));
+    }
+
+    Conv2DTestData& get_data(unsigned set) {
+        return data[set];
+    }
+
+private:
+    Conv2DExecutor executor;
+    Conv2D op;
+    vector<Conv2DTestData> data;
+};
+
+int main(int argc, char** argv) {
+    string device_name(DEFAULT_DEVICE);
+
+    opterr = 0;
+    int c;
+    while ((c = getopt(argc, argv, "hd:")) != -1)
+        switch (c) {
+            case 'h':
+                cout << "Usage:" << endl;
+                cout << "-h: show this help" << endl;
+                cout << "-d <device>: use this uio device (default: " << DEFAULT_DEVICE << ", \"" << RECACC_SIM_DEVICE << "\" for simulation)" << endl;
+                return 0;
+            case 'd':
+                device_name = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    cerr << "Unknown option or missing argument for -" << char(optopt) << endl;
+                else
+                    cerr << "Unknown option character " << static_cast<int>(optopt) << endl;
+                return 1;
+            default:
+                abort();
+        }
+
+    recacc_device dev;
+    recacc_hwinfo hwinfo;
+    int ret = open_test_device(&dev, device_name, &hwinfo);
+    if (ret)
+        return ret;
+
+    // large kernels and many input channels, so only a few weight sets fit next to iact and psum
+    Conv2D op(16, 7, 64, 10);
+    op.set_wait_mode(wait_adaptive);
+    op.set_hwinfo(hwinfo);
+    const unsigned column_size = hwinfo.spad_size / hwinfo.spad_word_size / 8 * 8;
+    const unsigned capacity = (column_size - op.get_data_column_bytes()) / op.get_wght_column_bytes();
+    const unsigned sets = capacity + 4;
+    cout << capacity << " weight sets of " << op.get_parameter_string() << " fit the scratchpad, running " << sets << endl;
+
+    {
+        WeightCacheTest test(&dev, op, sets);
+
+        // every set is new, the first 4 are evicted by the last 4
+        vector<unsigned> order;
+        for (unsigned n = 0; n < sets; n++)
+            order.push_back(n);
+        test.run(order, "overflow");
+        test.expect_stats(0, sets, 4, "overflow");
+
+        // the sets still resident are hits
+        test.run(vector<unsigned>(order.begin() + 4, order.end()), "resident");
+        test.expect_stats(capacity, sets, 4, "resident");
+
+        // an evicted set is uploaded again and evicts the least recently used one
+        test.run({0}, "evicted");
+        test.expect_stats(capacity, sets + 1, 5, "evicted");
+
+        // changed weights in the same buffer must not be taken for the resident ones
+        vector<input_t>& wght = test.get_data(0).wght;
+        for (input_t& w : wght)
+            w = -w;
+        test.run({0}, "changed");
+        test.expect_stats(capacity, sets + 2, 6, "changed");
+    }
+
+    recacc_close(&dev);
+    return errors.report();
+}